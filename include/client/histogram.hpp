@@ -0,0 +1,118 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <stdint.h>
+
+namespace client
+{
+    /*
+        HDR直方图:按2的幂分桶,每桶再等分成2048格,任意量级的相对误差都在千分之一以内
+        记录O(1)不分配内存,取百分位数时扫一遍计数;单位由调用者决定(这里用纳秒)
+    */
+    class Histogram
+    {
+    public:
+        explicit Histogram(uint64_t highest = 60000000000ULL) : _highest(highest), _total(0), _min(UINT64_MAX), _max(0), _sum(0)
+        {
+            int buckets = 1;
+            while (buckets < 64 && ((uint64_t)SUB_BUCKETS << (buckets - 1)) <= highest)
+                buckets++;
+            _counts.assign((size_t)(buckets + 1) * HALF, 0);
+        }
+        /*
+            超过highest的值按highest记
+        */
+        void record(uint64_t v)
+        {
+            if (v > _highest)
+                v = _highest;
+            _counts[index(v)]++;
+            _total++;
+            _sum += v;
+            _min = std::min(_min, v);
+            _max = std::max(_max, v);
+        }
+        void merge(const Histogram &other)
+        {
+            size_t n = std::min(_counts.size(), other._counts.size());
+            for (size_t i = 0; i < n; i++)
+                _counts[i] += other._counts[i];
+            _total += other._total;
+            _sum += other._sum;
+            _min = std::min(_min, other._min);
+            _max = std::max(_max, other._max);
+        }
+        void reset()
+        {
+            std::fill(_counts.begin(), _counts.end(), 0);
+            _total = _sum = _max = 0;
+            _min = UINT64_MAX;
+        }
+        uint64_t count() const
+        {
+            return _total;
+        }
+        uint64_t min() const
+        {
+            return _total ? _min : 0;
+        }
+        uint64_t max() const
+        {
+            return _max;
+        }
+        double mean() const
+        {
+            return _total ? (double)_sum / _total : 0;
+        }
+        /*
+            percentile取0-100,返回所在格的上界(不超过max)
+        */
+        uint64_t percentile(double percentile) const
+        {
+            if (_total == 0)
+                return 0;
+            uint64_t rank = (uint64_t)(percentile / 100 * _total + 0.5);
+            rank = std::max<uint64_t>(rank, 1);
+            uint64_t seen = 0;
+            for (size_t i = 0; i < _counts.size(); i++)
+            {
+                seen += _counts[i];
+                if (seen >= rank)
+                    return std::min(highestEquivalent(i), _max);
+            }
+            return _max;
+        }
+
+    private:
+        static const int HALF_MAGNITUDE = 10;
+        static const uint64_t HALF = 1 << HALF_MAGNITUDE;
+        static const uint64_t SUB_BUCKETS = HALF * 2;
+
+        static size_t index(uint64_t v)
+        {
+            // 桶号是v的最高位减去11,桶内按v >> bucket定格
+            int bucket = 63 - __builtin_clzll(v | (SUB_BUCKETS - 1)) - HALF_MAGNITUDE;
+            uint64_t sub = v >> bucket;
+            return ((size_t)bucket << HALF_MAGNITUDE) + (size_t)sub;
+        }
+        static uint64_t highestEquivalent(size_t i)
+        {
+            int bucket = (int)(i >> HALF_MAGNITUDE) - 1;
+            uint64_t sub = (i & (HALF - 1)) + HALF;
+            if (bucket < 0)
+            {
+                sub -= HALF;
+                bucket = 0;
+            }
+            return ((sub + 1) << bucket) - 1;
+        }
+
+    private:
+        uint64_t _highest;
+        std::vector<uint64_t> _counts;
+        uint64_t _total;
+        uint64_t _min;
+        uint64_t _max;
+        uint64_t _sum;
+    };
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <stdint.h>
+#include "buffer.hpp"
+#include "histogram.hpp"
+#include "document.hpp"
+
+namespace client
+{
+    enum load_mode
+    {
+        LOAD_ECHO = 0,  // 发给服务器原样返回
+        LOAD_CHAT = 1,  // 私聊下一条连接的用户
+        LOAD_GROUP = 2, // 发到房间,所有成员(含自己)都收到
+    };
+    struct LoadOption
+    {
+        std::string host = "127.0.0.1";
+        uint16_t port = 8000;
+        size_t connections = 100;
+        double rate = 1000;    // 全部连接合计每秒发送条数
+        double duration = 10;  // 秒,不含预热
+        double warmup = 1;     // 预热期间的延迟不计入
+        load_mode mode = LOAD_ECHO;
+        size_t roomSize = 10;  // group模式每个房间的连接数
+        size_t payload = 64;   // 每条消息的填充字节数
+        bool binary = false;   // 用hello协商二进制编码
+        long long firstUser = 1000000;
+    };
+    struct LoadResult
+    {
+        uint64_t sent = 0;
+        uint64_t received = 0; // 测量期内发出的消息收到的次数
+        uint64_t expected = 0;
+        uint64_t errors = 0;   // code非0的ack和无法解析的帧
+        double elapsed = 0;    // 测量期实际秒数
+        Histogram latency;     // 纳秒,从计划发送时刻算起
+    };
+    /*
+     * 一个进程、一个epoll开N条连接:登录、进房间后按固定速率发送,
+     * 消息里带计划发送时刻(不是实际发送时刻,避免协调遗漏),收到时记延迟
+     */
+    class LoadClient
+    {
+    public:
+        explicit LoadClient(const LoadOption &option);
+        ~LoadClient();
+        LoadClient(const LoadClient &) = delete;
+        LoadClient &operator=(const LoadClient &) = delete;
+
+        /*
+         * 连接或准备阶段失败返回false,原因在error()
+         */
+        bool run(LoadResult &result);
+        const std::string &error() const { return _error; }
+        /*
+         * 结果写成一行JSON
+         */
+        static std::string report(const LoadOption &option, const LoadResult &result);
+
+    private:
+        struct Conn
+        {
+            int fd;
+            long long user;
+            long long room;
+            server::InputBuffer input;
+            server::OutputBuffer output;
+        };
+        bool connectAll();
+        bool setup();
+        size_t receivers(const Conn &c) const;
+        void send(Conn &c, uint64_t ts);
+        void flush(Conn &c);
+        bool poll(int timeoutMs, LoadResult *result);
+        void onFrame(const std::string &payload, LoadResult *result);
+
+    private:
+        LoadOption _option;
+        int _epfd;
+        std::vector<std::unique_ptr<Conn>> _conns;
+        std::vector<Conn *> _dirty;
+        json::Document _doc;
+        size_t _acks;
+        uint64_t _measureFrom; // 计划时刻在[_measureFrom,_measureTo)内的消息计入结果
+        uint64_t _measureTo;
+        std::string _pad;
+        std::string _frame;
+        std::string _error;
+    };
+}
@@ -0,0 +1,306 @@
+#pragma once
+#include <string>
+#include <cstring>
+#include <cmath>
+#include <cfloat>
+#include <stdint.h>
+
+namespace json
+{
+    /*
+        二进制编码,取CBOR(RFC 8949)中和JSON对应的子集,移动端和其他语言有现成的库:
+        每个值以一个头字节开始,高3位是大类,低5位小于24时就是参数本身,
+        24/25/26/27表示后面跟1/2/4/8字节的大端参数(变长整数)
+            0 非负整数      1 负整数(-1-参数)   3 字符串(参数是字节数,后面是UTF-8原文)
+            4 数组(元素个数) 5 对象(键值对个数)  7 false/true/null/浮点数
+        字符串不转义,数字不经过文本,浮点数按原始位存放(能无损缩成float时用4字节)
+        数组和对象事先不知道个数时用不定长形式,以0xff结束
+    */
+    enum binary_major
+    {
+        BINARY_UINT = 0,
+        BINARY_NEGINT = 1,
+        BINARY_BYTES = 2,
+        BINARY_TEXT = 3,
+        BINARY_ARRAY = 4,
+        BINARY_MAP = 5,
+        BINARY_TAG = 6,
+        BINARY_SIMPLE = 7
+    };
+    const unsigned char BINARY_FALSE = 0xf4;
+    const unsigned char BINARY_TRUE = 0xf5;
+    const unsigned char BINARY_NULL = 0xf6;
+    const unsigned char BINARY_FLOAT = 0xfa;
+    const unsigned char BINARY_DOUBLE = 0xfb;
+    const unsigned char BINARY_BREAK = 0xff;
+    const unsigned BINARY_INDEFINITE = 31;
+
+    inline void encodeHead(unsigned major, uint64_t arg, std::string &out)
+    {
+        unsigned char m = (unsigned char)(major << 5);
+        if (arg < 24)
+        {
+            out += (char)(m | arg);
+            return;
+        }
+        char buf[9];
+        size_t n;
+        if (arg <= 0xff)
+            buf[0] = (char)(m | 24), n = 1;
+        else if (arg <= 0xffff)
+            buf[0] = (char)(m | 25), n = 2;
+        else if (arg <= 0xffffffffULL)
+            buf[0] = (char)(m | 26), n = 4;
+        else
+            buf[0] = (char)(m | 27), n = 8;
+        for (size_t i = n; i > 0; i--)
+        {
+            buf[i] = (char)arg;
+            arg >>= 8;
+        }
+        out.append(buf, n + 1);
+    }
+    inline void encodeUint(unsigned long long u, std::string &out)
+    {
+        encodeHead(BINARY_UINT, u, out);
+    }
+    inline void encodeInt(long long int v, std::string &out)
+    {
+        // -1-v不会溢出
+        if (v < 0)
+            encodeHead(BINARY_NEGINT, ~(uint64_t)v, out);
+        else
+            encodeHead(BINARY_UINT, (uint64_t)v, out);
+    }
+    /*
+        和文本一样,NaN和无穷写成null
+    */
+    inline void encodeDouble(double v, std::string &out)
+    {
+        if (!std::isfinite(v))
+        {
+            out += (char)BINARY_NULL;
+            return;
+        }
+        char buf[9];
+        if (std::fabs(v) <= FLT_MAX && (double)(float)v == v)
+        {
+            float f = (float)v;
+            uint32_t bits;
+            memcpy(&bits, &f, 4);
+            buf[0] = (char)BINARY_FLOAT;
+            for (int i = 4; i > 0; i--, bits >>= 8)
+                buf[i] = (char)bits;
+            out.append(buf, 5);
+            return;
+        }
+        uint64_t bits;
+        memcpy(&bits, &v, 8);
+        buf[0] = (char)BINARY_DOUBLE;
+        for (int i = 8; i > 0; i--, bits >>= 8)
+            buf[i] = (char)bits;
+        out.append(buf, 9);
+    }
+    inline void encodeString(const char *s, size_t len, std::string &out)
+    {
+        encodeHead(BINARY_TEXT, len, out);
+        out.append(s, len);
+    }
+    /*
+        读p处的头,p移到参数之后;info是低5位,浮点数的参数是原始位,不定长和0xff时arg为0
+        数据不完整或用了保留值时返回false,p不动
+    */
+    inline bool decodeHead(const char *&p, const char *end, unsigned &major, unsigned &info, uint64_t &arg)
+    {
+        if (p == end)
+            return false;
+        unsigned char b = (unsigned char)*p;
+        major = b >> 5;
+        info = b & 31;
+        arg = 0;
+        if (info < 24 || info == BINARY_INDEFINITE)
+        {
+            if (info < 24)
+                arg = info;
+            ++p;
+            return true;
+        }
+        if (info > 27)
+            return false;
+        size_t n = (size_t)1 << (info - 24);
+        if ((size_t)(end - p) < n + 1)
+            return false;
+        const unsigned char *q = (const unsigned char *)p + 1;
+        for (size_t i = 0; i < n; i++)
+            arg = (arg << 8) | q[i];
+        p += n + 1;
+        return true;
+    }
+    inline double decodeFloat(uint64_t bits, unsigned info)
+    {
+        if (info == 26)
+        {
+            uint32_t b = (uint32_t)bits;
+            float f;
+            memcpy(&f, &b, 4);
+            return f;
+        }
+        double d;
+        memcpy(&d, &bits, 8);
+        return d;
+    }
+
+    /*
+        单遍流式写出二进制,接口和Writer一致,JSON_BIND生成的jsonWrite两者都能用
+        startObject/startArray带个数时写定长头,不带时写不定长头,end时才补0xff
+    */
+    class Encoder
+    {
+    public:
+        explicit Encoder(std::string &out) : _out(out), _start(out.size()), _depth(0), _open(0)
+        {
+        }
+        void startObject()
+        {
+            _out += (char)(BINARY_MAP << 5 | BINARY_INDEFINITE);
+            push(true);
+        }
+        void startObject(size_t members)
+        {
+            encodeHead(BINARY_MAP, members, _out);
+            push(false);
+        }
+        void endObject()
+        {
+            pop();
+        }
+        void startArray()
+        {
+            _out += (char)(BINARY_ARRAY << 5 | BINARY_INDEFINITE);
+            push(true);
+        }
+        void startArray(size_t items)
+        {
+            encodeHead(BINARY_ARRAY, items, _out);
+            push(false);
+        }
+        void endArray()
+        {
+            pop();
+        }
+        void key(const char *s, size_t len)
+        {
+            encodeString(s, len, _out);
+        }
+        void key(const char *s)
+        {
+            key(s, strlen(s));
+        }
+        void key(const std::string &s)
+        {
+            key(s.data(), s.size());
+        }
+        void string(const char *s, size_t len)
+        {
+            encodeString(s, len, _out);
+        }
+        void string(const char *s)
+        {
+            string(s, strlen(s));
+        }
+        void string(const std::string &s)
+        {
+            string(s.data(), s.size());
+        }
+        void number(int v)
+        {
+            encodeInt(v, _out);
+        }
+        void number(long v)
+        {
+            encodeInt(v, _out);
+        }
+        void number(long long int v)
+        {
+            encodeInt(v, _out);
+        }
+        void number(unsigned v)
+        {
+            encodeUint(v, _out);
+        }
+        void number(unsigned long v)
+        {
+            encodeUint(v, _out);
+        }
+        void number(unsigned long long v)
+        {
+            encodeUint(v, _out);
+        }
+        void number(double v)
+        {
+            encodeDouble(v, _out);
+        }
+        void boolean(bool v)
+        {
+            _out += (char)(v ? BINARY_TRUE : BINARY_FALSE);
+        }
+        void null()
+        {
+            _out += (char)BINARY_NULL;
+        }
+        /*
+            已编码好的一个完整值,原样追加
+        */
+        void raw(const char *s, size_t len)
+        {
+            _out.append(s, len);
+        }
+        std::string &buffer()
+        {
+            return _out;
+        }
+        size_t size() const
+        {
+            return _out.size() - _start;
+        }
+
+    private:
+        /*
+            每层是否不定长:前64层记在位图里,更深的才用_deep
+        */
+        void push(bool indefinite)
+        {
+            if (_depth < 64)
+            {
+                if (indefinite)
+                    _open |= 1ULL << _depth;
+                else
+                    _open &= ~(1ULL << _depth);
+            }
+            else
+                _deep += (char)indefinite;
+            _depth++;
+        }
+        void pop()
+        {
+            bool indefinite;
+            --_depth;
+            if (_depth < 64)
+                indefinite = (_open >> _depth) & 1;
+            else
+            {
+                indefinite = _deep[_deep.size() - 1];
+                _deep.erase(_deep.size() - 1);
+            }
+            if (indefinite)
+                _out += (char)BINARY_BREAK;
+        }
+
+    private:
+        std::string &_out;
+        size_t _start;
+        size_t _depth;
+        uint64_t _open;
+        std::string _deep;
+    };
+}
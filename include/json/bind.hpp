@@ -0,0 +1,518 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstring>
+#include <stdint.h>
+#include "sax.hpp"
+#include "writer.hpp"
+#include "binary.hpp"
+
+namespace json
+{
+    /*
+        结构体与JSON的编译期绑定:
+            struct Login { long long id; std::string token; };
+            JSON_BIND(Login, id, token)
+        JSON_BIND写在结构体所在的命名空间,生成按键分发的解析和序列化,不经过DOM
+        序列化可以写文本(format)或二进制(encode)
+        成员名末尾的'_'不算在键里(for_对应"for"),和protobuf处理关键字的方式一样
+        支持的成员类型:整数、double、bool、std::string、Raw、std::vector、绑定过的结构体,
+        const char *只能序列化;一个结构体最多绑定16个成员
+    */
+
+    /*
+        值的原文,解析时不解码,序列化时原样写出;指向输入,输入必须比它活得久
+        text为NULL表示没有这个字段,写成null
+        binary表示原文是二进制编码:写进同种编码时原样复制,另一种时才转码
+    */
+    struct Raw
+    {
+        const char *text;
+        size_t size;
+        bool binary = false;
+    };
+    /*
+        去掉末尾的'_'
+    */
+    constexpr size_t keyLength(const char *s)
+    {
+        size_t n = 0;
+        while (s[n])
+            n++;
+        return n > 0 && s[n - 1] == '_' ? n - 1 : n;
+    }
+    /*
+        FNV-1a,编译期算出case标签;同一结构体里的键冲突时case重复,编译失败
+    */
+    constexpr uint32_t keyHash(const char *s, size_t n)
+    {
+        uint32_t h = 2166136261u;
+        for (size_t i = 0; i < n; i++)
+            h = (h ^ (unsigned char)s[i]) * 16777619u;
+        return h;
+    }
+    inline bool keyEquals(const char *key, size_t len, const char *name)
+    {
+        return len == keyLength(name) && memcmp(key, name, len) == 0;
+    }
+
+    /*
+        W是Writer(文本)或Encoder(二进制)
+    */
+    template <class W>
+    inline void write(W &w, int v)
+    {
+        w.number(v);
+    }
+    template <class W>
+    inline void write(W &w, long v)
+    {
+        w.number(v);
+    }
+    template <class W>
+    inline void write(W &w, long long int v)
+    {
+        w.number(v);
+    }
+    template <class W>
+    inline void write(W &w, unsigned v)
+    {
+        w.number(v);
+    }
+    template <class W>
+    inline void write(W &w, unsigned long v)
+    {
+        w.number(v);
+    }
+    template <class W>
+    inline void write(W &w, unsigned long long v)
+    {
+        w.number(v);
+    }
+    template <class W>
+    inline void write(W &w, double v)
+    {
+        w.number(v);
+    }
+    template <class W>
+    inline void write(W &w, bool v)
+    {
+        w.boolean(v);
+    }
+    template <class W>
+    inline void write(W &w, const std::string &v)
+    {
+        w.string(v);
+    }
+    template <class W>
+    inline void write(W &w, const char *v)
+    {
+        if (v)
+            w.string(v);
+        else
+            w.null();
+    }
+    inline void write(Writer &w, const Raw &v)
+    {
+        if (!v.text)
+            w.null();
+        else if (v.binary)
+            formatBinary(v.text, v.size, w);
+        else
+            w.raw(v.text, v.size);
+    }
+    inline void write(Encoder &e, const Raw &v)
+    {
+        if (!v.text)
+            e.null();
+        else if (v.binary)
+            e.raw(v.text, v.size);
+        else
+            encodeText(v.text, v.size, e);
+    }
+    template <class W, class T>
+    auto write(W &w, const T &v) -> decltype(jsonWrite(w, v), void())
+    {
+        jsonWrite(w, v);
+    }
+    template <class W, class T>
+    void write(W &w, const std::vector<T> &v)
+    {
+        w.startArray(v.size());
+        for (size_t i = 0; i < v.size(); i++)
+            write(w, v[i]);
+        w.endArray();
+    }
+    /*
+        序列化绑定过的结构体,追加到out
+    */
+    template <class T>
+    void format(const T &v, std::string &out)
+    {
+        Writer w(out);
+        write(w, v);
+    }
+    /*
+        二进制编码,追加到out
+    */
+    template <class T>
+    void encode(const T &v, std::string &out)
+    {
+        Encoder e(out);
+        write(e, v);
+    }
+
+    /*
+        按绑定解析到结构体,未知的键跳过,缺少的成员保持原值
+        字符串成员会复制;Raw指向输入
+        输入可以是文本(bind)或二进制(bindBinary),都不经过DOM
+    */
+    class Binder : public Reader
+    {
+    public:
+        Binder() : _depth(0), _binary(false)
+        {
+        }
+        /*
+            返回解析到的成员的位图,第i位对应JSON_BIND中第i个成员
+        */
+        template <class T>
+        uint64_t bind(const char *data, size_t len, T &obj)
+        {
+            start(data, len);
+            _depth = 0;
+            _binary = false;
+            _p = skipSpace(_p, _end);
+            uint64_t mask = object(obj);
+            _p = skipSpace(_p, _end);
+            if (_p != _end)
+                error();
+            return mask;
+        }
+        template <class T>
+        uint64_t bind(const std::string &s, T &obj)
+        {
+            return bind(s.data(), s.size(), obj);
+        }
+        /*
+            二进制编码的bind,Raw成员保留二进制原文
+        */
+        template <class T>
+        uint64_t bindBinary(const char *data, size_t len, T &obj)
+        {
+            start(data, len);
+            _depth = 0;
+            _binary = true;
+            uint64_t mask = object(obj);
+            if (_p != _end)
+                error();
+            return mask;
+        }
+        template <class T>
+        uint64_t bindBinary(const std::string &s, T &obj)
+        {
+            return bindBinary(s.data(), s.size(), obj);
+        }
+        /*
+            所有成员都必须出现,否则抛出Exception
+        */
+        template <class T>
+        void bindAll(const char *data, size_t len, T &obj)
+        {
+            require(bind(data, len, obj), obj);
+        }
+        template <class T>
+        void bindAll(const std::string &s, T &obj)
+        {
+            bindAll(s.data(), s.size(), obj);
+        }
+        template <class T>
+        void bindAllBinary(const char *data, size_t len, T &obj)
+        {
+            require(bindBinary(data, len, obj), obj);
+        }
+        template <class T>
+        void bindAllBinary(const std::string &s, T &obj)
+        {
+            bindAllBinary(s.data(), s.size(), obj);
+        }
+
+        /*
+            以下由JSON_BIND生成的代码调用,_p在值的开头
+        */
+        void read(long long int &v)
+        {
+            Node n;
+            value(n);
+            v = n.toInt();
+        }
+        void read(long &v)
+        {
+            long long int t;
+            read(t);
+            v = (long)t;
+        }
+        void read(int &v)
+        {
+            long long int t;
+            read(t);
+            v = (int)t;
+        }
+        void read(unsigned &v)
+        {
+            long long int t;
+            read(t);
+            v = (unsigned)t;
+        }
+        void read(unsigned long &v)
+        {
+            long long int t;
+            read(t);
+            v = (unsigned long)t;
+        }
+        void read(unsigned long long &v)
+        {
+            long long int t;
+            read(t);
+            v = (unsigned long long)t;
+        }
+        void read(double &v)
+        {
+            Node n;
+            value(n);
+            v = n.toDouble();
+        }
+        void read(bool &v)
+        {
+            Node n;
+            value(n);
+            v = n.toBool();
+        }
+        void read(std::string &v)
+        {
+            Node n;
+            value(n);
+            if (!n.isString())
+                TRANSFORMERROR(n.getType(), VALUE_STRING);
+            v.assign(n.data(), n.size());
+        }
+        void read(Raw &v)
+        {
+            v.text = _p;
+            if (_binary)
+                binarySkip(_depth);
+            else
+                skip(_depth);
+            v.size = _p - v.text;
+            v.binary = _binary;
+        }
+        template <class T>
+        void read(std::vector<T> &v)
+        {
+            v.clear();
+            if (_binary)
+            {
+                unsigned info;
+                uint64_t count = binaryOpen(BINARY_ARRAY, info);
+                enter();
+                for (uint64_t i = 0; info == BINARY_INDEFINITE ? !binaryBreak() : i < count; i++)
+                {
+                    v.push_back(T());
+                    read(v.back());
+                }
+                _depth--;
+                return;
+            }
+            expect('[');
+            _p = skipSpace(_p, _end);
+            if (_p < _end && *_p == ']')
+            {
+                ++_p;
+                return;
+            }
+            enter();
+            while (1)
+            {
+                v.push_back(T());
+                _p = skipSpace(_p, _end);
+                read(v.back());
+                _p = skipSpace(_p, _end);
+                if (_p < _end && *_p == ',')
+                {
+                    ++_p;
+                    continue;
+                }
+                expect(']');
+                break;
+            }
+            _depth--;
+        }
+        template <class T>
+        auto read(T &obj) -> decltype(jsonField(*this, obj, "", 0), void())
+        {
+            object(obj);
+        }
+
+    private:
+        void enter()
+        {
+            if (++_depth > JSONDEPTH)
+                error();
+        }
+        void value(Node &n)
+        {
+            if (_binary)
+                binaryScalar(n);
+            else
+                scalar(n);
+        }
+        template <class T>
+        void require(uint64_t mask, const T &obj)
+        {
+            int n = jsonFieldCount(&obj);
+            for (int i = 0; i < n; i++)
+            {
+                if (!(mask & (1ULL << i)))
+                {
+                    const char *name = jsonFieldName(&obj, i);
+                    throw Exception("MISSINGFIELD:" + std::string(name, keyLength(name)));
+                }
+            }
+        }
+        template <class T>
+        uint64_t object(T &obj)
+        {
+            uint64_t mask = 0;
+            if (_binary)
+            {
+                unsigned info;
+                uint64_t count = binaryOpen(BINARY_MAP, info);
+                enter();
+                for (uint64_t i = 0; info == BINARY_INDEFINITE ? !binaryBreak() : i < count; i++)
+                {
+                    const char *key;
+                    size_t len;
+                    binaryKey(key, len);
+                    int index = jsonField(*this, obj, key, len);
+                    if (index < 0)
+                        binarySkip(_depth);
+                    else
+                        mask |= 1ULL << index;
+                }
+                _depth--;
+                return mask;
+            }
+            expect('{');
+            _p = skipSpace(_p, _end);
+            if (_p < _end && *_p == '}')
+            {
+                ++_p;
+                return 0;
+            }
+            enter();
+            while (1)
+            {
+                _p = skipSpace(_p, _end);
+                expect('"');
+                const char *key;
+                size_t len;
+                string(key, len);
+                _p = skipSpace(_p, _end);
+                expect(':');
+                _p = skipSpace(_p, _end);
+                int index = jsonField(*this, obj, key, len);
+                if (index < 0)
+                    skip(_depth);
+                else
+                    mask |= 1ULL << index;
+                _p = skipSpace(_p, _end);
+                if (_p < _end && *_p == ',')
+                {
+                    ++_p;
+                    continue;
+                }
+                expect('}');
+                break;
+            }
+            _depth--;
+            return mask;
+        }
+
+    private:
+        int _depth;
+        bool _binary; // 当前输入是二进制编码
+    };
+}
+
+#define JSON_EXPAND(x) x
+#define JSON_FE_1(m, T, i, f) m(T, i, f)
+#define JSON_FE_2(m, T, i, f, ...) m(T, i, f) JSON_EXPAND(JSON_FE_1(m, T, i + 1, __VA_ARGS__))
+#define JSON_FE_3(m, T, i, f, ...) m(T, i, f) JSON_EXPAND(JSON_FE_2(m, T, i + 1, __VA_ARGS__))
+#define JSON_FE_4(m, T, i, f, ...) m(T, i, f) JSON_EXPAND(JSON_FE_3(m, T, i + 1, __VA_ARGS__))
+#define JSON_FE_5(m, T, i, f, ...) m(T, i, f) JSON_EXPAND(JSON_FE_4(m, T, i + 1, __VA_ARGS__))
+#define JSON_FE_6(m, T, i, f, ...) m(T, i, f) JSON_EXPAND(JSON_FE_5(m, T, i + 1, __VA_ARGS__))
+#define JSON_FE_7(m, T, i, f, ...) m(T, i, f) JSON_EXPAND(JSON_FE_6(m, T, i + 1, __VA_ARGS__))
+#define JSON_FE_8(m, T, i, f, ...) m(T, i, f) JSON_EXPAND(JSON_FE_7(m, T, i + 1, __VA_ARGS__))
+#define JSON_FE_9(m, T, i, f, ...) m(T, i, f) JSON_EXPAND(JSON_FE_8(m, T, i + 1, __VA_ARGS__))
+#define JSON_FE_10(m, T, i, f, ...) m(T, i, f) JSON_EXPAND(JSON_FE_9(m, T, i + 1, __VA_ARGS__))
+#define JSON_FE_11(m, T, i, f, ...) m(T, i, f) JSON_EXPAND(JSON_FE_10(m, T, i + 1, __VA_ARGS__))
+#define JSON_FE_12(m, T, i, f, ...) m(T, i, f) JSON_EXPAND(JSON_FE_11(m, T, i + 1, __VA_ARGS__))
+#define JSON_FE_13(m, T, i, f, ...) m(T, i, f) JSON_EXPAND(JSON_FE_12(m, T, i + 1, __VA_ARGS__))
+#define JSON_FE_14(m, T, i, f, ...) m(T, i, f) JSON_EXPAND(JSON_FE_13(m, T, i + 1, __VA_ARGS__))
+#define JSON_FE_15(m, T, i, f, ...) m(T, i, f) JSON_EXPAND(JSON_FE_14(m, T, i + 1, __VA_ARGS__))
+#define JSON_FE_16(m, T, i, f, ...) m(T, i, f) JSON_EXPAND(JSON_FE_15(m, T, i + 1, __VA_ARGS__))
+#define JSON_FE_PICK(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, NAME, ...) NAME
+#define JSON_FOREACH(m, T, ...)                                                                                   \
+    JSON_EXPAND(JSON_FE_PICK(__VA_ARGS__, JSON_FE_16, JSON_FE_15, JSON_FE_14, JSON_FE_13, JSON_FE_12, JSON_FE_11, \
+                             JSON_FE_10, JSON_FE_9, JSON_FE_8, JSON_FE_7, JSON_FE_6, JSON_FE_5, JSON_FE_4,        \
+                             JSON_FE_3, JSON_FE_2, JSON_FE_1)(m, T, 0, __VA_ARGS__))
+
+#define JSON_READ_FIELD(T, i, f)                                       \
+    case ::json::keyHash(#f, ::json::keyLength(#f)):                   \
+        if (::json::keyEquals(key, len, #f))                           \
+        {                                                              \
+            b.read(o.f);                                               \
+            return i;                                                  \
+        }                                                              \
+        break;
+#define JSON_WRITE_FIELD(T, i, f)                   \
+    w.key(#f, ::json::keyLength(#f));               \
+    ::json::write(w, o.f);
+#define JSON_FIELD_NAME(T, i, f) #f,
+
+/*
+    生成三个可经ADL找到的函数:
+    jsonField按键的哈希switch分发到成员,返回成员序号,未知的键返回-1
+    jsonWrite按声明顺序写出全部成员
+    jsonFieldCount/jsonFieldName给bindAll报告缺少的成员
+    用模板参数推迟实例化,只序列化的结构体可以有const char *成员
+*/
+#define JSON_BIND(Type, ...)                                                         \
+    template <class B>                                                               \
+    inline int jsonField(B &b, Type &o, const char *key, size_t len)                 \
+    {                                                                                \
+        switch (::json::keyHash(key, len))                                           \
+        {                                                                            \
+            JSON_FOREACH(JSON_READ_FIELD, Type, __VA_ARGS__)                         \
+        default:                                                                     \
+            break;                                                                   \
+        }                                                                            \
+        return -1;                                                                   \
+    }                                                                                \
+    inline const char *jsonFieldName(const Type *, int i)                            \
+    {                                                                                \
+        static const char *const names[] = {JSON_FOREACH(JSON_FIELD_NAME, Type, __VA_ARGS__)}; \
+        return names[i];                                                             \
+    }                                                                                \
+    inline int jsonFieldCount(const Type *)                                          \
+    {                                                                                \
+        static const char *const names[] = {JSON_FOREACH(JSON_FIELD_NAME, Type, __VA_ARGS__)}; \
+        return (int)(sizeof(names) / sizeof(names[0]));                              \
+    }                                                                                \
+    template <class W>                                                               \
+    inline void jsonWrite(W &w, const Type &o)                                       \
+    {                                                                                \
+        w.startObject(jsonFieldCount(&o));                                           \
+        JSON_FOREACH(JSON_WRITE_FIELD, Type, __VA_ARGS__)                            \
+        w.endObject();                                                               \
+    }
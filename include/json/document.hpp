@@ -0,0 +1,968 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <climits>
+#include <stdint.h>
+#include "json.hpp"
+#include "writer.hpp"
+#include "binary.hpp"
+
+namespace json
+{
+    /*
+        单调分配器:按块向后分配,不单独释放
+        clear只保留最后(最大)一块,所以稳定后每次clear+重新使用都不再申请内存
+        只能放可平凡析构的类型
+    */
+    class Arena
+    {
+    public:
+        Arena(size_t block = 4096) : _block(block), _head(NULL), _ptr(NULL), _end(NULL), _used(0)
+        {
+        }
+        ~Arena()
+        {
+            release(_head);
+        }
+        Arena(const Arena &) = delete;
+        Arena &operator=(const Arena &) = delete;
+
+        void *alloc(size_t n, size_t align = sizeof(void *))
+        {
+            uintptr_t p = ((uintptr_t)_ptr + align - 1) & ~(uintptr_t)(align - 1);
+            if (_ptr == NULL || p + n > (uintptr_t)_end)
+                p = grow(n, align);
+            _ptr = (char *)(p + n);
+            _used += n;
+            return (void *)p;
+        }
+        template <class T>
+        T *make(size_t n)
+        {
+            return static_cast<T *>(alloc(sizeof(T) * n, alignof(T)));
+        }
+        /*
+            O(1),保留当前块
+        */
+        void clear()
+        {
+            if (_head)
+            {
+                release(_head->next);
+                _head->next = NULL;
+                _ptr = (char *)(_head + 1);
+            }
+            _used = 0;
+        }
+        size_t used() const
+        {
+            return _used;
+        }
+        size_t blocks() const
+        {
+            size_t n = 0;
+            for (Block *b = _head; b; b = b->next)
+                n++;
+            return n;
+        }
+
+    private:
+        struct Block
+        {
+            Block *next;
+            size_t size;
+        };
+        uintptr_t grow(size_t n, size_t align)
+        {
+            // 每次翻倍,一条消息稳定后只占一块
+            size_t size = std::max(_head ? _head->size * 2 : _block, n + align + sizeof(Block));
+            Block *b = (Block *)malloc(size);
+            if (b == NULL)
+                throw std::bad_alloc();
+            b->next = _head;
+            b->size = size;
+            _head = b;
+            _ptr = (char *)(b + 1);
+            _end = (char *)b + size;
+            return ((uintptr_t)_ptr + align - 1) & ~(uintptr_t)(align - 1);
+        }
+        static void release(Block *b)
+        {
+            while (b)
+            {
+                Block *next = b->next;
+                free(b);
+                b = next;
+            }
+        }
+
+    private:
+        size_t _block;
+        Block *_head;
+        char *_ptr;
+        char *_end;
+        size_t _used;
+    };
+    struct Member;
+    /*
+        DOM节点,16字节的标签联合体,全部放在Document的arena里
+        字符串没有转义时直接指向输入,有转义时指向arena中反转义后的副本,都不以'\0'结尾
+        数组和对象的子节点在arena中连续存放,对象是按输入顺序的键值对数组
+    */
+    class Node
+    {
+    public:
+        Node() : _type(VALUE_NULL), _int(false), _size(0)
+        {
+            _u.i = 0;
+        }
+        value_type getType() const
+        {
+            return (value_type)_type;
+        }
+        bool isNull() const
+        {
+            return _type == VALUE_NULL;
+        }
+        bool isBool() const
+        {
+            return _type == VALUE_BOOLEAN;
+        }
+        bool isNumber() const
+        {
+            return _type == VALUE_NUMBER;
+        }
+        bool isInt() const
+        {
+            return _type == VALUE_NUMBER && _int;
+        }
+        bool isString() const
+        {
+            return _type == VALUE_STRING;
+        }
+        bool isArray() const
+        {
+            return _type == VALUE_ARRAY;
+        }
+        bool isObject() const
+        {
+            return _type == VALUE_OBJECT;
+        }
+        bool toBool() const
+        {
+            if (_type != VALUE_BOOLEAN)
+                TRANSFORMERROR(getType(), VALUE_BOOLEAN);
+            return _u.b;
+        }
+        long long int toInt() const
+        {
+            if (_type != VALUE_NUMBER)
+                TRANSFORMERROR(getType(), VALUE_NUMBER);
+            return _int ? _u.i : (long long int)_u.d;
+        }
+        double toDouble() const
+        {
+            if (_type != VALUE_NUMBER)
+                TRANSFORMERROR(getType(), VALUE_NUMBER);
+            return _int ? (double)_u.i : _u.d;
+        }
+        /*
+            字符串原文(已反转义)的拷贝
+        */
+        std::string toText() const
+        {
+            if (_type != VALUE_STRING)
+                TRANSFORMERROR(getType(), VALUE_STRING);
+            return std::string(_u.s, _size);
+        }
+        /*
+            字符串的字节,数组/对象的元素个数
+        */
+        const char *data() const
+        {
+            return _type == VALUE_STRING ? _u.s : NULL;
+        }
+        size_t size() const
+        {
+            return _size;
+        }
+        bool equals(const char *s, size_t len) const
+        {
+            return _type == VALUE_STRING && _size == len && memcmp(_u.s, s, len) == 0;
+        }
+        bool equals(const char *s) const
+        {
+            return equals(s, strlen(s));
+        }
+        /*
+            键不存在或者不是对象时返回NULL,键重复时取最后一个(与value一致)
+        */
+        inline const Node *find(const char *key, size_t len) const;
+        const Node *find(const std::string &key) const
+        {
+            return find(key.data(), key.size());
+        }
+        /*
+            键不存在时返回null节点
+        */
+        const Node &operator[](const char *key) const
+        {
+            const Node *n = find(key, strlen(key));
+            return n ? *n : null();
+        }
+        const Node &operator[](const std::string &key) const
+        {
+            const Node *n = find(key);
+            return n ? *n : null();
+        }
+        /*
+            越界抛出异常
+        */
+        const Node &operator[](int index) const
+        {
+            if (_type != VALUE_ARRAY)
+                TRANSFORMERROR(getType(), VALUE_ARRAY);
+            if (index < 0 || (uint32_t)index >= _size)
+                throw std::out_of_range("json::Node: index out of range");
+            return _u.items[index];
+        }
+        const Node *items() const
+        {
+            return _type == VALUE_ARRAY ? _u.items : NULL;
+        }
+        const Member *members() const
+        {
+            return _type == VALUE_OBJECT ? _u.members : NULL;
+        }
+        /*
+            紧凑格式的JSON
+        */
+        std::string formatString() const
+        {
+            std::string s;
+            format(s);
+            return s;
+        }
+        /*
+            追加到out
+        */
+        void format(std::string &out) const
+        {
+            Writer w(out);
+            write(w);
+        }
+        inline void write(Writer &w) const;
+        /*
+            二进制编码,追加到out
+        */
+        inline void encode(std::string &out) const;
+        static const Node &null()
+        {
+            static const Node n;
+            return n;
+        }
+
+    private:
+        friend class Document;
+        friend class StreamParser;
+        friend class Reader;
+        friend bool decodeBinaryScalar(const char *&p, const char *end, Node &out);
+        uint8_t _type;
+        bool _int;
+        uint32_t _size;
+        union
+        {
+            bool b;
+            long long int i;
+            double d;
+            const char *s;
+            Node *items;
+            Member *members;
+        } _u;
+    };
+    struct Member
+    {
+        Node key;
+        Node value;
+    };
+    /*
+        解码p处一个不是数组和对象的二进制值(binary.hpp),字符串指向输入
+        成功时p移到值之后;数组、对象、字节串、标签和不完整的数据返回false,p不动
+    */
+    inline bool decodeBinaryScalar(const char *&p, const char *end, Node &out)
+    {
+        const char *q = p;
+        unsigned major, info;
+        uint64_t arg;
+        if (!decodeHead(q, end, major, info, arg))
+            return false;
+        switch (major)
+        {
+        case BINARY_UINT:
+            out = Node();
+            out._type = VALUE_NUMBER;
+            if (arg > (uint64_t)LLONG_MAX)
+                out._u.d = (double)arg;
+            else
+            {
+                out._int = true;
+                out._u.i = (long long int)arg;
+            }
+            break;
+        case BINARY_NEGINT:
+            out = Node();
+            out._type = VALUE_NUMBER;
+            if (arg > (uint64_t)LLONG_MAX)
+                out._u.d = -1.0 - (double)arg;
+            else
+            {
+                out._int = true;
+                out._u.i = -1 - (long long int)arg;
+            }
+            break;
+        case BINARY_TEXT:
+            if (info == BINARY_INDEFINITE || arg > (uint64_t)(end - q))
+                return false;
+            out = Node();
+            out._type = VALUE_STRING;
+            out._u.s = q;
+            out._size = (uint32_t)arg;
+            q += arg;
+            break;
+        case BINARY_SIMPLE:
+            switch (info)
+            {
+            case BINARY_FALSE & 31:
+            case BINARY_TRUE & 31:
+                out = Node();
+                out._type = VALUE_BOOLEAN;
+                out._u.b = info == (BINARY_TRUE & 31);
+                break;
+            case BINARY_NULL & 31:
+                out = Node();
+                break;
+            case BINARY_FLOAT & 31:
+            case BINARY_DOUBLE & 31:
+                out = Node();
+                out._type = VALUE_NUMBER;
+                out._u.d = decodeFloat(arg, info);
+                break;
+            default:
+                return false;
+            }
+            break;
+        default:
+            return false;
+        }
+        p = q;
+        return true;
+    }
+    inline const Node *Node::find(const char *key, size_t len) const
+    {
+        if (_type != VALUE_OBJECT)
+            return NULL;
+        for (size_t i = _size; i-- > 0;)
+        {
+            if (_u.members[i].key.equals(key, len))
+                return &_u.members[i].value;
+        }
+        return NULL;
+    }
+    inline void Node::write(Writer &w) const
+    {
+        switch (_type)
+        {
+        case VALUE_NULL:
+            w.null();
+            break;
+        case VALUE_BOOLEAN:
+            w.boolean(_u.b);
+            break;
+        case VALUE_NUMBER:
+            if (_int)
+                w.number(_u.i);
+            else
+                w.number(_u.d);
+            break;
+        case VALUE_STRING:
+            w.string(_u.s, _size);
+            break;
+        case VALUE_ARRAY:
+            w.startArray();
+            for (size_t i = 0; i < _size; i++)
+                _u.items[i].write(w);
+            w.endArray();
+            break;
+        case VALUE_OBJECT:
+            w.startObject();
+            for (size_t i = 0; i < _size; i++)
+            {
+                w.key(_u.members[i].key._u.s, _u.members[i].key._size);
+                _u.members[i].value.write(w);
+            }
+            w.endObject();
+            break;
+        default:
+            break;
+        }
+    }
+    inline void Node::encode(std::string &out) const
+    {
+        switch (_type)
+        {
+        case VALUE_BOOLEAN:
+            out += (char)(_u.b ? BINARY_TRUE : BINARY_FALSE);
+            break;
+        case VALUE_NUMBER:
+            if (_int)
+                encodeInt(_u.i, out);
+            else
+                encodeDouble(_u.d, out);
+            break;
+        case VALUE_STRING:
+            encodeString(_u.s, _size, out);
+            break;
+        case VALUE_ARRAY:
+            encodeHead(BINARY_ARRAY, _size, out);
+            for (size_t i = 0; i < _size; i++)
+                _u.items[i].encode(out);
+            break;
+        case VALUE_OBJECT:
+            encodeHead(BINARY_MAP, _size, out);
+            for (size_t i = 0; i < _size; i++)
+            {
+                encodeString(_u.members[i].key._u.s, _u.members[i].key._size, out);
+                _u.members[i].value.encode(out);
+            }
+            break;
+        default:
+            out += (char)BINARY_NULL;
+            break;
+        }
+    }
+    /*
+        \uXXXX中的4位十六进制
+    */
+    inline bool decodeHex4(const char *p, const char *end, unsigned &u)
+    {
+        if (end - p < 4)
+            return false;
+        u = 0;
+        for (int i = 0; i < 4; i++)
+        {
+            char ch = p[i];
+            u <<= 4;
+            if (ch >= '0' && ch <= '9')
+                u |= ch - '0';
+            else if (ch >= 'A' && ch <= 'F')
+                u |= ch - ('A' - 10);
+            else if (ch >= 'a' && ch <= 'f')
+                u |= ch - ('a' - 10);
+            else
+                return false;
+        }
+        return true;
+    }
+    /*
+        \uXXXX最多编码成4字节,不超过原文的6或12字节
+    */
+    inline char *encodeUtf8(char *w, unsigned u)
+    {
+        if (u <= 0x7F)
+            *w++ = (char)u;
+        else if (u <= 0x7FF)
+        {
+            *w++ = (char)(0xC0 | (u >> 6));
+            *w++ = (char)(0x80 | (u & 0x3F));
+        }
+        else if (u <= 0xFFFF)
+        {
+            *w++ = (char)(0xE0 | (u >> 12));
+            *w++ = (char)(0x80 | ((u >> 6) & 0x3F));
+            *w++ = (char)(0x80 | (u & 0x3F));
+        }
+        else
+        {
+            *w++ = (char)(0xF0 | (u >> 18));
+            *w++ = (char)(0x80 | ((u >> 12) & 0x3F));
+            *w++ = (char)(0x80 | ((u >> 6) & 0x3F));
+            *w++ = (char)(0x80 | (u & 0x3F));
+        }
+        return w;
+    }
+    /*
+        字符串内容[r,stop)反转义到w(结果不会比原文长),返回写入的结尾
+        调用方已排除未转义的引号和控制字符;转义非法时返回NULL,bad指向那个'\\'
+    */
+    inline char *unescapeString(const char *r, const char *stop, char *w, const char *&bad)
+    {
+        while (r < stop)
+        {
+            // 普通字节整段复制,只会停在'\\'
+            const char *q = scanString(r, stop);
+            memcpy(w, r, q - r);
+            w += q - r;
+            r = q;
+            if (r == stop)
+                break;
+            bad = r;
+            switch (*++r)
+            {
+            case '"':
+            case '\\':
+            case '/':
+                *w++ = *r++;
+                break;
+            case 'b':
+                *w++ = '\b', r++;
+                break;
+            case 'f':
+                *w++ = '\f', r++;
+                break;
+            case 'n':
+                *w++ = '\n', r++;
+                break;
+            case 'r':
+                *w++ = '\r', r++;
+                break;
+            case 't':
+                *w++ = '\t', r++;
+                break;
+            case 'u':
+            {
+                unsigned u;
+                if (!decodeHex4(++r, stop, u))
+                    return NULL;
+                r += 4;
+                if (u >= 0xD800 && u <= 0xDBFF)
+                {
+                    unsigned u2;
+                    if (stop - r < 6 || r[0] != '\\' || r[1] != 'u' || !decodeHex4(r + 2, stop, u2) || u2 < 0xDC00 || u2 > 0xDFFF)
+                        return NULL;
+                    r += 6;
+                    u = (((u - 0xD800) << 10) | (u2 - 0xDC00)) + 0x10000;
+                }
+                w = encodeUtf8(w, u);
+                break;
+            }
+            default:
+                return NULL;
+            }
+        }
+        return w;
+    }
+    /*
+        解析p处的数字,成功时p移到数字之后,isInt时结果在i,否则在d
+        能放进long long的整数直接累加(19位时检查溢出),其余交给strtod;失败时p指向出错位置
+    */
+    inline bool decodeNumber(const char *&p, const char *end, bool &isInt, long long int &i, double &d)
+    {
+        const char *start = p;
+        bool neg = false;
+        if (p < end && *p == '-')
+        {
+            neg = true;
+            ++p;
+        }
+        if (p == end || *p < '0' || *p > '9')
+            return false;
+        unsigned long long u = 0;
+        int digits = 0;
+        if (*p == '0')
+            ++p;
+        else
+        {
+            while (p < end && *p >= '0' && *p <= '9')
+            {
+                u = u * 10 + (*p++ - '0');
+                digits++;
+            }
+        }
+        isInt = !(p < end && (*p == '.' || *p == 'e' || *p == 'E'));
+        // 19位最大是9999999999999999999,不会让u溢出,只需和LLONG_MAX比较
+        if (isInt && (digits <= 18 || (digits == 19 && u <= (unsigned long long)LLONG_MAX + neg)))
+        {
+            i = neg ? (long long int)(0 - u) : (long long int)u;
+            return true;
+        }
+        while (p < end && ((*p >= '0' && *p <= '9') || *p == '.' || *p == 'e' || *p == 'E' || *p == '+' || *p == '-'))
+            ++p;
+        char buf[64];
+        size_t len = p - start;
+        if (len >= sizeof(buf) || (!isInt && (start[len - 1] < '0' || start[len - 1] > '9')))
+        {
+            p = start;
+            return false;
+        }
+        memcpy(buf, start, len);
+        buf[len] = '\0';
+        char *e;
+        d = strtod(buf, &e);
+        if (e != buf + len)
+        {
+            p = start;
+            return false;
+        }
+        isInt = false;
+        return true;
+    }
+    /*
+        一条消息的DOM,所有节点和反转义的字符串都在arena里,parse/clear时整体释放(O(1))
+        同一个Document反复parse,稳定后解析不再申请内存
+        解析遵循RFC 8259,顶层可以是任意值,数组元素类型可以不同
+    */
+    class Document
+    {
+    public:
+        Document(size_t block = 4096) : _begin(NULL), _p(NULL), _end(NULL), _arena(block)
+        {
+        }
+        Document(const Document &) = delete;
+        Document &operator=(const Document &) = delete;
+
+        /*
+            没有转义的字符串直接指向data,所以data在使用结果期间必须有效,
+            copy为true时先把输入复制到arena
+            失败抛出Exception,之前的结果失效
+        */
+        const Node &parse(const char *data, size_t len, bool copy = false)
+        {
+            clear();
+            if (copy)
+            {
+                char *buf = _arena.make<char>(len);
+                memcpy(buf, data, len);
+                data = buf;
+            }
+            _begin = _p = data;
+            _end = data + len;
+            _stack.clear();
+            parseValue(_root, 0);
+            whitespace();
+            if (_p != _end)
+                error();
+            return _root;
+        }
+        const Node &parse(const std::string &s, bool copy = false)
+        {
+            return parse(s.data(), s.size(), copy);
+        }
+        /*
+            解码二进制(binary.hpp),得到和parse一样的DOM
+            字符串带长度、不需要反转义,全部直接指向data,生命周期要求同parse
+        */
+        const Node &decode(const char *data, size_t len, bool copy = false)
+        {
+            clear();
+            if (copy)
+            {
+                char *buf = _arena.make<char>(len);
+                memcpy(buf, data, len);
+                data = buf;
+            }
+            _begin = _p = data;
+            _end = data + len;
+            _stack.clear();
+            decodeValue(_root, 0);
+            if (_p != _end)
+                error();
+            return _root;
+        }
+        const Node &decode(const std::string &s, bool copy = false)
+        {
+            return decode(s.data(), s.size(), copy);
+        }
+        const Node &root() const
+        {
+            return _root;
+        }
+        void clear()
+        {
+            _arena.clear();
+            _root = Node();
+        }
+        const Arena &arena() const
+        {
+            return _arena;
+        }
+
+    private:
+        void error()
+        {
+            int index = (int)(_p - _begin);
+            PARSEERROR(_begin, index);
+        }
+        void whitespace()
+        {
+            _p = skipSpace(_p, _end);
+        }
+        void parseValue(Node &out, int depth)
+        {
+            whitespace();
+            if (_p == _end || depth > JSONDEPTH)
+                error();
+            switch (*_p)
+            {
+            case '{':
+                parseObject(out, depth);
+                break;
+            case '[':
+                parseArray(out, depth);
+                break;
+            case '"':
+                parseString(out);
+                break;
+            case 't':
+                literal("true", 4);
+                out._type = VALUE_BOOLEAN;
+                out._u.b = true;
+                break;
+            case 'f':
+                literal("false", 5);
+                out._type = VALUE_BOOLEAN;
+                out._u.b = false;
+                break;
+            case 'n':
+                literal("null", 4);
+                out = Node();
+                break;
+            default:
+                parseNumber(out);
+                break;
+            }
+        }
+        void literal(const char *s, size_t n)
+        {
+            if ((size_t)(_end - _p) < n || memcmp(_p, s, n) != 0)
+                error();
+            _p += n;
+        }
+        /*
+            子节点先压在_stack上,结束时一次复制到arena里的连续数组
+        */
+        void parseArray(Node &out, int depth)
+        {
+            ++_p;
+            size_t base = _stack.size();
+            whitespace();
+            if (_p < _end && *_p == ']')
+                ++_p;
+            else
+            {
+                while (1)
+                {
+                    Node item;
+                    parseValue(item, depth + 1);
+                    _stack.push_back(item);
+                    whitespace();
+                    if (_p == _end)
+                        error();
+                    if (*_p == ',')
+                    {
+                        ++_p;
+                        continue;
+                    }
+                    if (*_p != ']')
+                        error();
+                    ++_p;
+                    break;
+                }
+            }
+            makeArray(out, base);
+        }
+        void parseObject(Node &out, int depth)
+        {
+            ++_p;
+            size_t base = _stack.size();
+            whitespace();
+            if (_p < _end && *_p == '}')
+                ++_p;
+            else
+            {
+                while (1)
+                {
+                    Node key, value;
+                    whitespace();
+                    if (_p == _end || *_p != '"')
+                        error();
+                    parseString(key);
+                    whitespace();
+                    if (_p == _end || *_p != ':')
+                        error();
+                    ++_p;
+                    parseValue(value, depth + 1);
+                    _stack.push_back(key);
+                    _stack.push_back(value);
+                    whitespace();
+                    if (_p == _end)
+                        error();
+                    if (*_p == ',')
+                    {
+                        ++_p;
+                        continue;
+                    }
+                    if (*_p != '}')
+                        error();
+                    ++_p;
+                    break;
+                }
+            }
+            makeObject(out, base);
+        }
+        /*
+            _stack中base之后的节点移到arena
+        */
+        void makeArray(Node &out, size_t base)
+        {
+            size_t n = _stack.size() - base;
+            out._type = VALUE_ARRAY;
+            out._size = (uint32_t)n;
+            out._u.items = _arena.make<Node>(n);
+            std::copy(_stack.begin() + base, _stack.end(), out._u.items);
+            _stack.resize(base);
+        }
+        void makeObject(Node &out, size_t base)
+        {
+            size_t n = (_stack.size() - base) / 2;
+            out._type = VALUE_OBJECT;
+            out._size = (uint32_t)n;
+            out._u.members = _arena.make<Member>(n);
+            for (size_t i = 0; i < n; i++)
+            {
+                out._u.members[i].key = _stack[base + i * 2];
+                out._u.members[i].value = _stack[base + i * 2 + 1];
+            }
+            _stack.resize(base);
+        }
+        /*
+            没有转义的直接指向输入;有转义的先找到结尾,再反转义到arena
+            两遍都用scanString成段跳过普通字节
+        */
+        void parseString(Node &out)
+        {
+            const char *start = ++_p;
+            bool escaped = false;
+            while (1)
+            {
+                _p = scanString(_p, _end);
+                if (_p == _end)
+                    error();
+                unsigned char ch = (unsigned char)*_p;
+                if (ch == '"')
+                    break;
+                if (ch < 0x20)
+                    error();
+                escaped = true;
+                if (++_p == _end)
+                    error();
+                ++_p;
+            }
+            const char *stop = _p++;
+            out._type = VALUE_STRING;
+            if (!escaped)
+            {
+                out._u.s = start;
+                out._size = (uint32_t)(stop - start);
+                return;
+            }
+            char *buf = _arena.make<char>(stop - start);
+            const char *bad;
+            char *w = unescapeString(start, stop, buf, bad);
+            if (w == NULL)
+            {
+                _p = bad; // 报告转义的位置
+                error();
+            }
+            _p = stop + 1;
+            out._u.s = buf;
+            out._size = (uint32_t)(w - buf);
+        }
+        void parseNumber(Node &out)
+        {
+            bool isInt;
+            if (!decodeNumber(_p, _end, isInt, out._u.i, out._u.d))
+                error();
+            out._type = VALUE_NUMBER;
+            out._int = isInt;
+        }
+        void decodeValue(Node &out, int depth)
+        {
+            if (depth > JSONDEPTH || _p == _end)
+                error();
+            unsigned major = (unsigned char)*_p >> 5;
+            if (major != BINARY_ARRAY && major != BINARY_MAP)
+            {
+                // 字节串和标签在JSON里没有对应
+                if (!decodeBinaryScalar(_p, _end, out))
+                    error();
+                return;
+            }
+            const char *at = _p;
+            unsigned info;
+            uint64_t arg;
+            if (!decodeHead(_p, _end, major, info, arg))
+                error();
+            if (major == BINARY_ARRAY)
+            {
+                // 定长时每个元素至少1字节,先挡住伪造的超大个数
+                if (info != BINARY_INDEFINITE && arg > (uint64_t)(_end - _p))
+                {
+                    _p = at;
+                    error();
+                }
+                size_t base = _stack.size();
+                while (info == BINARY_INDEFINITE ? !decodeBreak() : _stack.size() - base < arg)
+                {
+                    Node item;
+                    decodeValue(item, depth + 1);
+                    _stack.push_back(item);
+                }
+                makeArray(out, base);
+                return;
+            }
+            if (info != BINARY_INDEFINITE && arg > (uint64_t)(_end - _p) / 2)
+            {
+                _p = at;
+                error();
+            }
+            size_t base = _stack.size();
+            while (info == BINARY_INDEFINITE ? !decodeBreak() : (_stack.size() - base) / 2 < arg)
+            {
+                Node key, value;
+                const char *k = _p;
+                decodeValue(key, depth + 1);
+                if (key._type != VALUE_STRING)
+                {
+                    _p = k;
+                    error();
+                }
+                decodeValue(value, depth + 1);
+                _stack.push_back(key);
+                _stack.push_back(value);
+            }
+            makeObject(out, base);
+        }
+        bool decodeBreak()
+        {
+            if (_p == _end)
+                error();
+            if ((unsigned char)*_p != BINARY_BREAK)
+                return false;
+            ++_p;
+            return true;
+        }
+
+    private:
+        const char *_begin;
+        const char *_p;
+        const char *_end;
+        Arena _arena;
+        std::vector<Node> _stack; // 解析中的子节点,容量保留复用
+        Node _root;
+    };
+}
@@ -1,10 +1,16 @@
+#pragma once
 #include <iostream>
 #include <string>
 #include <vector>
 #include <memory>
 #include <unordered_map>
+#include <climits>
+#include "simd.hpp"
+#include "writer.hpp"
+#include "binary.hpp"
 namespace json
 {
+#define JSONDEPTH 512 // 嵌套层数上限,防止恶意输入把栈打爆
 #define PARSEERROR(str, index)                                                                                   \
     do                                                                                                           \
     {                                                                                                            \
@@ -83,8 +89,18 @@ namespace json
             {
                 return _type;
             }
-            virtual std::string getString() const = 0;
-            virtual std::string formatString() const = 0;
+            /*
+             * escape为false时字符串不转义(getString)
+             */
+            virtual void write(Writer &w, bool escape) const = 0;
+            /*
+             * 二进制编码,见binary.hpp
+             */
+            virtual void encode(std::string &out) const = 0;
+            /*
+             * 深拷贝
+             */
+            virtual value_value_ptr clone() const = 0;
 
         protected:
             value_value(value_type type) : _type(type) {}
@@ -96,13 +112,17 @@ namespace json
             value_null() : value_value(VALUE_NULL)
             {
             }
-            std::string getString() const override
+            void write(Writer &w, bool /*escape*/) const override
             {
-                return "null";
+                w.null();
             }
-            virtual std::string formatString() const override
+            void encode(std::string &out) const override
             {
-                return "null";
+                out += (char)BINARY_NULL;
+            }
+            value_value_ptr clone() const override
+            {
+                return value_value_ptr(new value_null());
             }
         };
         class value_boolean : public value_value
@@ -111,19 +131,17 @@ namespace json
             value_boolean(bool v) : value_value(VALUE_BOOLEAN), _value(v)
             {
             }
-            std::string getString() const override
+            void write(Writer &w, bool /*escape*/) const override
             {
-                if (_value)
-                    return "true";
-                else
-                    return "false";
+                w.boolean(_value);
             }
-            std::string formatString() const override
+            void encode(std::string &out) const override
             {
-                if (_value)
-                    return "true";
-                else
-                    return "false";
+                out += (char)(_value ? BINARY_TRUE : BINARY_FALSE);
+            }
+            value_value_ptr clone() const override
+            {
+                return value_value_ptr(new value_boolean(_value));
             }
 
         private:
@@ -140,13 +158,23 @@ namespace json
             {
                 _value.intV = v;
             }
-            std::string getString() const override
+            void write(Writer &w, bool /*escape*/) const override
+            {
+                if (isInt)
+                    w.number(_value.intV);
+                else
+                    w.number(_value.doubleV);
+            }
+            void encode(std::string &out) const override
             {
-                return toString();
+                if (isInt)
+                    encodeInt(_value.intV, out);
+                else
+                    encodeDouble(_value.doubleV, out);
             }
-            virtual std::string formatString() const override
+            value_value_ptr clone() const override
             {
-                return toString();
+                return value_value_ptr(new value_number(*this));
             }
             long long int toInt() const
             {
@@ -162,22 +190,6 @@ namespace json
             }
 
         private:
-            std::string toString() const
-            {
-                std::string ret;
-                if (isInt)
-                {
-                    long long int v = _value.intV;
-                    do
-                    {
-                        ret += ((v % 10) + '0');
-                        v /= 10;
-                    } while (v);
-                }
-                else
-                    ret = std::to_string(_value.doubleV);
-                return ret;
-            }
             union
             {
                 long long int intV;
@@ -191,19 +203,24 @@ namespace json
             value_string(const std::string &v) : value_value(VALUE_STRING), _value(v)
             {
             }
-            value_string(std::string &&v) : value_value(VALUE_STRING), _value(v)
+            value_string(std::string &&v) : value_value(VALUE_STRING), _value(std::move(v))
             {
             }
-            std::string getString() const override
+            void write(Writer &w, bool escape) const override
             {
-                return std::string("\"" + _value + "\"");
+                w.string(_value.data(), _value.size(), escape);
             }
-            std::string formatString() const override
+            void encode(std::string &out) const override
             {
-                std::string ret("\"");
-                decode_string(_value, ret);
-                ret += "\"";
-                return ret;
+                encodeString(_value.data(), _value.size(), out);
+            }
+            value_value_ptr clone() const override
+            {
+                return value_value_ptr(new value_string(_value));
+            }
+            const std::string &getText() const
+            {
+                return _value;
             }
 
         private:
@@ -219,32 +236,44 @@ namespace json
             value_array(const std::vector<value> &v) : value_value(VALUE_ARRAY), _value(v)
             {
             }
-            std::string getString() const override
+            void write(Writer &w, bool escape) const override
             {
-                std::string s("[");
-                for (int i = 0; i < _value.size(); i++)
-                {
-                    s += _value[i].getString() + ',';
-                }
-                if (s.size() > 1)
-                    s[s.size() - 1] = ']';
-                return s;
+                w.startArray();
+                for (size_t i = 0; i < _value.size(); i++)
+                    _value[i]._value->write(w, escape);
+                w.endArray();
             }
-            std::string formatString() const override
+            void encode(std::string &out) const override
             {
-                std::string s("[");
-                for (int i = 0; i < _value.size(); i++)
-                {
-                    s += _value[i].formatString() + ',';
-                }
-                if (s.size() > 1)
-                    s[s.size() - 1] = ']';
-                return s;
+                encodeHead(BINARY_ARRAY, _value.size(), out);
+                for (size_t i = 0; i < _value.size(); i++)
+                    _value[i]._value->encode(out);
+            }
+            value_value_ptr clone() const override
+            {
+                std::vector<value> v;
+                v.reserve(_value.size());
+                for (size_t i = 0; i < _value.size(); i++)
+                    v.push_back(_value[i].clone());
+                return value_value_ptr(new value_array(std::move(v)));
             }
             value &operator[](int index)
             {
                 return _value.at(index); // 越界抛出异常
             }
+            const value &at(int index) const
+            {
+                return _value.at(index);
+            }
+            value &emplace_back(value &&v)
+            {
+                _value.push_back(std::move(v));
+                return _value.back();
+            }
+            size_t size() const
+            {
+                return _value.size();
+            }
             void push(const std::string &str)
             {
                 int index = 0;
@@ -294,39 +323,60 @@ namespace json
             {
                 _value.swap(v);
             }
-            std::string getString() const override
+            void write(Writer &w, bool escape) const override
             {
-                std::string s = (std::string) "{" + " ";
+                w.startObject();
                 for (auto it = _value.begin(); it != _value.end(); it++)
                 {
-                    if (it != _value.begin())
-                        s += ',';
-                    s += ("\"" + it->first + "\"" + " : " + it->second.getString());
+                    if (escape)
+                        w.key(it->first);
+                    else
+                    {
+                        w.string(it->first.data(), it->first.size(), false);
+                        w.buffer() += ':';
+                    }
+                    it->second._value->write(w, escape);
                 }
-                s += "}";
-                return s;
+                w.endObject();
             }
-            std::string formatString() const override
+            void encode(std::string &out) const override
             {
-                std::string s = (std::string) "{" + " ";
+                encodeHead(BINARY_MAP, _value.size(), out);
                 for (auto it = _value.begin(); it != _value.end(); it++)
                 {
-                    std::string name;
-                    decode_string(it->first, name);
-                    if (it != _value.begin())
-                        s += ',';
-                    s += ("\"" + name + "\"" + " : " + it->second.formatString());
+                    encodeString(it->first.data(), it->first.size(), out);
+                    it->second._value->encode(out);
                 }
-                s += "}";
-                return s;
+            }
+            value_value_ptr clone() const override
+            {
+                std::unordered_map<std::string, value> v;
+                v.reserve(_value.size());
+                for (auto it = _value.begin(); it != _value.end(); it++)
+                    v.emplace(it->first, it->second.clone());
+                return value_value_ptr(new value_object(std::move(v)));
+            }
+            /*
+             * 不插入,不存在时返回NULL
+             */
+            const value *find(const std::string &str) const
+            {
+                auto it = _value.find(str);
+                return it == _value.end() ? NULL : &it->second;
+            }
+            size_t size() const
+            {
+                return _value.size();
             }
             value &operator[](const std::string &str)
             {
-                if (_value.find(str) == _value.end())
-                {
-                    _value[str] = value();
-                }
-                return _value[str];
+                return _value[str]; // 不存在时插入null
+            }
+            value &emplace(std::string &&key, value &&v)
+            {
+                value &slot = _value[std::move(key)];
+                slot = std::move(v);
+                return slot;
             }
 
         private:
@@ -346,13 +396,87 @@ namespace json
         value(const value& v){
             _value=v._value;
         }
+        /*
+         * 移走后原值是null
+         */
+        value(value &&v) noexcept : _value(std::move(v._value))
+        {
+            v._value = null()._value;
+        }
+        value &operator=(const value &v)
+        {
+            _value = v._value;
+            return *this;
+        }
+        value &operator=(value &&v) noexcept
+        {
+            if (this != &v)
+            {
+                _value = std::move(v._value);
+                v._value = null()._value;
+            }
+            return *this;
+        }
+        /*
+         * 字符串不转义,仅供查看
+         */
         std::string getString() const
         {
-            return _value->getString();
+            std::string s;
+            Writer w(s);
+            _value->write(w, false);
+            return s;
         }
+        /*
+         * 紧凑格式的JSON
+         */
         std::string formatString() const
         {
-            return _value->formatString();
+            std::string s;
+            format(s);
+            return s;
+        }
+        /*
+         * 追加到out,不产生中间字符串
+         */
+        void format(std::string &out) const
+        {
+            Writer w(out);
+            _value->write(w, true);
+        }
+        void write(Writer &w) const
+        {
+            _value->write(w, true);
+        }
+        /*
+         * 二进制编码,追加到out
+         */
+        void encode(std::string &out) const
+        {
+            _value->encode(out);
+        }
+        std::string toBinary() const
+        {
+            std::string s;
+            encode(s);
+            return s;
+        }
+        /*
+         * 从二进制解码,规则和文本解析一致(数组元素类型必须相同,键重复取最后一个)
+         */
+        static value decode(const char *data, size_t len)
+        {
+            const char *p = data;
+            value v(decode_value(data, p, data + len, 0));
+            if (p != data + len)
+            {
+                PARSEERROR(data, (int)(p - data));
+            }
+            return v;
+        }
+        static value decode(const std::string &s)
+        {
+            return decode(s.data(), s.size());
         }
         value_type getType() const
         {
@@ -362,7 +486,7 @@ namespace json
         {
             _value = v;
         }
-        long long int toInt()
+        long long int toInt() const
         {
             switch (_value->getType())
             {
@@ -373,7 +497,7 @@ namespace json
                 break;
             }
         }
-        double toDouble()
+        double toDouble() const
         {
             switch (_value->getType())
             {
@@ -384,9 +508,74 @@ namespace json
                 break;
             }
         }
-        std::string toString()
+        std::string toString() const
+        {
+            return getString();
+        }
+        /*
+         * 取字符串原文(不带引号,已反转义)
+         */
+        std::string toText() const
+        {
+            switch (_value->getType())
+            {
+            case VALUE_STRING:
+                return (dynamic_cast<value_string *>(_value.get())->getText());
+            default:
+                TRANSFORMERROR(_value->getType(), VALUE_STRING);
+                break;
+            }
+        }
+        /*
+         * 深拷贝,结果和原值不再共享任何节点
+         */
+        value clone() const
+        {
+            return value(_value->clone());
+        }
+        /*
+         * 以下const访问不插入键、不改类型:
+         * 不存在的键、越界或类型不对时返回null值
+         */
+        const value *find(const std::string &str) const
+        {
+            if (_value->getType() != VALUE_OBJECT)
+                return NULL;
+            return static_cast<const value_object *>(_value.get())->find(str);
+        }
+        const value &operator[](const std::string &str) const
+        {
+            const value *v = find(str);
+            return v ? *v : null();
+        }
+        const value &operator[](int index) const
+        {
+            if (_value->getType() != VALUE_ARRAY)
+                return null();
+            const value_array *a = static_cast<const value_array *>(_value.get());
+            if (index < 0 || (size_t)index >= a->size())
+                return null();
+            return a->at(index);
+        }
+        /*
+         * 数组/对象的元素个数,其余为0
+         */
+        size_t size() const
+        {
+            switch (_value->getType())
+            {
+            case VALUE_ARRAY:
+                return static_cast<const value_array *>(_value.get())->size();
+            case VALUE_OBJECT:
+                return static_cast<const value_object *>(_value.get())->size();
+            default:
+                return 0;
+            }
+        }
+        static const value &null()
         {
-            return _value->getString();
+            static const value v;
+            return v;
         }
         value &operator[](const std::string &str)
         {
@@ -395,20 +584,19 @@ namespace json
             case VALUE_OBJECT:
                 break;
             default:
-                this->reSet(parse_json("{}"));
+                set_object();
                 break;
             }
             return (*dynamic_cast<value_object *>(_value.get()))[str];
         }
         value &operator[](int index)
         {
-            int s = 0;
             switch (_value->getType())
             {
             case VALUE_ARRAY:
                 break;
             default:
-                this->reSet(parse_array("[]", s));
+                set_array();
                 break;
             }
             return (*dynamic_cast<value_array *>(_value.get()))[index];
@@ -429,40 +617,141 @@ namespace json
             _value = value_value_ptr(new value_number(v));
         }
         /*
-         * 会自动类型转换
+         * 会自动类型转换:参数按JSON文本解析,等同set_raw_json
+         * 要存普通字符串用set_string
          */
         void operator=(const std::string &v)
         {
-            int index = 0;
-            _value = value_value_ptr(parse_value(v, index));
-            if (index != v.size())
-            {
-                PARSEERROR(v, 0);
-            }
+            set_raw_json(v);
         }
         /*
          * 仅限array值类型使用否则会发生类型转换
-         * 应传入适合的数据
+         * 应传入适合的数据(按JSON文本解析,类型要和第一个元素相同)
          */
         void push(const std::string &str)
         {
-            int index = 0;
             switch (_value->getType())
             {
             case VALUE_ARRAY:
                 break;
             default:
-                this->reSet(parse_array("[]", index));
+                set_array();
                 break;
             }
             dynamic_cast<value_array *>(_value.get())->push(str);
         }
+        /*
+         * 以下按类型直接建节点,不经过解析器,返回自身便于连写
+         */
+        value &set_null()
+        {
+            _value = null()._value;
+            return *this;
+        }
+        value &set_bool(bool v)
+        {
+            _value = value_value_ptr(new value_boolean(v));
+            return *this;
+        }
+        value &set_int(long long int v)
+        {
+            _value = value_value_ptr(new value_number(v));
+            return *this;
+        }
+        value &set_double(double v)
+        {
+            _value = value_value_ptr(new value_number(v));
+            return *this;
+        }
+        /*
+         * 原样保存,任何文本都可以,序列化时再转义
+         */
+        value &set_string(const std::string &v)
+        {
+            _value = value_value_ptr(new value_string(v));
+            return *this;
+        }
+        value &set_string(std::string &&v)
+        {
+            _value = value_value_ptr(new value_string(std::move(v)));
+            return *this;
+        }
+        value &set_string(const char *s, size_t len)
+        {
+            _value = value_value_ptr(new value_string(std::string(s, len)));
+            return *this;
+        }
+        value &set_string(const char *s)
+        {
+            return set_string(s, strlen(s));
+        }
+        /*
+         * 空数组/空对象
+         */
+        value &set_array()
+        {
+            _value = value_value_ptr(new value_array(std::vector<value>()));
+            return *this;
+        }
+        value &set_object()
+        {
+            _value = value_value_ptr(new value_object(std::unordered_map<std::string, value>()));
+            return *this;
+        }
+        /*
+         * 明确要解析JSON文本时用,格式错误抛出Exception
+         */
+        value &set_raw_json(const std::string &v)
+        {
+            int index = 0;
+            value_value_ptr parsed = parse_value(v, index);
+            if (index != (int)v.size())
+            {
+                PARSEERROR(v, 0);
+            }
+            _value = std::move(parsed);
+            return *this;
+        }
+        /*
+         * 追加一个元素(不是数组时先变成空数组),返回新元素;
+         * 不检查和已有元素的类型是否相同
+         */
+        value &emplace_back(value &&v)
+        {
+            if (_value->getType() != VALUE_ARRAY)
+                set_array();
+            return dynamic_cast<value_array *>(_value.get())->emplace_back(std::move(v));
+        }
+        value &emplace_back(const value &v)
+        {
+            return emplace_back(value(v));
+        }
+        /*
+         * 追加一个null元素,之后用set_*填
+         */
+        value &emplace_back()
+        {
+            return emplace_back(value());
+        }
+        /*
+         * 设置成员(不是对象时先变成空对象),键已存在则替换,返回成员
+         */
+        value &emplace(std::string key, value &&v)
+        {
+            if (_value->getType() != VALUE_OBJECT)
+                set_object();
+            return dynamic_cast<value_object *>(_value.get())->emplace(std::move(key), std::move(v));
+        }
+        value &emplace(std::string key, const value &v)
+        {
+            return emplace(std::move(key), value(v));
+        }
 
     private:
         static void whitespace(const std::string &s, int &index)
         {
-            while (s[index] == ' ' || s[index] == '\t' || s[index] == '\n' || s[index] == '\r')
-                ++index;
+            const char *p = s.data() + index;
+            index += (int)(skipSpace(p, s.data() + s.size()) - p);
         }
         static bool parse_hex4(const std::string &s, int &index, unsigned &u)
         {
@@ -506,62 +795,16 @@ namespace json
                 s += (0x80 | (u & 0x3F));
             }
         }
-        static void decode_string(const std::string &str, std::string &ret)
-        {
-            static const char hex_digits[] = {'0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A', 'B', 'C', 'D', 'E', 'F'};
-            for (int i = 0; i < str.size(); ++i)
-            {
-                unsigned char ch = (unsigned char)str[i];
-                switch (ch)
-                {
-                case '\"':
-                    ret += '\\';
-                    ret += '\"';
-                    break;
-                case '\\':
-                    ret += '\\';
-                    ret += '\\';
-                    break;
-                case '\b':
-                    ret += '\\';
-                    ret += 'b';
-                    break;
-                case '\f':
-                    ret += '\\';
-                    ret += 'f';
-                    break;
-                case '\n':
-                    ret += '\\';
-                    ret += 'n';
-                    break;
-                case '\r':
-                    ret += '\\';
-                    ret += 'r';
-                    break;
-                case '\t':
-                    ret += '\\';
-                    ret += 't';
-                    break;
-                default:
-                    if (ch < 0x20)
-                    {
-                        ret += '\\';
-                        ret += 'u';
-                        ret += '0';
-                        ret += '0';
-                        ret += hex_digits[ch >> 4];
-                        ret += hex_digits[ch & 15];
-                    }
-                    else
-                        ret += str[i];
-                }
-            }
-        }
         static bool parse_text(const std::string &s, int &index, std::string &ret)
         {
             unsigned u1, u2;
             for (;;)
             {
+                // 不需要处理的一段整体追加
+                const char *p = s.data() + index;
+                const char *q = scanString(p, s.data() + s.size());
+                ret.append(p, q - p);
+                index += (int)(q - p);
                 char ch = s[index++];
                 switch (ch)
                 {
@@ -846,6 +1089,97 @@ namespace json
             }
             whitespace(s, index);
         }
+        /*
+         * 二进制的一个值,begin只用来报告位置
+         */
+        static value_value_ptr decode_value(const char *begin, const char *&p, const char *end, int depth)
+        {
+            const char *at = p;
+            unsigned major, info;
+            uint64_t arg;
+            if (depth > JSONDEPTH || !decodeHead(p, end, major, info, arg))
+            {
+                PARSEERROR(begin, (int)(at - begin));
+            }
+            switch (major)
+            {
+            case BINARY_UINT:
+                if (arg > (uint64_t)LLONG_MAX)
+                    return value_value_ptr(new value_number((double)arg));
+                return value_value_ptr(new value_number((long long int)arg));
+            case BINARY_NEGINT:
+                if (arg > (uint64_t)LLONG_MAX)
+                    return value_value_ptr(new value_number(-1.0 - (double)arg));
+                return value_value_ptr(new value_number(-1 - (long long int)arg));
+            case BINARY_TEXT:
+                if (info == BINARY_INDEFINITE || arg > (uint64_t)(end - p))
+                    break;
+                p += arg;
+                return value_value_ptr(new value_string(std::string(p - arg, arg)));
+            case BINARY_ARRAY:
+            {
+                std::vector<value> v;
+                while (info == BINARY_INDEFINITE ? !decode_break(begin, p, end) : v.size() < arg)
+                {
+                    const char *item = p;
+                    v.push_back(value(decode_value(begin, p, end, depth + 1)));
+                    if (v.back().getType() != v[0].getType())
+                    {
+                        PARSEERROR(begin, (int)(item - begin));
+                    }
+                }
+                return value_value_ptr(new value_array(std::move(v)));
+            }
+            case BINARY_MAP:
+            {
+                std::unordered_map<std::string, value> v;
+                for (uint64_t i = 0; info == BINARY_INDEFINITE ? !decode_break(begin, p, end) : i < arg; i++)
+                {
+                    const char *key = p;
+                    value name(decode_value(begin, p, end, depth + 1));
+                    if (name.getType() != VALUE_STRING)
+                    {
+                        PARSEERROR(begin, (int)(key - begin));
+                    }
+                    v[name.toText()] = value(decode_value(begin, p, end, depth + 1));
+                }
+                return value_value_ptr(new value_object(std::move(v)));
+            }
+            case BINARY_SIMPLE:
+                switch (info)
+                {
+                case BINARY_FALSE & 31:
+                    return value_value_ptr(new value_boolean(false));
+                case BINARY_TRUE & 31:
+                    return value_value_ptr(new value_boolean(true));
+                case BINARY_NULL & 31:
+                    return value_value_ptr(new value_null());
+                case BINARY_FLOAT & 31:
+                case BINARY_DOUBLE & 31:
+                    return value_value_ptr(new value_number(decodeFloat(arg, info)));
+                default:
+                    break;
+                }
+                break;
+            default:
+                break;
+            }
+            PARSEERROR(begin, (int)(at - begin));
+        }
+        /*
+         * 不定长数组和对象的结尾
+         */
+        static bool decode_break(const char *begin, const char *&p, const char *end)
+        {
+            if (p == end)
+            {
+                PARSEERROR(begin, (int)(p - begin));
+            }
+            if ((unsigned char)*p != BINARY_BREAK)
+                return false;
+            ++p;
+            return true;
+        }
         static value_value_ptr parse_json(const std::string &s, int *index = NULL)
         {
             int l = 0;
@@ -865,14 +1199,161 @@ namespace json
     private:
         value_value_ptr _value;
     };
+    /*
+     * 冻结的值:构造时深拷贝并序列化一次,之后只读
+     * 拷贝只增加引用计数,不加锁,可以交给任意线程;原value之后再改也不影响它
+     * 访问返回只读的node而不是value:value的拷贝共享节点,拿到value就能改冻结的树
+     */
+    class snapshot
+    {
+        struct body;
+
+    public:
+        /*
+         * 冻结树中一个节点的只读句柄,没有修改操作,只在snapshot存活期间有效
+         * 要修改用clone()得到独立的value
+         */
+        class node
+        {
+        public:
+            value_type getType() const
+            {
+                return _v->getType();
+            }
+            node operator[](const std::string &str) const
+            {
+                return node((*_v)[str]);
+            }
+            node operator[](int index) const
+            {
+                return node((*_v)[index]);
+            }
+            bool contains(const std::string &str) const
+            {
+                return _v->find(str) != NULL;
+            }
+            size_t size() const
+            {
+                return _v->size();
+            }
+            long long int toInt() const
+            {
+                return _v->toInt();
+            }
+            double toDouble() const
+            {
+                return _v->toDouble();
+            }
+            std::string toString() const
+            {
+                return _v->toString();
+            }
+            std::string toText() const
+            {
+                return _v->toText();
+            }
+            std::string getString() const
+            {
+                return _v->getString();
+            }
+            std::string formatString() const
+            {
+                return _v->formatString();
+            }
+            void format(std::string &out) const
+            {
+                _v->format(out);
+            }
+            void write(Writer &w) const
+            {
+                _v->write(w);
+            }
+            void encode(std::string &out) const
+            {
+                _v->encode(out);
+            }
+            std::string toBinary() const
+            {
+                return _v->toBinary();
+            }
+            value clone() const
+            {
+                return _v->clone();
+            }
+
+        private:
+            friend class snapshot;
+            explicit node(const value &v) : _v(&v)
+            {
+            }
+            const value *_v;
+        };
+
+        snapshot() : _body(std::make_shared<body>(value()))
+        {
+        }
+        explicit snapshot(const value &v) : _body(std::make_shared<body>(v.clone()))
+        {
+        }
+        explicit snapshot(const node &n) : _body(std::make_shared<body>(n.clone()))
+        {
+        }
+        node root() const
+        {
+            return node(_body->root);
+        }
+        value_type getType() const
+        {
+            return _body->root.getType();
+        }
+        node operator[](const std::string &str) const
+        {
+            return node(_body->root[str]);
+        }
+        node operator[](int index) const
+        {
+            return node(_body->root[index]);
+        }
+        /*
+         * 紧凑格式的JSON,构造时生成
+         */
+        const std::string &text() const
+        {
+            return _body->text;
+        }
+        /*
+         * 单独共享序列化结果,和snapshot共用一个引用计数
+         */
+        std::shared_ptr<const std::string> shared() const
+        {
+            return std::shared_ptr<const std::string>(_body, &_body->text);
+        }
+        long useCount() const
+        {
+            return _body.use_count();
+        }
+
+    private:
+        struct body
+        {
+            explicit body(const value &v) : root(v)
+            {
+                root.format(text);
+            }
+            value root;
+            std::string text;
+        };
+        std::shared_ptr<const body> _body;
+    };
     class json
     {
     public:
         json(const std::string &jsonStr) : _value(value::parse_json(jsonStr))
         {
         }
-        json() : _value(value::parse_json("{}"))
+        json()
         {
+            _value.set_object();
         }
         std::string toString()
         {
@@ -882,6 +1363,10 @@ namespace json
         {
             return _value.formatString();
         }
+        snapshot freeze() const
+        {
+            return snapshot(_value);
+        }
         void operator=(const std::string &jsonStr)
         {
             _value.reSet(value::parse_json(jsonStr));
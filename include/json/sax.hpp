@@ -0,0 +1,749 @@
+#pragma once
+#include <string>
+#include <cstring>
+#include <stdint.h>
+#include "document.hpp"
+
+namespace json
+{
+    /*
+        SAX回调的默认实现:全部忽略并继续,继承后只覆盖关心的(Reader按模板调用,不需要虚函数)
+        任何回调返回false,解析立即停止
+        键和字符串不以'\0'结尾,只在回调期间有效
+    */
+    struct Handler
+    {
+        bool startObject()
+        {
+            return true;
+        }
+        bool endObject(size_t /*members*/)
+        {
+            return true;
+        }
+        bool startArray()
+        {
+            return true;
+        }
+        bool endArray(size_t /*items*/)
+        {
+            return true;
+        }
+        bool key(const char * /*s*/, size_t /*len*/)
+        {
+            return true;
+        }
+        bool string(const char * /*s*/, size_t /*len*/)
+        {
+            return true;
+        }
+        /*
+            能放进long long的整数,更大的按real报告
+        */
+        bool integer(long long int /*v*/)
+        {
+            return true;
+        }
+        bool real(double /*v*/)
+        {
+            return true;
+        }
+        bool boolean(bool /*v*/)
+        {
+            return true;
+        }
+        bool null()
+        {
+            return true;
+        }
+    };
+    /*
+        pick的一个字段:调用前填key,之后看found/value/text
+    */
+    struct Field
+    {
+        const char *key;
+        bool found;
+        Node value;       // 标量的值;对象和数组不解码,是null
+        const char *text; // 值的原文(字符串带引号),指向输入
+        size_t size;
+    };
+    /*
+        不建DOM的解析:parse把事件交给Handler,pick只取顶层对象的几个字段
+        decode/pickBinary对二进制编码(binary.hpp)做同样的事,字符串总是指向输入
+        没有转义的字符串直接指向输入,有转义的反转义到内部arena,下一次parse/pick时失效
+        提前停止时后面的输入不做检查
+    */
+    class Reader
+    {
+    public:
+        Reader(size_t block = 1024) : _begin(NULL), _p(NULL), _end(NULL), _arena(block)
+        {
+        }
+        Reader(const Reader &) = delete;
+        Reader &operator=(const Reader &) = delete;
+
+        /*
+            完整解析返回true,handler要求停止返回false,格式错误抛出Exception
+        */
+        template <class H>
+        bool parse(const char *data, size_t len, H &handler)
+        {
+            start(data, len);
+            if (!value(handler, 0))
+                return false;
+            _p = skipSpace(_p, _end);
+            if (_p != _end)
+                error();
+            return true;
+        }
+        template <class H>
+        bool parse(const std::string &s, H &handler)
+        {
+            return parse(s.data(), s.size(), handler);
+        }
+        /*
+            在顶层对象里找fields中的键,全部找到就停止,其余的值只跳过不解码
+            键重复时取第一个;返回找到的个数
+        */
+        size_t pick(const char *data, size_t len, Field *fields, size_t n)
+        {
+            start(data, len);
+            for (size_t i = 0; i < n; i++)
+            {
+                fields[i].found = false;
+                fields[i].value = Node();
+                fields[i].text = NULL;
+                fields[i].size = 0;
+            }
+            size_t found = 0;
+            _p = skipSpace(_p, _end);
+            expect('{');
+            _p = skipSpace(_p, _end);
+            if (_p < _end && *_p == '}')
+                return 0;
+            while (found < n)
+            {
+                _p = skipSpace(_p, _end);
+                expect('"');
+                const char *key;
+                size_t keyLen;
+                string(key, keyLen);
+                _p = skipSpace(_p, _end);
+                expect(':');
+                _p = skipSpace(_p, _end);
+                Field *field = NULL;
+                for (size_t i = 0; i < n && field == NULL; i++)
+                {
+                    if (!fields[i].found && strlen(fields[i].key) == keyLen && memcmp(fields[i].key, key, keyLen) == 0)
+                        field = &fields[i];
+                }
+                const char *text = _p;
+                if (field && _p < _end && *_p != '{' && *_p != '[')
+                    scalar(field->value);
+                else
+                    skip(0);
+                if (field)
+                {
+                    field->found = true;
+                    field->text = text;
+                    field->size = _p - text;
+                    found++;
+                }
+                _p = skipSpace(_p, _end);
+                if (_p < _end && *_p == '}')
+                    break;
+                expect(',');
+            }
+            return found;
+        }
+        size_t pick(const std::string &s, Field *fields, size_t n)
+        {
+            return pick(s.data(), s.size(), fields, n);
+        }
+        /*
+            二进制的parse
+        */
+        template <class H>
+        bool decode(const char *data, size_t len, H &handler)
+        {
+            start(data, len);
+            if (!binaryValue(handler, 0))
+                return false;
+            if (_p != _end)
+                error();
+            return true;
+        }
+        template <class H>
+        bool decode(const std::string &s, H &handler)
+        {
+            return decode(s.data(), s.size(), handler);
+        }
+        /*
+            二进制的pick,text/size是值的二进制原文
+        */
+        size_t pickBinary(const char *data, size_t len, Field *fields, size_t n)
+        {
+            start(data, len);
+            for (size_t i = 0; i < n; i++)
+            {
+                fields[i].found = false;
+                fields[i].value = Node();
+                fields[i].text = NULL;
+                fields[i].size = 0;
+            }
+            size_t found = 0;
+            unsigned info;
+            uint64_t count = binaryOpen(BINARY_MAP, info);
+            for (uint64_t m = 0; found < n && (info == BINARY_INDEFINITE ? !binaryBreak() : m < count); m++)
+            {
+                const char *key;
+                size_t keyLen;
+                binaryKey(key, keyLen);
+                Field *field = NULL;
+                for (size_t i = 0; i < n && field == NULL; i++)
+                {
+                    if (!fields[i].found && strlen(fields[i].key) == keyLen && memcmp(fields[i].key, key, keyLen) == 0)
+                        field = &fields[i];
+                }
+                const char *text = _p;
+                if (field == NULL || !decodeBinaryScalar(_p, _end, field->value))
+                    binarySkip(0);
+                if (field)
+                {
+                    field->found = true;
+                    field->text = text;
+                    field->size = _p - text;
+                    found++;
+                }
+            }
+            return found;
+        }
+        size_t pickBinary(const std::string &s, Field *fields, size_t n)
+        {
+            return pickBinary(s.data(), s.size(), fields, n);
+        }
+
+    protected:
+        void start(const char *data, size_t len)
+        {
+            _arena.clear();
+            _begin = _p = data;
+            _end = data + len;
+        }
+        void error()
+        {
+            int index = (int)(_p - _begin);
+            PARSEERROR(_begin, index);
+        }
+        void expect(char ch)
+        {
+            if (_p == _end || *_p != ch)
+                error();
+            ++_p;
+        }
+        void literal(const char *s, size_t n)
+        {
+            if ((size_t)(_end - _p) < n || memcmp(_p, s, n) != 0)
+                error();
+            _p += n;
+        }
+        /*
+            _p在开头的引号之后;结束时_p在结尾的引号之后
+        */
+        void string(const char *&s, size_t &len)
+        {
+            const char *begin = _p;
+            bool escaped = false;
+            while (1)
+            {
+                _p = scanString(_p, _end);
+                if (_p == _end || (unsigned char)*_p < 0x20)
+                    error();
+                if (*_p == '"')
+                    break;
+                escaped = true;
+                if (++_p == _end)
+                    error();
+                ++_p;
+            }
+            const char *stop = _p++;
+            if (!escaped)
+            {
+                s = begin;
+                len = stop - begin;
+                return;
+            }
+            char *buf = _arena.make<char>(stop - begin);
+            const char *bad;
+            char *w = unescapeString(begin, stop, buf, bad);
+            if (w == NULL)
+            {
+                _p = bad;
+                error();
+            }
+            s = buf;
+            len = w - buf;
+        }
+        /*
+            不是对象和数组的值解码到out
+        */
+        void scalar(Node &out)
+        {
+            if (_p == _end)
+                error();
+            switch (*_p)
+            {
+            case '"':
+            {
+                ++_p;
+                const char *s;
+                size_t len;
+                string(s, len);
+                out._type = VALUE_STRING;
+                out._u.s = s;
+                out._size = (uint32_t)len;
+                break;
+            }
+            case 't':
+                literal("true", 4);
+                out._type = VALUE_BOOLEAN;
+                out._u.b = true;
+                break;
+            case 'f':
+                literal("false", 5);
+                out._type = VALUE_BOOLEAN;
+                out._u.b = false;
+                break;
+            case 'n':
+                literal("null", 4);
+                out = Node();
+                break;
+            default:
+            {
+                bool isInt;
+                if (!decodeNumber(_p, _end, isInt, out._u.i, out._u.d))
+                    error();
+                out._type = VALUE_NUMBER;
+                out._int = isInt;
+                break;
+            }
+            }
+        }
+        template <class H>
+        bool value(H &handler, int depth)
+        {
+            _p = skipSpace(_p, _end);
+            if (_p == _end || depth > JSONDEPTH)
+                error();
+            if (*_p == '{')
+            {
+                ++_p;
+                if (!handler.startObject())
+                    return false;
+                size_t count = 0;
+                _p = skipSpace(_p, _end);
+                if (_p < _end && *_p == '}')
+                    ++_p;
+                else
+                {
+                    while (1)
+                    {
+                        _p = skipSpace(_p, _end);
+                        expect('"');
+                        const char *key;
+                        size_t len;
+                        string(key, len);
+                        if (!handler.key(key, len))
+                            return false;
+                        _p = skipSpace(_p, _end);
+                        expect(':');
+                        if (!value(handler, depth + 1))
+                            return false;
+                        count++;
+                        _p = skipSpace(_p, _end);
+                        if (_p < _end && *_p == ',')
+                        {
+                            ++_p;
+                            continue;
+                        }
+                        expect('}');
+                        break;
+                    }
+                }
+                return handler.endObject(count);
+            }
+            if (*_p == '[')
+            {
+                ++_p;
+                if (!handler.startArray())
+                    return false;
+                size_t count = 0;
+                _p = skipSpace(_p, _end);
+                if (_p < _end && *_p == ']')
+                    ++_p;
+                else
+                {
+                    while (1)
+                    {
+                        if (!value(handler, depth + 1))
+                            return false;
+                        count++;
+                        _p = skipSpace(_p, _end);
+                        if (_p < _end && *_p == ',')
+                        {
+                            ++_p;
+                            continue;
+                        }
+                        expect(']');
+                        break;
+                    }
+                }
+                return handler.endArray(count);
+            }
+            Node node;
+            scalar(node);
+            switch (node._type)
+            {
+            case VALUE_STRING:
+                return handler.string(node._u.s, node._size);
+            case VALUE_BOOLEAN:
+                return handler.boolean(node._u.b);
+            case VALUE_NUMBER:
+                return node._int ? handler.integer(node._u.i) : handler.real(node._u.d);
+            default:
+                return handler.null();
+            }
+        }
+        /*
+            跳过一个值:检查结构,字符串不反转义
+        */
+        void skip(int depth)
+        {
+            _p = skipSpace(_p, _end);
+            if (_p == _end || depth > JSONDEPTH)
+                error();
+            char open = *_p;
+            if (open != '{' && open != '[')
+            {
+                if (open == '"')
+                {
+                    ++_p;
+                    while (1)
+                    {
+                        _p = scanString(_p, _end);
+                        if (_p == _end || (unsigned char)*_p < 0x20)
+                            error();
+                        if (*_p++ == '"')
+                            break;
+                        if (_p++ == _end)
+                            error();
+                    }
+                }
+                else
+                {
+                    Node node;
+                    scalar(node);
+                }
+                return;
+            }
+            char close = open == '{' ? '}' : ']';
+            ++_p;
+            _p = skipSpace(_p, _end);
+            if (_p < _end && *_p == close)
+            {
+                ++_p;
+                return;
+            }
+            while (1)
+            {
+                if (open == '{')
+                {
+                    _p = skipSpace(_p, _end);
+                    if (_p == _end || *_p != '"')
+                        error();
+                    skip(depth + 1);
+                    _p = skipSpace(_p, _end);
+                    expect(':');
+                }
+                skip(depth + 1);
+                _p = skipSpace(_p, _end);
+                if (_p < _end && *_p == ',')
+                {
+                    ++_p;
+                    continue;
+                }
+                expect(close);
+                return;
+            }
+        }
+
+        /*
+            读数组或对象的头,返回个数;不定长时info是BINARY_INDEFINITE,之后用binaryBreak判断结束
+        */
+        uint64_t binaryOpen(unsigned expected, unsigned &info)
+        {
+            unsigned major;
+            uint64_t arg;
+            const char *at = _p;
+            if (!decodeHead(_p, _end, major, info, arg) || major != expected)
+            {
+                _p = at;
+                error();
+            }
+            // 每个元素至少1字节,先挡住伪造的超大个数
+            if (info != BINARY_INDEFINITE && arg > (uint64_t)(_end - _p))
+            {
+                _p = at;
+                error();
+            }
+            return arg;
+        }
+        bool binaryBreak()
+        {
+            if (_p == _end)
+                error();
+            if ((unsigned char)*_p != BINARY_BREAK)
+                return false;
+            ++_p;
+            return true;
+        }
+        void binaryScalar(Node &out)
+        {
+            if (!decodeBinaryScalar(_p, _end, out))
+                error();
+        }
+        void binaryKey(const char *&s, size_t &len)
+        {
+            Node key;
+            binaryScalar(key);
+            if (!key.isString())
+                error();
+            s = key.data();
+            len = key.size();
+        }
+        template <class H>
+        bool binaryValue(H &handler, int depth)
+        {
+            if (_p == _end || depth > JSONDEPTH)
+                error();
+            unsigned major = (unsigned char)*_p >> 5, info;
+            if (major == BINARY_MAP)
+            {
+                uint64_t count = binaryOpen(BINARY_MAP, info), m = 0;
+                if (!handler.startObject())
+                    return false;
+                for (; info == BINARY_INDEFINITE ? !binaryBreak() : m < count; m++)
+                {
+                    const char *key;
+                    size_t len;
+                    binaryKey(key, len);
+                    if (!handler.key(key, len) || !binaryValue(handler, depth + 1))
+                        return false;
+                }
+                return handler.endObject((size_t)m);
+            }
+            if (major == BINARY_ARRAY)
+            {
+                uint64_t count = binaryOpen(BINARY_ARRAY, info), m = 0;
+                if (!handler.startArray())
+                    return false;
+                for (; info == BINARY_INDEFINITE ? !binaryBreak() : m < count; m++)
+                {
+                    if (!binaryValue(handler, depth + 1))
+                        return false;
+                }
+                return handler.endArray((size_t)m);
+            }
+            Node node;
+            binaryScalar(node);
+            switch (node._type)
+            {
+            case VALUE_STRING:
+                return handler.string(node._u.s, node._size);
+            case VALUE_BOOLEAN:
+                return handler.boolean(node._u.b);
+            case VALUE_NUMBER:
+                return node._int ? handler.integer(node._u.i) : handler.real(node._u.d);
+            default:
+                return handler.null();
+            }
+        }
+        /*
+            跳过一个二进制值,检查结构
+        */
+        void binarySkip(int depth)
+        {
+            if (_p == _end || depth > JSONDEPTH)
+                error();
+            unsigned major = (unsigned char)*_p >> 5, info;
+            if (major != BINARY_MAP && major != BINARY_ARRAY)
+            {
+                Node node;
+                binaryScalar(node);
+                return;
+            }
+            uint64_t count = binaryOpen(major, info);
+            for (uint64_t m = 0; info == BINARY_INDEFINITE ? !binaryBreak() : m < count; m++)
+            {
+                if (major == BINARY_MAP)
+                {
+                    const char *key;
+                    size_t len;
+                    binaryKey(key, len);
+                }
+                binarySkip(depth + 1);
+            }
+        }
+
+    protected:
+        const char *_begin;
+        const char *_p;
+        const char *_end;
+        Arena _arena; // 反转义后的字符串
+    };
+    /*
+        把SAX事件直接写成二进制;个数事先不知道,数组和对象用不定长形式
+    */
+    class EncodeHandler
+    {
+    public:
+        explicit EncodeHandler(Encoder &e) : _e(e)
+        {
+        }
+        bool startObject()
+        {
+            _e.startObject();
+            return true;
+        }
+        bool endObject(size_t /*members*/)
+        {
+            _e.endObject();
+            return true;
+        }
+        bool startArray()
+        {
+            _e.startArray();
+            return true;
+        }
+        bool endArray(size_t /*items*/)
+        {
+            _e.endArray();
+            return true;
+        }
+        bool key(const char *s, size_t len)
+        {
+            _e.key(s, len);
+            return true;
+        }
+        bool string(const char *s, size_t len)
+        {
+            _e.string(s, len);
+            return true;
+        }
+        bool integer(long long int v)
+        {
+            _e.number(v);
+            return true;
+        }
+        bool real(double v)
+        {
+            _e.number(v);
+            return true;
+        }
+        bool boolean(bool v)
+        {
+            _e.boolean(v);
+            return true;
+        }
+        bool null()
+        {
+            _e.null();
+            return true;
+        }
+
+    private:
+        Encoder &_e;
+    };
+    /*
+        把SAX事件写成JSON文本
+    */
+    class WriteHandler
+    {
+    public:
+        explicit WriteHandler(Writer &w) : _w(w)
+        {
+        }
+        bool startObject()
+        {
+            _w.startObject();
+            return true;
+        }
+        bool endObject(size_t /*members*/)
+        {
+            _w.endObject();
+            return true;
+        }
+        bool startArray()
+        {
+            _w.startArray();
+            return true;
+        }
+        bool endArray(size_t /*items*/)
+        {
+            _w.endArray();
+            return true;
+        }
+        bool key(const char *s, size_t len)
+        {
+            _w.key(s, len);
+            return true;
+        }
+        bool string(const char *s, size_t len)
+        {
+            _w.string(s, len);
+            return true;
+        }
+        bool integer(long long int v)
+        {
+            _w.number(v);
+            return true;
+        }
+        bool real(double v)
+        {
+            _w.number(v);
+            return true;
+        }
+        bool boolean(bool v)
+        {
+            _w.boolean(v);
+            return true;
+        }
+        bool null()
+        {
+            _w.null();
+            return true;
+        }
+
+    private:
+        Writer &_w;
+    };
+    /*
+        二进制转成JSON文本,不建DOM;格式错误抛出Exception,已写出的部分不回退
+    */
+    inline void formatBinary(const char *data, size_t len, Writer &w)
+    {
+        Reader reader(64);
+        WriteHandler handler(w);
+        reader.decode(data, len, handler);
+    }
+    /*
+        JSON文本转成二进制,不建DOM;格式错误抛出Exception,已写出的部分不回退
+    */
+    inline void encodeText(const char *data, size_t len, Encoder &e)
+    {
+        Reader reader(256);
+        EncodeHandler handler(e);
+        reader.parse(data, len, handler);
+    }
+}
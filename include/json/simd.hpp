@@ -0,0 +1,192 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__) && defined(__GNUC__) && !defined(JSON_NO_SIMD)
+#define JSON_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+namespace json
+{
+    /*
+        解析器热点的向量化:字符串扫描和空白跳过,一次看16(SSE2)或32(AVX2)字节
+        运行时按CPU选择实现,非x86或定义了JSON_NO_SIMD时只有标量版本
+    */
+    enum simd_level
+    {
+        SIMD_SCALAR,
+        SIMD_SSE2,
+        SIMD_AVX2
+    };
+    namespace simd
+    {
+        inline bool isSpace(char ch)
+        {
+            return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r';
+        }
+        /*
+            返回第一个'"'、'\\'或小于0x20的字节,没有则返回end
+        */
+        inline const char *scanScalar(const char *p, const char *end)
+        {
+            // 查表,每字节一次访存一次比较
+            static const struct Table
+            {
+                bool stop[256];
+                Table()
+                {
+                    for (int i = 0; i < 256; i++)
+                        stop[i] = i < 0x20 || i == '"' || i == '\\';
+                }
+            } table;
+            while (p < end && !table.stop[(unsigned char)*p])
+                ++p;
+            return p;
+        }
+        /*
+            返回第一个非空白字节,没有则返回end
+        */
+        inline const char *spaceScalar(const char *p, const char *end)
+        {
+            while (p < end && isSpace(*p))
+                ++p;
+            return p;
+        }
+#ifdef JSON_SIMD_X86
+        inline const char *scanSse2(const char *p, const char *end)
+        {
+            const __m128i quote = _mm_set1_epi8('"');
+            const __m128i slash = _mm_set1_epi8('\\');
+            const __m128i ctrl = _mm_set1_epi8(0x1F);
+            for (; end - p >= 16; p += 16)
+            {
+                __m128i v = _mm_loadu_si128((const __m128i *)p);
+                // 无符号v<=0x1F等价于max(v,0x1F)==0x1F
+                __m128i hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, slash)),
+                                           _mm_cmpeq_epi8(_mm_max_epu8(v, ctrl), ctrl));
+                unsigned mask = (unsigned)_mm_movemask_epi8(hit);
+                if (mask)
+                    return p + __builtin_ctz(mask);
+            }
+            return scanScalar(p, end);
+        }
+        inline const char *spaceSse2(const char *p, const char *end)
+        {
+            const __m128i space = _mm_set1_epi8(' ');
+            const __m128i tab = _mm_set1_epi8('\t');
+            const __m128i lf = _mm_set1_epi8('\n');
+            const __m128i cr = _mm_set1_epi8('\r');
+            for (; end - p >= 16; p += 16)
+            {
+                __m128i v = _mm_loadu_si128((const __m128i *)p);
+                __m128i ws = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, space), _mm_cmpeq_epi8(v, tab)),
+                                          _mm_or_si128(_mm_cmpeq_epi8(v, lf), _mm_cmpeq_epi8(v, cr)));
+                unsigned mask = ~(unsigned)_mm_movemask_epi8(ws) & 0xFFFF;
+                if (mask)
+                    return p + __builtin_ctz(mask);
+            }
+            return spaceScalar(p, end);
+        }
+        __attribute__((target("avx2"))) inline const char *scanAvx2(const char *p, const char *end)
+        {
+            const __m256i quote = _mm256_set1_epi8('"');
+            const __m256i slash = _mm256_set1_epi8('\\');
+            const __m256i ctrl = _mm256_set1_epi8(0x1F);
+            for (; end - p >= 32; p += 32)
+            {
+                __m256i v = _mm256_loadu_si256((const __m256i *)p);
+                __m256i hit = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, slash)),
+                                              _mm256_cmpeq_epi8(_mm256_max_epu8(v, ctrl), ctrl));
+                unsigned mask = (unsigned)_mm256_movemask_epi8(hit);
+                if (mask)
+                    return p + __builtin_ctz(mask);
+            }
+            return scanSse2(p, end);
+        }
+        __attribute__((target("avx2"))) inline const char *spaceAvx2(const char *p, const char *end)
+        {
+            const __m256i space = _mm256_set1_epi8(' ');
+            const __m256i tab = _mm256_set1_epi8('\t');
+            const __m256i lf = _mm256_set1_epi8('\n');
+            const __m256i cr = _mm256_set1_epi8('\r');
+            for (; end - p >= 32; p += 32)
+            {
+                __m256i v = _mm256_loadu_si256((const __m256i *)p);
+                __m256i ws = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, space), _mm256_cmpeq_epi8(v, tab)),
+                                             _mm256_or_si256(_mm256_cmpeq_epi8(v, lf), _mm256_cmpeq_epi8(v, cr)));
+                unsigned mask = ~(unsigned)_mm256_movemask_epi8(ws);
+                if (mask)
+                    return p + __builtin_ctz(mask);
+            }
+            return spaceSse2(p, end);
+        }
+#endif
+        struct Kernel
+        {
+            simd_level level;
+            const char *(*scan)(const char *, const char *);
+            const char *(*space)(const char *, const char *);
+        };
+        /*
+            CPU支持的最高级别
+        */
+        inline simd_level detect()
+        {
+#ifdef JSON_SIMD_X86
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2"))
+                return SIMD_AVX2;
+            return SIMD_SSE2;
+#else
+            return SIMD_SCALAR;
+#endif
+        }
+        inline Kernel select(simd_level level)
+        {
+            if (level > detect())
+                level = detect();
+            Kernel k = {SIMD_SCALAR, scanScalar, spaceScalar};
+#ifdef JSON_SIMD_X86
+            if (level == SIMD_SSE2)
+                k = {SIMD_SSE2, scanSse2, spaceSse2};
+            else if (level == SIMD_AVX2)
+                k = {SIMD_AVX2, scanAvx2, spaceAvx2};
+#endif
+            return k;
+        }
+        inline Kernel &kernel()
+        {
+            static Kernel k = select(detect());
+            return k;
+        }
+    }
+    inline simd_level simdLevel()
+    {
+        return simd::kernel().level;
+    }
+    /*
+        切换实现(超过CPU支持的会降级),返回实际使用的级别
+        只用于测试和基准,不能和解析并发调用
+    */
+    inline simd_level setSimdLevel(simd_level level)
+    {
+        simd::kernel() = simd::select(level);
+        return simdLevel();
+    }
+    /*
+        字符串里下一个需要处理的字节('"'、'\\'或控制字符),之前的都可以整段复制
+    */
+    inline const char *scanString(const char *p, const char *end)
+    {
+        return simd::kernel().scan(p, end);
+    }
+    /*
+        消息里空白通常只有0到1个字节,先标量判断,遇到缩进等长空白才进向量循环
+    */
+    inline const char *skipSpace(const char *p, const char *end)
+    {
+        if (p == end || !simd::isSpace(*p))
+            return p;
+        return simd::kernel().space(p + 1, end);
+    }
+}
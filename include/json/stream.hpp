@@ -0,0 +1,369 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstring>
+#include <stdint.h>
+#include "document.hpp"
+
+namespace json
+{
+    /*
+        增量解析:输入可以在任意字节处断开,分多次feed,状态跨调用保留,
+        每个顶层值一结束就回调,每个字节只看一次
+        输入是若干个顶层值,之间可以有空白(比如一行一个JSON)
+        顶层的数字、true/false/null要等到后面的分隔符或finish才能确定结束
+        出错抛出Exception(位置是整个流中的偏移),之后必须reset
+    */
+    class StreamParser
+    {
+    public:
+        StreamParser(size_t block = 4096) : _state(STREAM_VALUE), _escape(false), _open(false), _key(false), _escaped(false), _offset(0), _chunk(NULL), _arena(block)
+        {
+        }
+        StreamParser(const StreamParser &) = delete;
+        StreamParser &operator=(const StreamParser &) = delete;
+
+        /*
+            onValue(const Node &)只在回调期间有效,返回本次完成的顶层值个数
+        */
+        template <class F>
+        size_t feed(const char *data, size_t len, F onValue)
+        {
+            const char *p = data;
+            const char *end = data + len;
+            size_t count = 0;
+            _chunk = data;
+            while (p < end)
+            {
+                switch (_state)
+                {
+                case STREAM_STRING:
+                    p = string(p, end);
+                    if (_state != STREAM_STRING)
+                        count += endString(p, onValue);
+                    break;
+                case STREAM_SCALAR:
+                    p = scalar(p, end);
+                    if (_state != STREAM_SCALAR)
+                        count += endScalar(p, onValue);
+                    break;
+                default:
+                    p = skipSpace(p, end);
+                    if (p == end)
+                        break;
+                    count += token(p++, onValue);
+                    break;
+                }
+            }
+            _offset += len;
+            _chunk = end;
+            return count;
+        }
+        template <class F>
+        size_t feed(const std::string &s, F onValue)
+        {
+            return feed(s.data(), s.size(), onValue);
+        }
+        /*
+            输入结束:结束挂起的顶层标量,还在值中间则抛出异常
+        */
+        template <class F>
+        size_t finish(F onValue)
+        {
+            size_t count = 0;
+            if (_state == STREAM_SCALAR)
+            {
+                _state = STREAM_VALUE;
+                count = endScalar(_chunk, onValue);
+            }
+            if (!idle())
+                error(_chunk);
+            return count;
+        }
+        /*
+            没有解析到一半的值
+        */
+        bool idle() const
+        {
+            return _state == STREAM_VALUE && _frames.empty();
+        }
+        size_t depth() const
+        {
+            return _frames.size();
+        }
+        /*
+            已经feed的总字节数
+        */
+        size_t offset() const
+        {
+            return _offset;
+        }
+        void reset()
+        {
+            _state = STREAM_VALUE;
+            _escape = false;
+            _open = false;
+            _key = false;
+            _offset = 0;
+            _token.clear();
+            _stack.clear();
+            _frames.clear();
+            _arena.clear();
+        }
+
+    private:
+        enum stream_state
+        {
+            STREAM_VALUE,  // 等一个值
+            STREAM_NEXT,   // 容器里一个值之后,等','或结束符
+            STREAM_KEY,    // 等对象的键
+            STREAM_COLON,  // 键之后等':'
+            STREAM_STRING, // 字符串中
+            STREAM_SCALAR  // 数字或true/false/null中
+        };
+        struct Frame
+        {
+            size_t base; // 在_stack中的起点
+            bool object;
+        };
+        void error(const char *p)
+        {
+            int index = (int)(_offset + (p - _chunk));
+            PARSEERROR(_chunk, index);
+        }
+        /*
+            STREAM_STRING以外的结构字符,p指向它
+        */
+        template <class F>
+        size_t token(const char *p, F &onValue)
+        {
+            char ch = *p;
+            switch (_state)
+            {
+            case STREAM_VALUE:
+                if (ch == ']' && _open && !_frames.empty() && !_frames.back().object)
+                    return close(false, onValue);
+                _open = false;
+                if (ch == '{' || ch == '[')
+                {
+                    if (_frames.size() >= JSONDEPTH)
+                        error(p);
+                    Frame frame = {_stack.size(), ch == '{'};
+                    _frames.push_back(frame);
+                    _state = ch == '{' ? STREAM_KEY : STREAM_VALUE;
+                    _open = true;
+                    return 0;
+                }
+                _token.assign(1, ch);
+                _key = false;
+                _escaped = false;
+                if (ch == '"')
+                    _state = STREAM_STRING;
+                else if (ch == '-' || (ch >= '0' && ch <= '9') || ch == 't' || ch == 'f' || ch == 'n')
+                    _state = STREAM_SCALAR;
+                else
+                    error(p);
+                return 0;
+            case STREAM_KEY:
+                if (ch == '}' && _open)
+                    return close(true, onValue);
+                _open = false;
+                if (ch != '"')
+                    error(p);
+                _token.assign(1, ch);
+                _key = true;
+                _escaped = false;
+                _state = STREAM_STRING;
+                return 0;
+            case STREAM_COLON:
+                if (ch != ':')
+                    error(p);
+                _state = STREAM_VALUE;
+                return 0;
+            case STREAM_NEXT:
+                if (ch == ',')
+                {
+                    _state = _frames.back().object ? STREAM_KEY : STREAM_VALUE;
+                    return 0;
+                }
+                if (ch == (_frames.back().object ? '}' : ']'))
+                    return close(_frames.back().object, onValue);
+                error(p);
+            default:
+                break;
+            }
+            return 0;
+        }
+        /*
+            原文(含引号和转义)收进_token,本块内的普通字节用scanString整段跳过
+        */
+        const char *string(const char *p, const char *end)
+        {
+            while (p < end)
+            {
+                if (_escape)
+                {
+                    _token += *p++;
+                    _escape = false;
+                    continue;
+                }
+                const char *q = scanString(p, end);
+                _token.append(p, q - p);
+                if (q == end)
+                    return end;
+                _token += *q;
+                if (*q == '"')
+                {
+                    _state = _key ? STREAM_COLON : STREAM_NEXT;
+                    return q + 1;
+                }
+                if (*q != '\\')
+                    error(q);
+                _escape = true;
+                _escaped = true;
+                p = q + 1;
+            }
+            return p;
+        }
+        const char *scalar(const char *p, const char *end)
+        {
+            const char *start = p;
+            while (p < end && ((*p >= '0' && *p <= '9') || (*p >= 'a' && *p <= 'z') || *p == '-' || *p == '+' || *p == '.' || *p == 'E'))
+                ++p;
+            _token.append(start, p - start);
+            if (p < end)
+                _state = STREAM_NEXT;
+            return p;
+        }
+        /*
+            没有转义的字符串直接复制,其余交给Document校验和解码,结果都复制到自己的arena
+        */
+        template <class F>
+        size_t endString(const char *p, F &onValue)
+        {
+            Node node;
+            if (_escaped)
+                node = parseToken(p);
+            else
+            {
+                node._type = VALUE_STRING;
+                node._u.s = _token.data() + 1;
+                node._size = (uint32_t)(_token.size() - 2);
+            }
+            if (node._size)
+            {
+                char *buf = _arena.make<char>(node._size);
+                memcpy(buf, node._u.s, node._size);
+                node._u.s = buf;
+            }
+            if (_key)
+            {
+                _stack.push_back(node);
+                return 0;
+            }
+            return value(node, onValue);
+        }
+        /*
+            18位以内的整数直接算,其余交给Document
+        */
+        template <class F>
+        size_t endScalar(const char *p, F &onValue)
+        {
+            const char *s = _token.data();
+            const char *end = s + _token.size();
+            bool neg = *s == '-';
+            s += neg;
+            size_t digits = end - s;
+            if (digits == 0 || digits > 18 || (*s == '0' && digits > 1))
+                return value(parseToken(p), onValue);
+            long long int v = 0;
+            for (; s < end; ++s)
+            {
+                if (*s < '0' || *s > '9')
+                    return value(parseToken(p), onValue);
+                v = v * 10 + (*s - '0');
+            }
+            Node node;
+            node._type = VALUE_NUMBER;
+            node._int = true;
+            node._u.i = neg ? -v : v;
+            return value(node, onValue);
+        }
+        /*
+            p是token之后的位置,出错时报告它
+        */
+        Node parseToken(const char *p)
+        {
+            try
+            {
+                return _scalar.parse(_token);
+            }
+            catch (const Exception &)
+            {
+                error(p);
+            }
+            return Node();
+        }
+        /*
+            一个值结束:顶层的回调,容器里的压栈
+        */
+        template <class F>
+        size_t value(const Node &node, F &onValue)
+        {
+            if (!_frames.empty())
+            {
+                _stack.push_back(node);
+                _state = STREAM_NEXT;
+                return 0;
+            }
+            _state = STREAM_VALUE;
+            onValue(node);
+            _arena.clear();
+            return 1;
+        }
+        template <class F>
+        size_t close(bool object, F &onValue)
+        {
+            size_t base = _frames.back().base;
+            _frames.pop_back();
+            _open = false;
+            Node node;
+            if (object)
+            {
+                size_t n = (_stack.size() - base) / 2;
+                node._type = VALUE_OBJECT;
+                node._size = (uint32_t)n;
+                node._u.members = _arena.make<Member>(n);
+                for (size_t i = 0; i < n; i++)
+                {
+                    node._u.members[i].key = _stack[base + i * 2];
+                    node._u.members[i].value = _stack[base + i * 2 + 1];
+                }
+            }
+            else
+            {
+                size_t n = _stack.size() - base;
+                node._type = VALUE_ARRAY;
+                node._size = (uint32_t)n;
+                node._u.items = _arena.make<Node>(n);
+                std::copy(_stack.begin() + base, _stack.end(), node._u.items);
+            }
+            _stack.resize(base);
+            return value(node, onValue);
+        }
+
+    private:
+        stream_state _state;
+        bool _escape; // 字符串中上一个字节是'\\'
+        bool _open;   // 容器刚开始,还可以直接结束
+        bool _key;    // 当前字符串是键
+        bool _escaped; // 当前字符串里有转义
+        size_t _offset;
+        const char *_chunk; // 当前块的起点,算错误位置用
+        std::string _token; // 跨块的字符串或标量原文,容量复用
+        Arena _arena;
+        std::vector<Node> _stack;
+        std::vector<Frame> _frames;
+        Document _scalar;
+    };
+}
@@ -0,0 +1,564 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstring>
+#include <stdint.h>
+#include "document.hpp"
+#include "writer.hpp"
+
+namespace json
+{
+    /*
+        不持有的一段字节,接口和C++17的std::string_view一致,以后可以直接替换
+    */
+    class StringView
+    {
+    public:
+        StringView() : _data(NULL), _size(0)
+        {
+        }
+        StringView(const char *data, size_t size) : _data(data), _size(size)
+        {
+        }
+        const char *data() const
+        {
+            return _data;
+        }
+        size_t size() const
+        {
+            return _size;
+        }
+        bool empty() const
+        {
+            return _size == 0;
+        }
+        std::string str() const
+        {
+            return std::string(_data, _size);
+        }
+        bool equals(const char *s, size_t len) const
+        {
+            return _size == len && memcmp(_data, s, len) == 0;
+        }
+        bool operator==(const char *s) const
+        {
+            return equals(s, strlen(s));
+        }
+        bool operator==(const std::string &s) const
+        {
+            return equals(s.data(), s.size());
+        }
+
+    private:
+        const char *_data;
+        size_t _size;
+    };
+    class view;
+    /*
+        结构索引:一遍扫描检查整个输入的语法,每个值在_entries里记一项(位置、长度、跳过它之后的下标),
+        不解码任何值;对象的项是键、值交替
+        值在访问时才解码,没有转义的字符串直接指向输入,有转义的反转义到arena
+        同一个Tape反复parse,稳定后不再申请内存;输入和Tape都要比view活得久,下一次parse后view失效
+    */
+    class Tape
+    {
+    public:
+        Tape(size_t block = 1024) : _begin(NULL), _p(NULL), _end(NULL), _arena(block)
+        {
+        }
+        Tape(const Tape &) = delete;
+        Tape &operator=(const Tape &) = delete;
+
+        /*
+            格式错误抛出Exception
+        */
+        inline view parse(const char *data, size_t len);
+        inline view parse(const std::string &s);
+        /*
+            索引的项数
+        */
+        size_t size() const
+        {
+            return _entries.size();
+        }
+
+    private:
+        friend class view;
+        struct Entry
+        {
+            uint32_t offset; // 值在输入中的起点
+            uint32_t length; // 原文字节数,字符串含引号
+            uint32_t next;   // 这个值(含子节点)之后的下标
+            uint32_t count;  // 数组/对象的元素个数;字符串是否有转义
+        };
+        void error()
+        {
+            int index = (int)(_p - _begin);
+            PARSEERROR(_begin, index);
+        }
+        void expect(char ch)
+        {
+            if (_p == _end || *_p != ch)
+                error();
+            ++_p;
+        }
+        void literal(const char *s, size_t n)
+        {
+            if ((size_t)(_end - _p) < n || memcmp(_p, s, n) != 0)
+                error();
+            _p += n;
+        }
+        void value(int depth)
+        {
+            _p = skipSpace(_p, _end);
+            if (_p == _end || depth > JSONDEPTH)
+                error();
+            size_t index = _entries.size();
+            const char *start = _p;
+            Entry entry = {(uint32_t)(start - _begin), 0, 0, 0};
+            _entries.push_back(entry);
+            uint32_t count = 0;
+            switch (*_p)
+            {
+            case '{':
+                ++_p;
+                _p = skipSpace(_p, _end);
+                if (_p < _end && *_p == '}')
+                {
+                    ++_p;
+                    break;
+                }
+                while (1)
+                {
+                    _p = skipSpace(_p, _end);
+                    if (_p == _end || *_p != '"')
+                        error();
+                    key();
+                    _p = skipSpace(_p, _end);
+                    expect(':');
+                    value(depth + 1);
+                    count++;
+                    _p = skipSpace(_p, _end);
+                    if (_p < _end && *_p == ',')
+                    {
+                        ++_p;
+                        continue;
+                    }
+                    expect('}');
+                    break;
+                }
+                break;
+            case '[':
+                ++_p;
+                _p = skipSpace(_p, _end);
+                if (_p < _end && *_p == ']')
+                {
+                    ++_p;
+                    break;
+                }
+                while (1)
+                {
+                    value(depth + 1);
+                    count++;
+                    _p = skipSpace(_p, _end);
+                    if (_p < _end && *_p == ',')
+                    {
+                        ++_p;
+                        continue;
+                    }
+                    expect(']');
+                    break;
+                }
+                break;
+            case '"':
+                ++_p;
+                count = string();
+                break;
+            case 't':
+                literal("true", 4);
+                break;
+            case 'f':
+                literal("false", 5);
+                break;
+            case 'n':
+                literal("null", 4);
+                break;
+            default:
+                number();
+                break;
+            }
+            Entry &e = _entries[index];
+            e.length = (uint32_t)(_p - start);
+            e.next = (uint32_t)_entries.size();
+            e.count = count;
+        }
+        /*
+            对象的键,_p在开头的引号
+        */
+        void key()
+        {
+            const char *start = _p++;
+            uint32_t escaped = string();
+            Entry entry = {(uint32_t)(start - _begin), (uint32_t)(_p - start), (uint32_t)_entries.size() + 1, escaped};
+            _entries.push_back(entry);
+        }
+        /*
+            _p在开头的引号之后;检查转义但不解码,返回是否有转义
+        */
+        uint32_t string()
+        {
+            uint32_t escaped = 0;
+            while (1)
+            {
+                _p = scanString(_p, _end);
+                if (_p == _end || (unsigned char)*_p < 0x20)
+                    error();
+                if (*_p++ == '"')
+                    return escaped;
+                escaped = 1;
+                if (_p == _end)
+                    error();
+                switch (*_p)
+                {
+                case '"':
+                case '\\':
+                case '/':
+                case 'b':
+                case 'f':
+                case 'n':
+                case 'r':
+                case 't':
+                    ++_p;
+                    break;
+                case 'u':
+                {
+                    unsigned u, u2;
+                    if (!decodeHex4(++_p, _end, u))
+                        error();
+                    _p += 4;
+                    if (u >= 0xD800 && u <= 0xDBFF)
+                    {
+                        if (_end - _p < 6 || _p[0] != '\\' || _p[1] != 'u' || !decodeHex4(_p + 2, _end, u2) || u2 < 0xDC00 || u2 > 0xDFFF)
+                            error();
+                        _p += 6;
+                    }
+                    break;
+                }
+                default:
+                    --_p;
+                    error();
+                }
+            }
+        }
+        /*
+            只检查RFC 8259的数字语法,不转换
+        */
+        void number()
+        {
+            if (_p < _end && *_p == '-')
+                ++_p;
+            if (_p == _end || *_p < '0' || *_p > '9')
+                error();
+            if (*_p == '0')
+                ++_p;
+            else
+                digits();
+            if (_p < _end && *_p == '.')
+            {
+                ++_p;
+                if (_p == _end || *_p < '0' || *_p > '9')
+                    error();
+                digits();
+            }
+            if (_p < _end && (*_p == 'e' || *_p == 'E'))
+            {
+                ++_p;
+                if (_p < _end && (*_p == '+' || *_p == '-'))
+                    ++_p;
+                if (_p == _end || *_p < '0' || *_p > '9')
+                    error();
+                digits();
+            }
+        }
+        void digits()
+        {
+            while (_p < _end && *_p >= '0' && *_p <= '9')
+                ++_p;
+        }
+
+    private:
+        const char *_begin;
+        const char *_p;
+        const char *_end;
+        Arena _arena; // 访问时反转义的字符串
+        std::vector<Entry> _entries; // 容量复用
+    };
+    /*
+        Tape中一个值的只读视图,拷贝就是两个字
+        不存在的键或越界得到空视图(exists()为false,类型当作null)
+    */
+    class view
+    {
+    public:
+        view() : _tape(NULL), _index(0)
+        {
+        }
+        bool exists() const
+        {
+            return _tape != NULL;
+        }
+        value_type getType() const
+        {
+            if (_tape == NULL)
+                return VALUE_NULL;
+            switch (first())
+            {
+            case '{':
+                return VALUE_OBJECT;
+            case '[':
+                return VALUE_ARRAY;
+            case '"':
+                return VALUE_STRING;
+            case 't':
+            case 'f':
+                return VALUE_BOOLEAN;
+            case 'n':
+                return VALUE_NULL;
+            default:
+                return VALUE_NUMBER;
+            }
+        }
+        bool isNull() const
+        {
+            return getType() == VALUE_NULL;
+        }
+        bool isBool() const
+        {
+            return getType() == VALUE_BOOLEAN;
+        }
+        bool isNumber() const
+        {
+            return getType() == VALUE_NUMBER;
+        }
+        bool isString() const
+        {
+            return getType() == VALUE_STRING;
+        }
+        bool isArray() const
+        {
+            return getType() == VALUE_ARRAY;
+        }
+        bool isObject() const
+        {
+            return getType() == VALUE_OBJECT;
+        }
+        /*
+            值的原文,指向输入;转发时原样写出
+        */
+        StringView raw() const
+        {
+            if (_tape == NULL)
+                return StringView("null", 4);
+            const Tape::Entry &e = entry();
+            return StringView(_tape->_begin + e.offset, e.length);
+        }
+        /*
+            字符串内容:没有转义时指向输入,有转义时反转义到Tape的arena(每次访问一份,用完即弃的场景)
+        */
+        StringView text() const
+        {
+            if (getType() != VALUE_STRING)
+                TRANSFORMERROR(getType(), VALUE_STRING);
+            const Tape::Entry &e = entry();
+            const char *s = _tape->_begin + e.offset + 1;
+            size_t len = e.length - 2;
+            if (!e.count)
+                return StringView(s, len);
+            char *buf = _tape->_arena.make<char>(len);
+            const char *bad;
+            char *w = unescapeString(s, s + len, buf, bad); // 建索引时已检查过
+            return StringView(buf, w - buf);
+        }
+        std::string toText() const
+        {
+            return text().str();
+        }
+        bool equals(const char *s, size_t len) const
+        {
+            return getType() == VALUE_STRING && text().equals(s, len);
+        }
+        bool equals(const char *s) const
+        {
+            return equals(s, strlen(s));
+        }
+        long long int toInt() const
+        {
+            bool isInt;
+            long long int i;
+            double d;
+            number(isInt, i, d);
+            return isInt ? i : (long long int)d;
+        }
+        double toDouble() const
+        {
+            bool isInt;
+            long long int i;
+            double d;
+            number(isInt, i, d);
+            return isInt ? (double)i : d;
+        }
+        bool isInt() const
+        {
+            if (getType() != VALUE_NUMBER)
+                return false;
+            bool isInt;
+            long long int i;
+            double d;
+            number(isInt, i, d);
+            return isInt;
+        }
+        bool toBool() const
+        {
+            if (getType() != VALUE_BOOLEAN)
+                TRANSFORMERROR(getType(), VALUE_BOOLEAN);
+            return first() == 't';
+        }
+        /*
+            数组/对象的元素个数,其余为0
+        */
+        size_t size() const
+        {
+            value_type type = getType();
+            return type == VALUE_ARRAY || type == VALUE_OBJECT ? entry().count : 0;
+        }
+        /*
+            键重复时取最后一个(与Node、value一致);不存在或不是对象时返回空视图
+        */
+        view find(const char *key, size_t len) const
+        {
+            view found;
+            if (getType() != VALUE_OBJECT)
+                return found;
+            const std::vector<Tape::Entry> &entries = _tape->_entries;
+            for (uint32_t i = _index + 1; i < entry().next; i = entries[i + 1].next)
+            {
+                const Tape::Entry &k = entries[i];
+                // 没有转义的键直接比较原文
+                bool match = k.count ? view(_tape, i).text().equals(key, len)
+                                     : k.length - 2 == len && memcmp(_tape->_begin + k.offset + 1, key, len) == 0;
+                if (match)
+                    found = view(_tape, i + 1);
+            }
+            return found;
+        }
+        view find(const std::string &key) const
+        {
+            return find(key.data(), key.size());
+        }
+        view operator[](const char *key) const
+        {
+            return find(key, strlen(key));
+        }
+        view operator[](const std::string &key) const
+        {
+            return find(key);
+        }
+        /*
+            按next跳过前面的元素,O(index)
+        */
+        view operator[](int index) const
+        {
+            if (getType() != VALUE_ARRAY)
+                TRANSFORMERROR(getType(), VALUE_ARRAY);
+            if (index < 0 || (uint32_t)index >= entry().count)
+                return view();
+            uint32_t i = _index + 1;
+            for (; index > 0; index--)
+                i = _tape->_entries[i].next;
+            return view(_tape, i);
+        }
+        /*
+            依次访问数组元素:f(const view &)
+        */
+        template <class F>
+        void items(F f) const
+        {
+            if (getType() != VALUE_ARRAY)
+                TRANSFORMERROR(getType(), VALUE_ARRAY);
+            for (uint32_t i = _index + 1; i < entry().next; i = _tape->_entries[i].next)
+                f(view(_tape, i));
+        }
+        /*
+            依次访问对象成员:f(StringView key, const view &value)
+        */
+        template <class F>
+        void members(F f) const
+        {
+            if (getType() != VALUE_OBJECT)
+                TRANSFORMERROR(getType(), VALUE_OBJECT);
+            for (uint32_t i = _index + 1; i < entry().next; i = _tape->_entries[i + 1].next)
+                f(view(_tape, i).text(), view(_tape, i + 1));
+        }
+        /*
+            原文已经是合法JSON,直接写出
+        */
+        void write(Writer &w) const
+        {
+            StringView s = raw();
+            w.raw(s.data(), s.size());
+        }
+        void format(std::string &out) const
+        {
+            Writer w(out);
+            write(w);
+        }
+        std::string formatString() const
+        {
+            return raw().str();
+        }
+
+    private:
+        friend class Tape;
+        view(Tape *tape, uint32_t index) : _tape(tape), _index(index)
+        {
+        }
+        const Tape::Entry &entry() const
+        {
+            return _tape->_entries[_index];
+        }
+        char first() const
+        {
+            return _tape->_begin[entry().offset];
+        }
+        void number(bool &isInt, long long int &i, double &d) const
+        {
+            if (getType() != VALUE_NUMBER)
+                TRANSFORMERROR(getType(), VALUE_NUMBER);
+            const Tape::Entry &e = entry();
+            const char *p = _tape->_begin + e.offset;
+            decodeNumber(p, p + e.length, isInt, i, d);
+        }
+
+    private:
+        Tape *_tape;
+        uint32_t _index;
+    };
+    inline view Tape::parse(const char *data, size_t len)
+    {
+        _arena.clear();
+        _entries.clear();
+        _begin = _p = data;
+        _end = data + len;
+        if (len > UINT32_MAX)
+            error();
+        value(0);
+        _p = skipSpace(_p, _end);
+        if (_p != _end)
+            error();
+        return view(this, 0);
+    }
+    inline view Tape::parse(const std::string &s)
+    {
+        return parse(s.data(), s.size());
+    }
+}
@@ -0,0 +1,280 @@
+#pragma once
+#include <string>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include "simd.hpp"
+
+namespace json
+{
+    /*
+        按JSON规则转义后追加到out,不需要转义的整段追加
+    */
+    inline void escapeString(const char *s, size_t len, std::string &out)
+    {
+        static const char hex_digits[] = "0123456789ABCDEF";
+        const char *end = s + len;
+        out += '"';
+        while (1)
+        {
+            const char *q = scanString(s, end);
+            out.append(s, q - s);
+            if (q == end)
+                break;
+            unsigned char ch = (unsigned char)*q;
+            s = q + 1;
+            out += '\\';
+            switch (ch)
+            {
+            case '"':
+                out += '"';
+                break;
+            case '\\':
+                out += '\\';
+                break;
+            case '\b':
+                out += 'b';
+                break;
+            case '\f':
+                out += 'f';
+                break;
+            case '\n':
+                out += 'n';
+                break;
+            case '\r':
+                out += 'r';
+                break;
+            case '\t':
+                out += 't';
+                break;
+            default:
+                out += "u00";
+                out += hex_digits[ch >> 4];
+                out += hex_digits[ch & 15];
+            }
+        }
+        out += '"';
+    }
+    /*
+        从低位起每次查表写两位
+    */
+    inline void formatUint(unsigned long long u, std::string &out)
+    {
+        static const char pairs[] =
+            "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+            "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+            "8081828384858687888990919293949596979899";
+        char buf[24];
+        char *p = buf + sizeof(buf);
+        while (u >= 100)
+        {
+            const char *d = pairs + (u % 100) * 2;
+            u /= 100;
+            *--p = d[1];
+            *--p = d[0];
+        }
+        if (u >= 10)
+        {
+            *--p = pairs[u * 2 + 1];
+            *--p = pairs[u * 2];
+        }
+        else
+            *--p = (char)('0' + u);
+        out.append(p, buf + sizeof(buf) - p);
+    }
+    inline void formatInt(long long int v, std::string &out)
+    {
+        if (v < 0)
+        {
+            out += '-';
+            formatUint(0ULL - (unsigned long long)v, out);
+        }
+        else
+            formatUint((unsigned long long)v, out);
+    }
+    /*
+        能原样读回的最短写法:15位有效数字以内的都能往返,依次试15/16/17位
+        NaN和无穷不是合法JSON,写成null
+    */
+    inline void formatDouble(double v, std::string &out)
+    {
+        if (!std::isfinite(v))
+        {
+            out += "null";
+            return;
+        }
+        char buf[32];
+        int n = 0;
+        for (int precision = 15; precision <= 17; precision++)
+        {
+            n = snprintf(buf, sizeof(buf), "%.*g", precision, v);
+            if (precision == 17 || strtod(buf, NULL) == v)
+                break;
+        }
+        out.append(buf, n);
+        // 保证读回来仍是浮点数
+        if (strpbrk(buf, ".e") == NULL)
+            out += ".0";
+    }
+    /*
+        单遍流式写出:直接追加到调用方的缓冲区,不产生中间字符串
+        逗号由上一个字节决定,所以不需要记录嵌套状态;
+        构造前缓冲区里已有的内容(比如帧头)不受影响
+        调用方负责按JSON语法配对start/end、对象里key与值交替
+    */
+    class Writer
+    {
+    public:
+        explicit Writer(std::string &out) : _out(out), _start(out.size())
+        {
+        }
+        void startObject()
+        {
+            separate();
+            _out += '{';
+        }
+        /*
+            个数只有Encoder用得到,保持两者接口一致
+        */
+        void startObject(size_t /*members*/)
+        {
+            startObject();
+        }
+        void endObject()
+        {
+            _out += '}';
+        }
+        void startArray()
+        {
+            separate();
+            _out += '[';
+        }
+        void startArray(size_t /*items*/)
+        {
+            startArray();
+        }
+        void endArray()
+        {
+            _out += ']';
+        }
+        void key(const char *s, size_t len)
+        {
+            separate();
+            escapeString(s, len, _out);
+            _out += ':';
+        }
+        void key(const char *s)
+        {
+            key(s, strlen(s));
+        }
+        void key(const std::string &s)
+        {
+            key(s.data(), s.size());
+        }
+        /*
+            escape为false时原样写在引号里,只给value::getString用
+        */
+        void string(const char *s, size_t len, bool escape = true)
+        {
+            separate();
+            if (escape)
+                escapeString(s, len, _out);
+            else
+            {
+                _out += '"';
+                _out.append(s, len);
+                _out += '"';
+            }
+        }
+        void string(const char *s)
+        {
+            string(s, strlen(s));
+        }
+        void string(const std::string &s)
+        {
+            string(s.data(), s.size());
+        }
+        void number(int v)
+        {
+            number((long long int)v);
+        }
+        void number(long v)
+        {
+            number((long long int)v);
+        }
+        void number(long long int v)
+        {
+            separate();
+            formatInt(v, _out);
+        }
+        void number(unsigned v)
+        {
+            number((unsigned long long)v);
+        }
+        void number(unsigned long v)
+        {
+            number((unsigned long long)v);
+        }
+        void number(unsigned long long v)
+        {
+            separate();
+            formatUint(v, _out);
+        }
+        void number(double v)
+        {
+            separate();
+            formatDouble(v, _out);
+        }
+        void boolean(bool v)
+        {
+            separate();
+            _out += v ? "true" : "false";
+        }
+        void null()
+        {
+            separate();
+            _out += "null";
+        }
+        /*
+            已经序列化好的JSON值
+        */
+        void raw(const char *s, size_t len)
+        {
+            separate();
+            _out.append(s, len);
+        }
+        void raw(const std::string &s)
+        {
+            raw(s.data(), s.size());
+        }
+        std::string &buffer()
+        {
+            return _out;
+        }
+        /*
+            本Writer写出的字节数
+        */
+        size_t size() const
+        {
+            return _out.size() - _start;
+        }
+
+    private:
+        /*
+            前一个字节是值的结尾时才需要逗号
+        */
+        void separate()
+        {
+            if (_out.size() == _start)
+                return;
+            char last = _out[_out.size() - 1];
+            if (last != '{' && last != '[' && last != ':')
+                _out += ',';
+        }
+
+    private:
+        std::string &_out;
+        size_t _start;
+    };
+}
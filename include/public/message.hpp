@@ -0,0 +1,68 @@
+#pragma once
+#include <string>
+#include "bind.hpp"
+
+/*
+ * 协议消息,每种声明一次,解析和序列化由JSON_BIND生成
+ * 收到的消息先按"type"分发,再绑定到对应结构体(type本身作为未知键跳过)
+ * 发出的消息type固定,写在第一个
+ */
+namespace chat
+{
+    // {"type":"hello","encoding":"json|binary"}
+    struct Hello
+    {
+        std::string encoding;
+    };
+    JSON_BIND(Hello, encoding)
+    // {"type":"login","id":1}
+    struct Login
+    {
+        long long id;
+    };
+    JSON_BIND(Login, id)
+    // {"type":"chat","to":2,"msg":...}
+    struct Private
+    {
+        long long to;
+        json::Raw msg; // 正文原样转发
+    };
+    JSON_BIND(Private, to, msg)
+    // {"type":"join|leave","room":7}
+    struct Room
+    {
+        long long room;
+    };
+    JSON_BIND(Room, room)
+    // {"type":"group","room":7,"msg":...}
+    struct Group
+    {
+        long long room;
+        json::Raw msg;
+    };
+    JSON_BIND(Group, room, msg)
+
+    struct Ack
+    {
+        const char *type;
+        std::string for_;
+        int code;
+        std::string msg;
+    };
+    JSON_BIND(Ack, type, for_, code, msg)
+    struct PrivatePush
+    {
+        const char *type;
+        long long from;
+        json::Raw msg;
+    };
+    JSON_BIND(PrivatePush, type, from, msg)
+    struct GroupPush
+    {
+        const char *type;
+        long long room;
+        long long from;
+        json::Raw msg;
+    };
+    JSON_BIND(GroupPush, type, room, from, msg)
+}
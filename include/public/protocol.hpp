@@ -0,0 +1,85 @@
+#pragma once
+#include <string>
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * 客户端与服务端共用的线路格式
+ * 帧 = 4字节大端长度 + 负载,负载是JSON文本或等价的二进制编码(json/binary.hpp)
+ */
+namespace chat
+{
+    const size_t FRAME_HEADER = 4;
+    const size_t FRAME_MAX = 1 << 20;
+
+    /*
+     * 每条连接用hello协商发出的编码,默认文本
+     * 收到的负载按首字节区分:文本都是ASCII开头,二进制的顶层对象首字节在0xa0-0xbf
+     */
+    enum payload_encoding
+    {
+        ENCODING_JSON = 0,
+        ENCODING_BINARY = 1,
+    };
+    inline payload_encoding payloadEncoding(const std::string &payload)
+    {
+        return !payload.empty() && (unsigned char)payload[0] >= 0x80 ? ENCODING_BINARY : ENCODING_JSON;
+    }
+
+    enum frame_status
+    {
+        FRAME_ERROR = -1,
+        FRAME_PARTIAL = 0,
+        FRAME_OK = 1,
+    };
+
+    inline void encodeFrame(const std::string &payload, std::string &out)
+    {
+        uint32_t len = (uint32_t)payload.size();
+        char header[FRAME_HEADER] = {(char)(len >> 24), (char)(len >> 16), (char)(len >> 8), (char)len};
+        out.append(header, FRAME_HEADER);
+        out.append(payload);
+    }
+    inline std::string encodeFrame(const std::string &payload)
+    {
+        std::string out;
+        out.reserve(FRAME_HEADER + payload.size());
+        encodeFrame(payload, out);
+        return out;
+    }
+    /*
+     * 先占位帧头,负载直接写在out后面,写完用endFrame补上长度,省掉一次拷贝
+     * 返回帧在out中的起始位置
+     */
+    inline size_t beginFrame(std::string &out)
+    {
+        size_t start = out.size();
+        out.append(FRAME_HEADER, '\0');
+        return start;
+    }
+    inline void endFrame(std::string &out, size_t start)
+    {
+        uint32_t len = (uint32_t)(out.size() - start - FRAME_HEADER);
+        out[start] = (char)(len >> 24);
+        out[start + 1] = (char)(len >> 16);
+        out[start + 2] = (char)(len >> 8);
+        out[start + 3] = (char)len;
+    }
+    /*
+     * 从data中尝试取出一帧,成功时consumed为整帧长度
+     */
+    inline frame_status decodeFrame(const char *data, size_t len, std::string &payload, size_t &consumed)
+    {
+        if (len < FRAME_HEADER)
+            return FRAME_PARTIAL;
+        const unsigned char *p = (const unsigned char *)data;
+        size_t body = ((size_t)p[0] << 24) | ((size_t)p[1] << 16) | ((size_t)p[2] << 8) | (size_t)p[3];
+        if (body > FRAME_MAX)
+            return FRAME_ERROR;
+        if (len < FRAME_HEADER + body)
+            return FRAME_PARTIAL;
+        payload.assign(data + FRAME_HEADER, body);
+        consumed = FRAME_HEADER + body;
+        return FRAME_OK;
+    }
+}
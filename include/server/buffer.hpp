@@ -0,0 +1,337 @@
+#pragma once
+#include <string>
+#include <deque>
+#include <algorithm>
+#include <vector>
+#include <memory>
+#include <new>
+#include <cstring>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+namespace server
+{
+    const size_t CHUNK_SIZE = 16384;
+    const size_t CHUNK_POOL = 256;    // 每个线程最多缓存的空闲块
+    const size_t WRITEV_MAX = 64;     // 一次writev最多的段数
+    const size_t COPY_MAX = 4096;     // 右值帧小于它时拷进块里,否则接管整个string
+
+    /*
+     * 定长块的线程本地空闲链表,连接只在自己的loop线程里取还,不需要加锁
+     * 在别的线程析构的连接把块还给那个线程,线程退出后直接free
+     */
+    class ChunkPool
+    {
+    public:
+        ~ChunkPool()
+        {
+            dead() = true;
+            for (size_t i = 0; i < _free.size(); i++)
+                free(_free[i]);
+        }
+        static char *get()
+        {
+            ChunkPool *pool = local();
+            if (pool && !pool->_free.empty())
+            {
+                char *chunk = pool->_free.back();
+                pool->_free.pop_back();
+                return chunk;
+            }
+            char *chunk = (char *)malloc(CHUNK_SIZE);
+            if (chunk == NULL)
+                throw std::bad_alloc();
+            return chunk;
+        }
+        static void put(char *chunk)
+        {
+            ChunkPool *pool = local();
+            if (pool && pool->_free.size() < CHUNK_POOL)
+                pool->_free.push_back(chunk);
+            else
+                free(chunk);
+        }
+        static size_t idle()
+        {
+            ChunkPool *pool = local();
+            return pool ? pool->_free.size() : 0;
+        }
+
+    private:
+        static bool &dead()
+        {
+            static thread_local bool d = false;
+            return d;
+        }
+        static ChunkPool *local()
+        {
+            if (dead())
+                return NULL;
+            static thread_local ChunkPool pool;
+            return &pool;
+        }
+
+    private:
+        std::vector<char *> _free;
+    };
+
+    /*
+     * 接收缓冲:平时是池中的一个块,装不下一整帧时换成更大的连续内存(按块对齐)
+     * 读空后release还回池里,空闲连接不占接收内存
+     */
+    class InputBuffer
+    {
+    public:
+        InputBuffer() : _data(NULL), _cap(0), _begin(0), _end(0)
+        {
+        }
+        ~InputBuffer()
+        {
+            release();
+        }
+        InputBuffer(const InputBuffer &) = delete;
+        InputBuffer &operator=(const InputBuffer &) = delete;
+
+        const char *data() const
+        {
+            return _data + _begin;
+        }
+        size_t size() const
+        {
+            return _end - _begin;
+        }
+        size_t capacity() const
+        {
+            return _cap;
+        }
+        void consume(size_t n)
+        {
+            _begin += n;
+            if (_begin == _end)
+                _begin = _end = 0;
+        }
+        void append(const char *data, size_t len)
+        {
+            reserve(len);
+            memcpy(_data + _end, data, len);
+            _end += len;
+        }
+        /*
+         * 先读进剩余空间,放不下的部分读到栈上再追加;返回值同read
+         */
+        ssize_t readFd(int fd)
+        {
+            char extra[65536];
+            reserve(1);
+            iovec iov[2];
+            iov[0].iov_base = _data + _end;
+            iov[0].iov_len = _cap - _end;
+            iov[1].iov_base = extra;
+            iov[1].iov_len = sizeof(extra);
+            ssize_t n = readv(fd, iov, 2);
+            if (n <= 0)
+                return n;
+            if ((size_t)n <= iov[0].iov_len)
+                _end += n;
+            else
+            {
+                _end = _cap;
+                append(extra, n - iov[0].iov_len);
+            }
+            return n;
+        }
+        /*
+         * 没有未处理的数据时归还内存
+         */
+        void release()
+        {
+            if (size() != 0 || _data == NULL)
+                return;
+            if (_cap == CHUNK_SIZE)
+                ChunkPool::put(_data);
+            else
+                free(_data);
+            _data = NULL;
+            _cap = _begin = _end = 0;
+        }
+
+    private:
+        /*
+         * 保证尾部至少有n字节:先挪到开头,还不够再换更大的内存
+         */
+        void reserve(size_t n)
+        {
+            if (_cap - _end >= n)
+                return;
+            size_t used = size();
+            if (_data != NULL && _cap - used >= n && _begin > 0)
+            {
+                memmove(_data, _data + _begin, used);
+                _begin = 0;
+                _end = used;
+                return;
+            }
+            size_t cap = _cap ? _cap * 2 : CHUNK_SIZE;
+            while (cap < used + n)
+                cap *= 2;
+            char *data = cap == CHUNK_SIZE ? ChunkPool::get() : (char *)malloc(cap);
+            if (data == NULL)
+                throw std::bad_alloc();
+            if (used)
+                memcpy(data, _data + _begin, used);
+            if (_data != NULL)
+            {
+                if (_cap == CHUNK_SIZE)
+                    ChunkPool::put(_data);
+                else
+                    free(_data);
+            }
+            _data = data;
+            _cap = cap;
+            _begin = 0;
+            _end = used;
+        }
+
+    private:
+        char *_data;
+        size_t _cap;
+        size_t _begin;
+        size_t _end;
+    };
+
+    /*
+     * 发送队列:小帧首尾相接拷进池中的块,共享帧和大帧只记引用不拷贝
+     * writeFd一次writev写出队首起的多段,一轮事件里排队的帧合成一次系统调用
+     */
+    class OutputBuffer
+    {
+    public:
+        OutputBuffer() : _offset(0), _bytes(0)
+        {
+        }
+        ~OutputBuffer()
+        {
+            clear();
+        }
+        OutputBuffer(const OutputBuffer &) = delete;
+        OutputBuffer &operator=(const OutputBuffer &) = delete;
+
+        bool empty() const
+        {
+            return _bytes == 0;
+        }
+        size_t size() const
+        {
+            return _bytes;
+        }
+        size_t segments() const
+        {
+            return _segments.size();
+        }
+        void append(const char *data, size_t len)
+        {
+            _bytes += len;
+            while (len > 0)
+            {
+                if (_segments.empty() || _segments.back().chunk == NULL || _segments.back().len == CHUNK_SIZE)
+                {
+                    Segment s;
+                    s.chunk = ChunkPool::get();
+                    s.data = s.chunk;
+                    s.len = 0;
+                    _segments.push_back(s);
+                }
+                Segment &tail = _segments.back();
+                size_t n = std::min(len, CHUNK_SIZE - tail.len);
+                memcpy(tail.chunk + tail.len, data, n);
+                tail.len += n;
+                data += n;
+                len -= n;
+            }
+        }
+        void append(const std::shared_ptr<const std::string> &frame)
+        {
+            if (frame->empty())
+                return;
+            Segment s;
+            s.chunk = NULL;
+            s.data = frame->data();
+            s.len = frame->size();
+            s.hold = frame;
+            _segments.push_back(s);
+            _bytes += s.len;
+        }
+        void append(std::string &&frame)
+        {
+            if (frame.size() < COPY_MAX)
+                append(frame.data(), frame.size());
+            else
+                append(std::make_shared<std::string>(std::move(frame)));
+        }
+        /*
+         * 返回值同writev,写出的部分从队列中去掉
+         */
+        ssize_t writeFd(int fd)
+        {
+            iovec iov[WRITEV_MAX];
+            int count = 0;
+            for (size_t i = 0; i < _segments.size() && count < (int)WRITEV_MAX; i++, count++)
+            {
+                size_t skip = i == 0 ? _offset : 0;
+                iov[count].iov_base = (void *)(_segments[i].data + skip);
+                iov[count].iov_len = _segments[i].len - skip;
+            }
+            if (count == 0)
+                return 0;
+            ssize_t n = writev(fd, iov, count);
+            if (n > 0)
+                consume(n);
+            return n;
+        }
+        void clear()
+        {
+            while (!_segments.empty())
+                pop();
+            _offset = 0;
+            _bytes = 0;
+        }
+
+    private:
+        struct Segment
+        {
+            const char *data;
+            size_t len;
+            char *chunk; // 池中的块,引用的帧为NULL
+            std::shared_ptr<const std::string> hold;
+        };
+        void consume(size_t n)
+        {
+            _bytes -= n;
+            while (n > 0)
+            {
+                size_t left = _segments.front().len - _offset;
+                if (n < left)
+                {
+                    _offset += n;
+                    return;
+                }
+                n -= left;
+                pop();
+            }
+        }
+        void pop()
+        {
+            if (_segments.front().chunk != NULL)
+                ChunkPool::put(_segments.front().chunk);
+            _segments.pop_front();
+            _offset = 0;
+        }
+
+    private:
+        std::deque<Segment> _segments;
+        size_t _offset; // 队首已写出的字节
+        size_t _bytes;
+    };
+}
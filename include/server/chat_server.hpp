@@ -0,0 +1,75 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <stdint.h>
+#include "thread.hpp"
+#include "event_loop.hpp"
+#include "connection.hpp"
+#include "chat_service.hpp"
+
+namespace server
+{
+    /*
+     * 主线程(acceptor)只负责accept,新连接轮询分给ioThreads个IO线程,
+     * 解出的消息交给ThreadPool执行业务逻辑,workers为工作线程数上限
+     */
+    class ChatServer : public EventHandler
+    {
+    public:
+        ChatServer(uint16_t port, size_t ioThreads, size_t workers, thread::placement place = thread::PLACE_NONE,
+                   const StoreOption &store = StoreOption());
+        ~ChatServer();
+        ChatServer(const ChatServer &) = delete;
+        ChatServer &operator=(const ChatServer &) = delete;
+
+        /*
+         * 阻塞直到stop
+         */
+        void start();
+        /*
+         * 可在信号处理函数中调用
+         */
+        void stop();
+
+        void handleEvent(uint32_t events) override;
+
+    private:
+        struct IoLoop
+        {
+            EventLoop loop;
+            std::unordered_map<int, Connection::ptr> connections; // 仅在loop线程访问
+        };
+        /*
+         * 一条连接的待处理帧:同一时刻最多一个工作线程在执行,帧按到达顺序处理,
+         * 关闭排在所有已收到的帧之后
+         * 排队的通道跟着队头的帧走:登录前HIGH,群发BULK,其余NORMAL;换通道时剩下的帧重新排队
+         */
+        struct Strand
+        {
+            thread::Mutex mutex;
+            std::vector<std::string> frames;
+            bool running = false; // 已提交到线程池或正在执行
+            bool closing = false;
+            thread::lane lane = thread::LANE_HIGH; // 当前排在哪个通道,running为false时由onMessage设置
+        };
+        static thread::PoolOption poolOption(thread::placement place, size_t workers);
+        void newConnection(int fd);
+        thread::lane laneOf(const Connection::ptr &conn, const std::string &frame);
+        void onMessage(const std::shared_ptr<Strand> &strand, const Connection::ptr &conn, std::vector<std::string> &&frames);
+        void onClose(const std::shared_ptr<Strand> &strand, const Connection::ptr &conn);
+        void schedule(const std::shared_ptr<Strand> &strand, const Connection::ptr &conn);
+        void drain(const std::shared_ptr<Strand> &strand, const Connection::ptr &conn);
+
+    private:
+        EventLoop _baseLoop;
+        int _listenfd;
+        int _idlefd;
+        std::vector<std::unique_ptr<IoLoop>> _loops;
+        std::vector<thread::Thread> _threads;
+        size_t _next;
+        uint64_t _nextId;
+        thread::ThreadPool _pool;
+        ChatService _service;
+    };
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <string>
+#include <memory>
+#include <unordered_map>
+#include <atomic>
+#include "json.hpp"
+#include "message.hpp"
+#include "thread.hpp"
+#include "sharded_map.hpp"
+#include "connection.hpp"
+#include "rooms.hpp"
+#include "offline_store.hpp"
+
+namespace server
+{
+    /*
+     * 业务逻辑,运行在ThreadPool的工作线程中
+     * 请求格式:{"type":"hello|login|chat|join|leave|group|echo", ...}
+     * 不建DOM:先只取type分发,各处理函数再绑定到message.hpp中的结构体,消息正文原样转发
+     * 二进制负载直接取type和绑定,不转文本;发出的帧按对方连接协商的编码序列化
+     * 私聊对方不在线时推送存入OfflineStore,落盘后回ack code 0 "stored",写盘失败回code 7
+     * 对方登录时先登记为补发中,锁外按序补发完再切到在线,补发的帧写进socket后才ack,压缩交给存储的压缩线程
+     */
+    class ChatService
+    {
+    public:
+        explicit ChatService(const StoreOption &store = StoreOption());
+        ChatService(const ChatService &) = delete;
+        ChatService &operator=(const ChatService &) = delete;
+
+        void onMessage(const Connection::ptr &conn, const std::string &payload);
+        void onClose(const Connection::ptr &conn);
+        /*
+         * 群发这类可以往后排的请求,只取type,解析失败按否处理
+         */
+        bool isBulk(const std::string &payload);
+
+    private:
+        using handler = void (ChatService::*)(const Connection::ptr &, const std::string &);
+        struct Presence
+        {
+            std::weak_ptr<Connection> conn;
+            bool delivering; // 还在补发离线消息,发给他的私聊先进存储
+        };
+        void hello(const Connection::ptr &conn, const std::string &payload);
+        void login(const Connection::ptr &conn, const std::string &payload);
+        void chat(const Connection::ptr &conn, const std::string &payload);
+        void join(const Connection::ptr &conn, const std::string &payload);
+        void leave(const Connection::ptr &conn, const std::string &payload);
+        void group(const Connection::ptr &conn, const std::string &payload);
+        void echo(const Connection::ptr &conn, const std::string &payload);
+        void ack(const Connection::ptr &conn, const std::string &type, int code, const std::string &what = "");
+        uint64_t deliverOffline(const Connection::ptr &conn, uint64_t after, size_t &count);
+
+    private:
+        std::unordered_map<std::string, handler> _handlers;
+        thread::ShardedMap<long long, Presence> _users; // 在线用户,各工作线程并发查找
+        Rooms _rooms;
+        OfflineStore _store;
+        std::atomic<uint64_t> _delivered; // 补发条数,每COMPACT_EVERY条尝试压缩一次
+    };
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <functional>
+#include "event_loop.hpp"
+#include "buffer.hpp"
+
+namespace server
+{
+    /*
+     * 一条TCP连接,只在所属EventLoop线程内读写,send可在任意线程调用
+     * 发送先进队列,本轮事件处理完后一次writev写出
+     */
+    class Connection : public EventHandler, public std::enable_shared_from_this<Connection>
+    {
+    public:
+        using ptr = std::shared_ptr<Connection>;
+        using MessageCallback = std::function<void(const ptr &, std::vector<std::string> &&)>;
+        using CloseCallback = std::function<void(const ptr &)>;
+        using FlushedCallback = std::function<void()>;
+
+        Connection(EventLoop *loop, int fd, uint64_t id);
+        ~Connection();
+        Connection(const Connection &) = delete;
+        Connection &operator=(const Connection &) = delete;
+
+        void setMessageCallback(const MessageCallback &cb) { _messageCallback = cb; }
+        void setCloseCallback(const CloseCallback &cb) { _closeCallback = cb; }
+        /*
+         * 在loop线程中调用,注册到epoll
+         */
+        void establish();
+        /*
+         * 发送已编码好的帧
+         */
+        void send(const std::string &frame);
+        void send(std::string &&frame);
+        /*
+         * 多条连接共用同一帧:跨线程只传引用计数,不复制内容
+         */
+        void send(const std::shared_ptr<const std::string> &frame);
+        /*
+         * 此前从同一线程send的帧全部写进socket后,在loop线程调用cb
+         * 连接关闭时有帧没写出或被丢弃则不调用
+         */
+        void whenFlushed(const FlushedCallback &cb);
+        void forceClose();
+
+        EventLoop *getLoop() const { return _loop; }
+        int fd() const { return _fd; }
+        uint64_t id() const { return _id; }
+        long long userId() const { return _userId; }
+        void setUserId(long long id) { _userId = id; }
+        /*
+         * 发给这条连接的负载用的编码(chat::payload_encoding)
+         */
+        int encoding() const { return _encoding; }
+        void setEncoding(int encoding) { _encoding = encoding; }
+        bool connected() const { return !_closed; }
+
+        void handleEvent(uint32_t events) override;
+        void flush() override;
+
+    private:
+        void handleRead();
+        void handleWrite();
+        void handleClose();
+        void sendInLoop(const char *data, size_t len);
+        void sendInLoop(std::string &&frame);
+        void sendInLoop(const std::shared_ptr<const std::string> &frame);
+        void whenFlushedInLoop(const FlushedCallback &cb);
+        void scheduleFlush();
+
+    private:
+        EventLoop *_loop;
+        int _fd;
+        uint64_t _id;
+        std::atomic<long long> _userId;
+        std::atomic<int> _encoding;
+        std::atomic<bool> _closed;
+        std::atomic<bool> _lost; // 关闭时有没写出或关闭后才send的帧
+        bool _flushQueued;
+        InputBuffer _input;
+        OutputBuffer _output;
+        MessageCallback _messageCallback;
+        CloseCallback _closeCallback;
+        std::vector<FlushedCallback> _flushed; // 等输出写空
+    };
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <functional>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include "thread.hpp"
+
+namespace server
+{
+    /*
+     * 注册到epoll上的对象,epoll_event.data.ptr指向它
+     */
+    class EventHandler
+    {
+    public:
+        virtual ~EventHandler() {}
+        virtual void handleEvent(uint32_t events) = 0;
+        /*
+         * flushLater登记后,在本轮事件和pending任务都处理完时调用一次
+         */
+        virtual void flush() {}
+    };
+    /*
+     * one loop per thread,所有fd均为边沿触发
+     */
+    class EventLoop
+    {
+    public:
+        using func = std::function<void()>;
+        EventLoop();
+        ~EventLoop();
+        EventLoop(const EventLoop &) = delete;
+        EventLoop &operator=(const EventLoop &) = delete;
+
+        void loop();
+        /*
+         * 可在任意线程及信号处理函数中调用
+         */
+        void quit();
+        bool isInLoopThread() const;
+        void runInLoop(func f);
+        void queueInLoop(func f);
+        /*
+         * 只能在loop线程调用,同一轮内多次发送合并到轮末一起写
+         */
+        void flushLater(const std::shared_ptr<EventHandler> &handler);
+
+        void add(int fd, uint32_t events, EventHandler *handler);
+        void modify(int fd, uint32_t events, EventHandler *handler);
+        void remove(int fd);
+
+    private:
+        void wakeup();
+        void handleWakeup();
+        void doPending();
+        void doFlush();
+
+    private:
+        int _epfd;
+        int _wakeupfd;
+        std::atomic<bool> _quit;
+        std::atomic<bool> _looping;
+        pthread_t _tid;
+        thread::Mutex _mutex;
+        std::vector<func> _pending;
+        std::vector<std::shared_ptr<EventHandler>> _flush;
+        std::vector<epoll_event> _events;
+    };
+}
@@ -0,0 +1,168 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <functional>
+#include <unordered_map>
+#include <stdint.h>
+#include "thread.hpp"
+
+namespace server
+{
+    struct StoreOption
+    {
+        std::string dir = "offline";
+        size_t segmentSize = 64 << 20; // 段写满后封存,新开一段
+        long commitInterval = 5;       // 毫秒,没有人等待时后台按这个间隔写盘
+        bool fsync = true;             // false时只write不fdatasync,测试和基准用
+        double compactRatio = 0.5;     // 存活字节低于这个比例的封存段会被压缩
+    };
+    struct StoreStats
+    {
+        size_t segments;
+        size_t messages;   // 未投递的消息数
+        uint64_t liveBytes;
+        uint64_t diskBytes;
+        uint64_t commits;  // 写盘(含fdatasync)的次数
+    };
+    /*
+     * 离线消息存储,只用本地磁盘:
+     * 追加写的分段日志,每条记录 = 24字节头(crc、类型和长度、用户、序号) + 负载
+     * 追加只拷进内存缓冲,后台线程成组write+fdatasync,多个等待者共用一次fsync
+     * 新建段文件时同步目录;写盘失败后进入失败状态,之后的追加和等待都返回失败
+     * 内存里按用户记录未投递消息的位置,登录时mmap段文件按序号顺序读出
+     * 投递后写一条ack记录;压缩把封存段中仍存活的消息搬到当前段,然后删除整个段
+     * 压缩可以交给存储自己的压缩线程做,分批搬运,中间放开锁,不挡追加和ack
+     * 所有接口线程安全
+     */
+    class OfflineStore
+    {
+    public:
+        using Visitor = std::function<void(const char *data, size_t len)>;
+
+        explicit OfflineStore(const StoreOption &option = StoreOption());
+        ~OfflineStore();
+        OfflineStore(const OfflineStore &) = delete;
+        OfflineStore &operator=(const OfflineStore &) = delete;
+
+        /*
+         * 创建目录,扫描已有的段重建索引,截掉最后一段不完整的尾部,启动写盘和压缩线程
+         */
+        bool open(std::string &error);
+        /*
+         * 写完缓冲并停止后台线程,清空内存索引,之后可以重新open;析构时自动调用
+         */
+        void close();
+        bool isOpen() const { return _open; }
+        /*
+         * 最近一次失败的原因(写盘失败或拒绝的追加),没有失败时为空
+         */
+        std::string lastError();
+
+        /*
+         * 返回消息序号(从1开始);durable为true时等到落盘再返回
+         * 负载超过16MB-1字节时拒绝,已处于失败状态或这批写盘失败时返回0
+         */
+        uint64_t append(long long user, const char *data, size_t len, bool durable = false);
+        uint64_t append(long long user, const std::string &data, bool durable = false)
+        {
+            return append(user, data.data(), data.size(), durable);
+        }
+        /*
+         * 按写入顺序对user的每条序号大于after的未投递消息调用f,数据指向mmap,只在回调期间有效
+         * 返回最后一条的序号,没有消息返回0
+         */
+        uint64_t replay(long long user, const Visitor &f, uint64_t after = 0);
+        /*
+         * 序号不超过upto的消息已投递
+         */
+        void ack(long long user, uint64_t upto);
+        size_t pending(long long user);
+        /*
+         * user最新一条未投递消息的序号,没有返回0;只查内存,不读盘
+         */
+        uint64_t latest(long long user);
+        /*
+         * 立即写盘并等待完成,写盘失败返回false
+         */
+        bool commit();
+        /*
+         * 在调用线程压缩封存段,返回删除的段数
+         */
+        size_t compact();
+        /*
+         * 通知压缩线程做一次compact,立即返回
+         */
+        void compactLater();
+        StoreStats stats();
+
+    private:
+        struct Location
+        {
+            uint64_t seq;
+            uint32_t segment;
+            uint32_t offset; // 记录头在段内的偏移
+            uint32_t size;   // 负载字节数
+        };
+        struct UserState
+        {
+            std::vector<Location> messages; // 按seq递增
+            uint64_t acked = 0;
+            uint32_t ackSegment = 0;        // 最近一条ack记录所在的段
+        };
+        struct Mapping
+        {
+            const char *data;
+            size_t len;
+            Mapping(const char *d, size_t l) : data(d), len(l) {}
+            ~Mapping();
+        };
+        struct Segment
+        {
+            uint64_t bytes = 0;
+            uint64_t liveBytes = 0;
+            size_t live = 0;
+            std::shared_ptr<Mapping> map;
+        };
+        struct Pending
+        {
+            uint32_t segment;
+            std::string data;
+        };
+
+        std::string path(uint32_t segment) const;
+        bool recover(uint32_t segment, bool last, std::string &error);
+        Location write(int kind, long long user, uint64_t seq, const char *data, size_t len);
+        void drop(UserState &state, uint64_t upto);
+        size_t move(long long user, UserState &state, const std::vector<uint32_t> &victims);
+        bool waitWritten(uint64_t pos);
+        std::shared_ptr<Mapping> map(uint32_t segment, uint64_t need);
+        void run();
+        void runCompact();
+
+    private:
+        StoreOption _option;
+        bool _open;
+        thread::Mutex _mutex;
+        thread::Condition _wake;    // 通知写盘线程
+        thread::Condition _written; // 写盘完成
+        thread::Condition _compactWake;
+        std::unordered_map<long long, UserState> _users;
+        std::map<uint32_t, Segment> _segments;
+        std::vector<Pending> _buffer;
+        uint32_t _active;
+        uint64_t _activeSize;
+        uint64_t _nextSeq;
+        uint64_t _appendPos;  // 已进缓冲的位置,(段号 << 32) | 段内偏移
+        uint64_t _writtenPos; // 已写盘的位置
+        bool _urgent;
+        bool _compactRequested;
+        bool _stop;
+        bool _failed; // 写盘失败后不再写,_writtenPos停在失败前
+        std::string _error;
+        uint64_t _commits;
+        std::unique_ptr<thread::Thread> _writer;
+        std::unique_ptr<thread::Thread> _compactor;
+    };
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include "sharded_map.hpp"
+#include "connection.hpp"
+
+namespace server
+{
+    /*
+     * 房间成员表,各工作线程并发访问:房间 -> 成员连接,用户 -> 加入的房间
+     * 广播时每种编码只序列化一次,成员按所属EventLoop分组,每个loop只投递一个任务
+     * 锁的顺序:分片锁 -> 房间锁
+     */
+    class Rooms
+    {
+    public:
+        /*
+         * 按编码(chat::payload_encoding)生成完整的帧,每种编码最多调用一次
+         */
+        using FrameFactory = std::function<std::shared_ptr<const std::string>(int encoding)>;
+
+        void join(long long room, long long user, const Connection::ptr &conn);
+        bool leave(long long room, long long user);
+        /*
+         * 连接关闭时调用:只退出仍指向这条连接的成员(用户可能已在新连接上登录)
+         */
+        void leaveAll(long long user, const Connection::ptr &conn);
+        /*
+         * 用户在新连接上登录,已加入的房间改发到新连接
+         */
+        void rebind(long long user, const Connection::ptr &conn);
+        bool contains(long long room, long long user) const;
+        size_t members(long long room) const;
+        /*
+         * sender不在房间时返回-1,否则返回投递的连接数
+         */
+        long broadcast(long long room, long long sender, const FrameFactory &frame);
+
+    private:
+        struct Room
+        {
+            thread::RWLock lock;
+            std::unordered_map<long long, std::weak_ptr<Connection>> members;
+        };
+        /*
+         * 同一个loop上的接收者,下标是编码
+         */
+        struct Batch
+        {
+            EventLoop *loop;
+            std::vector<Connection::ptr> conns[2];
+            std::shared_ptr<const std::string> frames[2];
+        };
+        bool remove(long long room, long long user, const Connection *conn);
+
+    private:
+        thread::ShardedMap<long long, std::shared_ptr<Room>> _rooms;
+        thread::ShardedMap<long long, std::unordered_set<long long>> _joined;
+    };
+}
@@ -0,0 +1,227 @@
+#pragma once
+#include <unordered_map>
+#include <functional>
+#include "thread.hpp"
+
+namespace thread
+{
+    /*
+        分片哈希表:键按哈希高位分到2的幂个分片,每片一把读写锁,
+        不同分片的读写互不影响,同一分片的读之间也不互斥
+        回调在锁内执行,不能再访问同一张表
+    */
+    template <class K, class V, class Hash = std::hash<K>>
+    class ShardedMap
+    {
+    public:
+        /*
+            shards向上取到2的幂,0表示按CPU数的8倍
+        */
+        explicit ShardedMap(size_t shards = 0)
+        {
+            if (shards == 0)
+                shards = (size_t)std::max(1L, sysconf(_SC_NPROCESSORS_ONLN)) * 8;
+            _bits = 0;
+            while (((size_t)1 << _bits) < shards)
+                _bits++;
+            _shards = std::unique_ptr<Shard[]>(new Shard[(size_t)1 << _bits]);
+        }
+        ShardedMap(const ShardedMap &) = delete;
+        ShardedMap &operator=(const ShardedMap &) = delete;
+
+        size_t shards() const
+        {
+            return (size_t)1 << _bits;
+        }
+        /*
+            预分配桶,n是预计的总键数
+        */
+        void reserve(size_t n)
+        {
+            for (size_t i = 0; i < shards(); i++)
+            {
+                WriteGuard guard(_shards[i].lock);
+                _shards[i].map.reserve(n / shards() + 1);
+            }
+        }
+        /*
+            找到时拷贝到out
+        */
+        bool find(const K &key, V &out) const
+        {
+            Shard &s = shard(key);
+            ReadGuard guard(s.lock);
+            auto it = s.map.find(key);
+            if (it == s.map.end())
+                return false;
+            out = it->second;
+            return true;
+        }
+        bool contains(const K &key) const
+        {
+            Shard &s = shard(key);
+            ReadGuard guard(s.lock);
+            return s.map.count(key) != 0;
+        }
+        /*
+            找到时在读锁内调用f(const V &),不拷贝值
+        */
+        template <class F>
+        bool visit(const K &key, F f) const
+        {
+            Shard &s = shard(key);
+            ReadGuard guard(s.lock);
+            auto it = s.map.find(key);
+            if (it == s.map.end())
+                return false;
+            f(it->second);
+            return true;
+        }
+        /*
+            找到时在读锁内调用f(const V &),否则在同一把读锁内调用missing(),
+            期间别的线程插不进这个键;返回是否找到
+        */
+        template <class F, class G>
+        bool visit(const K &key, F f, G missing) const
+        {
+            Shard &s = shard(key);
+            ReadGuard guard(s.lock);
+            auto it = s.map.find(key);
+            if (it == s.map.end())
+            {
+                missing();
+                return false;
+            }
+            f(it->second);
+            return true;
+        }
+        /*
+            插入或覆盖,返回是否是新键
+        */
+        bool set(const K &key, V value)
+        {
+            Shard &s = shard(key);
+            WriteGuard guard(s.lock);
+            auto it = s.map.find(key);
+            if (it != s.map.end())
+            {
+                it->second = std::move(value);
+                return false;
+            }
+            s.map.emplace(key, std::move(value));
+            return true;
+        }
+        /*
+            键不存在时才插入
+        */
+        bool insert(const K &key, V value)
+        {
+            Shard &s = shard(key);
+            WriteGuard guard(s.lock);
+            return s.map.emplace(key, std::move(value)).second;
+        }
+        /*
+            找到时在写锁内调用f(V &)
+        */
+        template <class F>
+        bool update(const K &key, F f)
+        {
+            Shard &s = shard(key);
+            WriteGuard guard(s.lock);
+            auto it = s.map.find(key);
+            if (it == s.map.end())
+                return false;
+            f(it->second);
+            return true;
+        }
+        /*
+            不存在时先插入V(),再在写锁内调用f(V &);返回是否是新键
+        */
+        template <class F>
+        bool upsert(const K &key, F f)
+        {
+            Shard &s = shard(key);
+            WriteGuard guard(s.lock);
+            auto r = s.map.emplace(key, V());
+            f(r.first->second);
+            return r.second;
+        }
+        bool erase(const K &key)
+        {
+            Shard &s = shard(key);
+            WriteGuard guard(s.lock);
+            return s.map.erase(key) != 0;
+        }
+        /*
+            pred(const V &)为真时才删除,检查和删除在同一把写锁内
+        */
+        template <class Pred>
+        bool eraseIf(const K &key, Pred pred)
+        {
+            Shard &s = shard(key);
+            WriteGuard guard(s.lock);
+            auto it = s.map.find(key);
+            if (it == s.map.end() || !pred(it->second))
+                return false;
+            s.map.erase(it);
+            return true;
+        }
+        /*
+            逐片加读锁累加,并发修改时只是近似值
+        */
+        size_t size() const
+        {
+            size_t n = 0;
+            for (size_t i = 0; i < shards(); i++)
+            {
+                ReadGuard guard(_shards[i].lock);
+                n += _shards[i].map.size();
+            }
+            return n;
+        }
+        /*
+            逐片加读锁调用f(const K &, const V &),不是整张表的快照
+        */
+        template <class F>
+        void forEach(F f) const
+        {
+            for (size_t i = 0; i < shards(); i++)
+            {
+                ReadGuard guard(_shards[i].lock);
+                for (auto it = _shards[i].map.begin(); it != _shards[i].map.end(); ++it)
+                    f(it->first, it->second);
+            }
+        }
+        void clear()
+        {
+            for (size_t i = 0; i < shards(); i++)
+            {
+                WriteGuard guard(_shards[i].lock);
+                _shards[i].map.clear();
+            }
+        }
+
+    private:
+        struct Shard
+        {
+            RWLock lock;
+            std::unordered_map<K, V, Hash> map;
+            char pad[CACHELINE]; // 相邻分片的锁不在同一缓存行
+        };
+        /*
+            std::hash对整数是恒等映射,乘以黄金比例后取高位,连续的ID也能均匀分片
+        */
+        Shard &shard(const K &key) const
+        {
+            if (_bits == 0)
+                return _shards[0];
+            uint64_t h = (uint64_t)_hash(key) * 0x9E3779B97F4A7C15ULL;
+            return _shards[h >> (64 - _bits)];
+        }
+
+    private:
+        unsigned _bits;
+        std::unique_ptr<Shard[]> _shards;
+        Hash _hash;
+    };
+}
@@ -1,14 +1,56 @@
+#pragma once
 #include <vector>
 #include <queue>
+#include <deque>
+#include <string>
 #include <memory>
+#include <atomic>
 #include <functional>
+#include <type_traits>
+#include <utility>
+#include <tuple>
+#include <new>
+#include <exception>
+#include <stdexcept>
+#include <algorithm>
+#include <stdint.h>
+#include <stdio.h>
+#include <dirent.h>
+#include <time.h>
+#include <errno.h>
 #include <semaphore.h>
 #include <pthread.h>
+#include <sched.h>
 #include <unistd.h>
 
 namespace thread
 {
 #define DEFAULTMAX 2024
+#define CACHELINE 64
+#define SPINCOUNT 128
+    inline void cpuRelax()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__)
+        asm volatile("yield");
+#endif
+    }
+    /*
+        毫秒时间戳,默认单调时钟
+    */
+    inline int64_t clockMs(clockid_t id = CLOCK_MONOTONIC)
+    {
+        timespec ts;
+        clock_gettime(id, &ts);
+        return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+    }
+    inline int64_t clockNs(clockid_t id = CLOCK_MONOTONIC)
+    {
+        timespec ts;
+        clock_gettime(id, &ts);
+        return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+    }
     class Mutex
     {
     public:
@@ -51,6 +93,72 @@ namespace thread
     private:
         Mutex &_mutex;
     };
+    /*
+        读写锁,读多写少时用;默认写优先,持续的读不会饿死写
+    */
+    class RWLock
+    {
+    public:
+        RWLock()
+        {
+            pthread_rwlockattr_t attr;
+            pthread_rwlockattr_init(&attr);
+            pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+            pthread_rwlock_init(&_lock, &attr);
+            pthread_rwlockattr_destroy(&attr);
+        }
+        ~RWLock()
+        {
+            pthread_rwlock_destroy(&_lock);
+        }
+        RWLock(const RWLock &) = delete;
+        RWLock &operator=(const RWLock &) = delete;
+        void readLock()
+        {
+            pthread_rwlock_rdlock(&_lock);
+        }
+        void writeLock()
+        {
+            pthread_rwlock_wrlock(&_lock);
+        }
+        void unlock()
+        {
+            pthread_rwlock_unlock(&_lock);
+        }
+
+    private:
+        pthread_rwlock_t _lock;
+    };
+    class ReadGuard
+    {
+    public:
+        ReadGuard(RWLock &lock) : _lock(lock)
+        {
+            _lock.readLock();
+        }
+        ~ReadGuard()
+        {
+            _lock.unlock();
+        }
+
+    private:
+        RWLock &_lock;
+    };
+    class WriteGuard
+    {
+    public:
+        WriteGuard(RWLock &lock) : _lock(lock)
+        {
+            _lock.writeLock();
+        }
+        ~WriteGuard()
+        {
+            _lock.unlock();
+        }
+
+    private:
+        RWLock &_lock;
+    };
     class Condition
     {
     public:
@@ -66,6 +174,22 @@ namespace thread
         {
             pthread_cond_wait(&_cond, mutex.get());
         }
+        /*
+            超时返回false
+        */
+        bool timedWait(Mutex &mutex, long ms)
+        {
+            timespec ts;
+            clock_gettime(CLOCK_REALTIME, &ts);
+            ts.tv_sec += ms / 1000;
+            ts.tv_nsec += (ms % 1000) * 1000000;
+            if (ts.tv_nsec >= 1000000000)
+            {
+                ts.tv_sec++;
+                ts.tv_nsec -= 1000000000;
+            }
+            return pthread_cond_timedwait(&_cond, mutex.get(), &ts) != ETIMEDOUT;
+        }
         void brosdcast()
         {
             pthread_cond_broadcast(&_cond);
@@ -137,118 +261,1890 @@ namespace thread
         size_t _max;
         std::queue<T> _queue;
     };
-    class Thread
+    /*
+        先自旋再睡眠的等待器
+        通知方只有在有线程睡眠时才会加锁唤醒
+    */
+    class Waiter
     {
     public:
-        using func = std::function<void()>;
-        Thread(func &f) : _func(f)
+        Waiter() : _sleepers(0)
         {
         }
-        Thread(func &&f) : _func(f)
+        /*
+            pred返回true时结束等待,pred可能被调用多次
+        */
+        template <class Pred>
+        void wait(Pred pred)
         {
+            for (int i = 0; i < SPINCOUNT; i++)
+            {
+                if (pred())
+                    return;
+                cpuRelax();
+            }
+            sched_yield();
+            {
+                Guard guard(_mutex);
+                _sleepers.fetch_add(1);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                while (!pred())
+                    _cond.wait(_mutex);
+                _sleepers.fetch_sub(1);
+            }
         }
-        ~Thread()
+        /*
+            最多等待ms毫秒,超时返回pred()的最后结果
+        */
+        template <class Pred>
+        bool waitFor(Pred pred, long ms)
         {
+            for (int i = 0; i < SPINCOUNT; i++)
+            {
+                if (pred())
+                    return true;
+                cpuRelax();
+            }
+            sched_yield();
+            int64_t deadline = clockMs() + ms;
+            bool ok;
+            {
+                Guard guard(_mutex);
+                _sleepers.fetch_add(1);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                while (!(ok = pred()))
+                {
+                    long left = (long)(deadline - clockMs());
+                    if (left <= 0)
+                        break;
+                    _cond.timedWait(_mutex, left);
+                }
+                _sleepers.fetch_sub(1);
+            }
+            return ok;
         }
-        void start()
+        void notifyOne()
         {
-            _thread = pthread_create(&_thread, NULL, run, (void *)this);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (_sleepers.load(std::memory_order_relaxed) > 0)
+            {
+                Guard guard(_mutex);
+                _cond.signal();
+            }
         }
-        void join()
+        void notifyAll()
         {
-            pthread_join(_thread, NULL);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (_sleepers.load(std::memory_order_relaxed) > 0)
+            {
+                Guard guard(_mutex);
+                _cond.brosdcast();
+            }
         }
-
-    private:
-        static void *run(void *this_)
+        /*
+            最多唤醒n个,只加一次锁
+        */
+        void notify(size_t n)
         {
-            ((Thread *)this_)->_func();
-            return NULL;
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (n == 0 || _sleepers.load(std::memory_order_relaxed) <= 0)
+                return;
+            Guard guard(_mutex);
+            if (n >= (size_t)_sleepers.load(std::memory_order_relaxed))
+                _cond.brosdcast();
+            else
+            {
+                while (n--)
+                    _cond.signal();
+            }
         }
 
     private:
-        pthread_t _thread;
-        func _func;
+        std::atomic<int> _sleepers;
+        Mutex _mutex;
+        Condition _cond;
     };
-    class ThreadPool
+    /*
+        有界无锁多生产者多消费者队列(按序号的环形缓冲)
+        容量向上取整为2的幂,接口与BlackQueue相同
+    */
+    template <class T>
+    class RingQueue
     {
     public:
-        ThreadPool(size_t n) : isStart(false), endNum(0)
+        RingQueue(size_t max = DEFAULTMAX)
+        {
+            size_t n = 2;
+            while (n < max)
+                n <<= 1;
+            _mask = n - 1;
+            _cells = new Cell[n];
+            for (size_t i = 0; i < n; i++)
+                _cells[i].seq.store(i, std::memory_order_relaxed);
+            _tail.store(0, std::memory_order_relaxed);
+            _head.store(0, std::memory_order_relaxed);
+        }
+        ~RingQueue()
         {
-            for (int i = 0; i < n; ++i)
+            T t;
+            while (pop(t))
             {
-                _thread.push_back(Thread(std::bind(ThreadPool::run, this)));
             }
+            delete[] _cells;
         }
-        ThreadPool(ThreadPool &) = delete;
-        ThreadPool(ThreadPool &&) = delete;
-        // class data
-        // {
-        //     virtual ~data() = 0;
-        // };
-        // using dataPtr = std::shared_ptr<data>;
-        // using reback = std::function<void()>;
-        using func = std::function<void()>;
-        void push_back(const func &v)
+        RingQueue(const RingQueue &) = delete;
+        RingQueue &operator=(const RingQueue &) = delete;
+
+        bool tryPushBack(const T &v)
         {
-            _value.pushBack(v);
+            if (!push(v))
+                return false;
+            _notEmpty.notifyOne();
+            return true;
         }
-        void push_back(func &&v)
+        bool tryPushBack(T &&v)
         {
-            _value.pushBack(v);
+            if (!push(std::move(v)))
+                return false;
+            _notEmpty.notifyOne();
+            return true;
         }
-        void start()
+        /*
+            一次CAS占用连续的最多n个位置,从first依次移动进来,返回放入的个数
+            只做一次唤醒
+        */
+        template <class It>
+        size_t tryPushBatch(It first, size_t n)
+        {
+            size_t k;
+            size_t pos = _tail.load(std::memory_order_relaxed);
+            while (1)
+            {
+                for (k = 0; k < n; k++)
+                {
+                    size_t seq = _cells[(pos + k) & _mask].seq.load(std::memory_order_acquire);
+                    if (seq != pos + k)
+                        break;
+                }
+                if (k == 0)
+                {
+                    size_t seq = _cells[pos & _mask].seq.load(std::memory_order_acquire);
+                    if ((intptr_t)seq - (intptr_t)pos < 0)
+                        return 0; // 满
+                    pos = _tail.load(std::memory_order_relaxed);
+                    continue;
+                }
+                if (_tail.compare_exchange_weak(pos, pos + k, std::memory_order_relaxed))
+                    break;
+            }
+            for (size_t i = 0; i < k; i++, ++first)
+            {
+                Cell *cell = &_cells[(pos + i) & _mask];
+                new (&cell->data) T(std::move(*first));
+                cell->seq.store(pos + i + 1, std::memory_order_release);
+            }
+            _notEmpty.notify(k);
+            return k;
+        }
+        /*
+            失败时t不变
+        */
+        bool tryPopFront(T &t)
+        {
+            if (!pop(t))
+                return false;
+            _notFull.notifyOne();
+            return true;
+        }
+        void pushBack(const T &v)
+        {
+            _notFull.wait([&]()
+                          { return push(v); });
+            _notEmpty.notifyOne();
+        }
+        void pushBack(T &&v)
+        {
+            _notFull.wait([&]()
+                          { return push(std::move(v)); });
+            _notEmpty.notifyOne();
+        }
+        T popFront()
+        {
+            T t;
+            _notEmpty.wait([&]()
+                           { return pop(t); });
+            _notFull.notifyOne();
+            return t;
+        }
+        /*
+            取走队列中现有的全部元素,q中原有元素放回队列(队列满时阻塞)
+        */
+        void swap(std::queue<T> &q)
         {
-            isStart = true;
-            endNum = 0;
-            for (int i = 0; i < _thread.size(); i++)
-                _thread[i].start();
+            std::queue<T> tmp;
+            T t;
+            while (tryPopFront(t))
+                tmp.push(std::move(t));
+            while (!q.empty())
+            {
+                pushBack(std::move(q.front()));
+                q.pop();
+            }
+            q.swap(tmp);
+        }
+        /*
+            近似值
+        */
+        size_t size() const
+        {
+            size_t tail = _tail.load(std::memory_order_relaxed);
+            size_t head = _head.load(std::memory_order_relaxed);
+            return tail > head ? tail - head : 0;
+        }
+        size_t capacity() const
+        {
+            return _mask + 1;
+        }
+
+    private:
+        struct Cell
+        {
+            std::atomic<size_t> seq;
+            typename std::aligned_storage<sizeof(T), alignof(T)>::type data;
+        };
+        template <class V>
+        bool push(V &&v)
+        {
+            Cell *cell;
+            size_t pos = _tail.load(std::memory_order_relaxed);
+            while (1)
+            {
+                cell = &_cells[pos & _mask];
+                size_t seq = cell->seq.load(std::memory_order_acquire);
+                intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+                if (diff == 0)
+                {
+                    if (_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        break;
+                }
+                else if (diff < 0)
+                    return false; // 满
+                else
+                    pos = _tail.load(std::memory_order_relaxed);
+            }
+            new (&cell->data) T(std::forward<V>(v));
+            cell->seq.store(pos + 1, std::memory_order_release);
+            return true;
         }
-        void stop()
+        bool pop(T &t)
         {
-            if (isStart)
+            Cell *cell;
+            size_t pos = _head.load(std::memory_order_relaxed);
+            while (1)
             {
-                Thread t(std::bind(ThreadPool::stopThread, this));
-                t.start();
-                for (int i = 0; i < _thread.size(); i++)
+                cell = &_cells[pos & _mask];
+                size_t seq = cell->seq.load(std::memory_order_acquire);
+                intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+                if (diff == 0)
                 {
-                    _thread[i].join();
-                    endNum++;
+                    if (_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        break;
                 }
-                t.join();
+                else if (diff < 0)
+                    return false; // 空
+                else
+                    pos = _head.load(std::memory_order_relaxed);
             }
-            isStart = true;
+            T *p = reinterpret_cast<T *>(&cell->data);
+            t = std::move(*p);
+            p->~T();
+            cell->seq.store(pos + _mask + 1, std::memory_order_release);
+            return true;
         }
 
     private:
-        static void run(ThreadPool *this_)
+        char _pad0[CACHELINE];
+        std::atomic<size_t> _tail; // 生产者
+        char _pad1[CACHELINE - sizeof(std::atomic<size_t>)];
+        std::atomic<size_t> _head; // 消费者
+        char _pad2[CACHELINE - sizeof(std::atomic<size_t>)];
+        Cell *_cells;
+        size_t _mask;
+        Waiter _notEmpty;
+        Waiter _notFull;
+    };
+    /*
+        Chase-Lev工作窃取双端队列
+        只有所属线程可以pushBottom/popBottom,其他线程只能steal
+        T必须可平凡复制(一般是指针)
+    */
+    template <class T>
+    class StealDeque
+    {
+    public:
+        StealDeque(size_t capacity = 1024) : _top(0), _bottom(0)
         {
-            std::queue<func> task;
-            while (1)
+            size_t n = 2;
+            while (n < capacity)
+                n <<= 1;
+            _array.store(new Array(n), std::memory_order_relaxed);
+        }
+        ~StealDeque()
+        {
+            delete _array.load(std::memory_order_relaxed);
+            for (size_t i = 0; i < _garbage.size(); i++)
+                delete _garbage[i];
+        }
+        StealDeque(const StealDeque &) = delete;
+        StealDeque &operator=(const StealDeque &) = delete;
+
+        void pushBottom(T v)
+        {
+            int64_t b = _bottom.load(std::memory_order_relaxed);
+            int64_t t = _top.load(std::memory_order_acquire);
+            Array *a = _array.load(std::memory_order_relaxed);
+            if (b - t > (int64_t)a->mask)
+                a = grow(a, t, b);
+            a->put(b, v);
+            _bottom.store(b + 1, std::memory_order_release);
+        }
+        bool popBottom(T &v)
+        {
+            int64_t b = _bottom.load(std::memory_order_relaxed) - 1;
+            Array *a = _array.load(std::memory_order_relaxed);
+            _bottom.store(b, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t t = _top.load(std::memory_order_relaxed);
+            if (t > b)
+            {
+                _bottom.store(b + 1, std::memory_order_relaxed);
+                return false;
+            }
+            v = a->get(b);
+            if (t == b)
+            {
+                // 最后一个元素,和steal竞争
+                bool ok = _top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+                _bottom.store(b + 1, std::memory_order_relaxed);
+                return ok;
+            }
+            return true;
+        }
+        bool steal(T &v)
+        {
+            int64_t t = _top.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t b = _bottom.load(std::memory_order_acquire);
+            if (t >= b)
+                return false;
+            Array *a = _array.load(std::memory_order_acquire);
+            T x = a->get(t);
+            if (!_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                return false;
+            v = x;
+            return true;
+        }
+        /*
+            近似值
+        */
+        size_t size() const
+        {
+            int64_t b = _bottom.load(std::memory_order_relaxed);
+            int64_t t = _top.load(std::memory_order_relaxed);
+            return b > t ? (size_t)(b - t) : 0;
+        }
+
+    private:
+        struct Array
+        {
+            Array(size_t n) : mask(n - 1), buffer(new std::atomic<T>[n])
+            {
+            }
+            ~Array()
+            {
+                delete[] buffer;
+            }
+            T get(int64_t i) const
+            {
+                return buffer[i & mask].load(std::memory_order_relaxed);
+            }
+            void put(int64_t i, T v)
+            {
+                buffer[i & mask].store(v, std::memory_order_relaxed);
+            }
+            size_t mask;
+            std::atomic<T> *buffer;
+        };
+        Array *grow(Array *a, int64_t t, int64_t b)
+        {
+            Array *bigger = new Array((a->mask + 1) * 2);
+            for (int64_t i = t; i < b; i++)
+                bigger->put(i, a->get(i));
+            // 窃取者可能仍在读旧数组,析构时再释放
+            _garbage.push_back(a);
+            _array.store(bigger, std::memory_order_release);
+            return bigger;
+        }
+
+    private:
+        std::atomic<int64_t> _top;
+        char _pad0[CACHELINE - sizeof(std::atomic<int64_t>)];
+        std::atomic<int64_t> _bottom;
+        char _pad1[CACHELINE - sizeof(std::atomic<int64_t>)];
+        std::atomic<Array *> _array;
+        std::vector<Array *> _garbage;
+    };
+    /*
+        绑定参数的可调用对象,参数按值保存,调用时以左值传入
+    */
+    template <class F, class... Args>
+    struct Bound
+    {
+        template <class G, class... A>
+        Bound(G &&g, A &&...a) : f(std::forward<G>(g)), args(std::forward<A>(a)...)
+        {
+        }
+        auto operator()() -> decltype(std::declval<F &>()(std::declval<Args &>()...))
+        {
+            return call(std::index_sequence_for<Args...>());
+        }
+        template <size_t... I>
+        auto call(std::index_sequence<I...>) -> decltype(std::declval<F &>()(std::declval<Args &>()...))
+        {
+            return f(std::get<I>(args)...);
+        }
+        F f;
+        std::tuple<Args...> args;
+    };
+    /*
+        只可移动的任务类型,不超过TASKINLINE字节且可无异常移动的可调用对象直接存放在对象内部,
+        否则放到堆上
+    */
+#define TASKINLINE 56
+    class Task
+    {
+    public:
+        Task() noexcept : _ops(NULL)
+        {
+        }
+        template <class F, class = typename std::enable_if<!std::is_same<typename std::decay<F>::type, Task>::value>::type>
+        Task(F &&f) : _ops(NULL)
+        {
+            init<typename std::decay<F>::type>(std::forward<F>(f));
+        }
+        /*
+            绑定参数,等价于std::bind(f, args...)但不做类型擦除之外的分配
+        */
+        template <class F, class Arg, class... Args>
+        Task(F &&f, Arg &&arg, Args &&...args) : _ops(NULL)
+        {
+            using bound = Bound<typename std::decay<F>::type, typename std::decay<Arg>::type, typename std::decay<Args>::type...>;
+            init<bound>(bound(std::forward<F>(f), std::forward<Arg>(arg), std::forward<Args>(args)...));
+        }
+        Task(Task &&other) noexcept : _ops(other._ops)
+        {
+            if (_ops)
+            {
+                _ops->move(&_storage, &other._storage);
+                other._ops = NULL;
+            }
+        }
+        Task &operator=(Task &&other) noexcept
+        {
+            if (this != &other)
             {
-                this_->_value.swap(task);
-                int len = task.size();
-                while (len--)
+                reset();
+                if (other._ops)
                 {
-                    task.front()();
-                    task.pop();
+                    _ops = other._ops;
+                    _ops->move(&_storage, &other._storage);
+                    other._ops = NULL;
                 }
             }
+            return *this;
+        }
+        Task(const Task &) = delete;
+        Task &operator=(const Task &) = delete;
+        ~Task()
+        {
+            reset();
+        }
+        void operator()()
+        {
+            _ops->invoke(&_storage);
+        }
+        explicit operator bool() const
+        {
+            return _ops != NULL;
+        }
+        void swap(Task &other)
+        {
+            Task tmp(std::move(other));
+            other = std::move(*this);
+            *this = std::move(tmp);
+        }
+        void reset()
+        {
+            if (_ops)
+            {
+                _ops->destroy(&_storage);
+                _ops = NULL;
+            }
         }
-        static void stopThread(ThreadPool *this_)
+
+    private:
+        using storage = typename std::aligned_storage<TASKINLINE, alignof(void *)>::type;
+        struct Ops
+        {
+            void (*invoke)(storage *);
+            void (*move)(storage *dst, storage *src);
+            void (*destroy)(storage *);
+        };
+        template <class F>
+        struct InlineOps
         {
-            while (this_->endNum != this_->_thread.size())
+            static void invoke(storage *s)
             {
-                this_->_value.pushBack([]()
-                                       { pthread_exit(NULL); });
-                usleep(10);
+                (*reinterpret_cast<F *>(s))();
             }
+            static void move(storage *dst, storage *src)
+            {
+                new (dst) F(std::move(*reinterpret_cast<F *>(src)));
+                reinterpret_cast<F *>(src)->~F();
+            }
+            static void destroy(storage *s)
+            {
+                reinterpret_cast<F *>(s)->~F();
+            }
+            static const Ops *get()
+            {
+                static const Ops ops = {invoke, move, destroy};
+                return &ops;
+            }
+        };
+        template <class F>
+        struct HeapOps
+        {
+            static void invoke(storage *s)
+            {
+                (**reinterpret_cast<F **>(s))();
+            }
+            static void move(storage *dst, storage *src)
+            {
+                *reinterpret_cast<F **>(dst) = *reinterpret_cast<F **>(src);
+            }
+            static void destroy(storage *s)
+            {
+                delete *reinterpret_cast<F **>(s);
+            }
+            static const Ops *get()
+            {
+                static const Ops ops = {invoke, move, destroy};
+                return &ops;
+            }
+        };
+        template <class F>
+        struct fitsInline
+            : std::integral_constant<bool, sizeof(F) <= sizeof(storage) && alignof(F) <= alignof(storage) &&
+                                               std::is_nothrow_move_constructible<F>::value>
+        {
+        };
+        template <class F, class G>
+        typename std::enable_if<fitsInline<F>::value>::type init(G &&g)
+        {
+            new (&_storage) F(std::forward<G>(g));
+            _ops = InlineOps<F>::get();
+        }
+        template <class F, class G>
+        typename std::enable_if<!fitsInline<F>::value>::type init(G &&g)
+        {
+            *reinterpret_cast<F **>(&_storage) = new F(std::forward<G>(g));
+            _ops = HeapOps<F>::get();
+        }
+
+    private:
+        const Ops *_ops;
+        storage _storage;
+    };
+    /*
+        Future的结果存放处,void特化为空
+    */
+    template <class R>
+    class FutureSlot
+    {
+    public:
+        FutureSlot() : _has(false)
+        {
+        }
+        ~FutureSlot()
+        {
+            if (_has)
+                reinterpret_cast<R *>(&_data)->~R();
+        }
+        template <class F>
+        void set(F &f)
+        {
+            new (&_data) R(f());
+            _has = true;
+        }
+        R take()
+        {
+            return std::move(*reinterpret_cast<R *>(&_data));
         }
 
     private:
-        BlackQueue<func> _value;
+        typename std::aligned_storage<sizeof(R), alignof(R)>::type _data;
+        bool _has;
+    };
+    template <>
+    class FutureSlot<void>
+    {
+    public:
+        template <class F>
+        void set(F &f)
+        {
+            f();
+        }
+        void take()
+        {
+        }
+    };
+    /*
+        Future与任务共享的状态,侵入式引用计数
+    */
+    template <class R>
+    class FutureState
+    {
+    public:
+        FutureState() : _refs(1), _ready(false)
+        {
+        }
+        void retain()
+        {
+            _refs.fetch_add(1, std::memory_order_relaxed);
+        }
+        void release()
+        {
+            if (_refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                delete this;
+        }
+        template <class F>
+        void run(F &f)
+        {
+            try
+            {
+                _slot.set(f);
+            }
+            catch (...)
+            {
+                _error = std::current_exception();
+            }
+            finish();
+        }
+        void fail(std::exception_ptr error)
+        {
+            _error = error;
+            finish();
+        }
+        bool ready() const
+        {
+            return _ready.load(std::memory_order_acquire);
+        }
+        void wait()
+        {
+            _waiter.wait([this]()
+                         { return ready(); });
+        }
+        R get()
+        {
+            wait();
+            if (_error)
+                std::rethrow_exception(_error);
+            return _slot.take();
+        }
+
+    private:
+        void finish()
+        {
+            _ready.store(true, std::memory_order_release);
+            _waiter.notifyAll();
+        }
+
+    private:
+        std::atomic<int> _refs;
+        std::atomic<bool> _ready;
+        std::exception_ptr _error;
+        FutureSlot<R> _slot;
+        Waiter _waiter;
+    };
+    /*
+        ThreadPool::submit的返回值,只可移动
+        不要在同一个线程池的工作线程里等待该线程池的任务,所有线程都在等待时会死锁
+    */
+    template <class R>
+    class Future
+    {
+    public:
+        Future() : _state(NULL)
+        {
+        }
+        explicit Future(FutureState<R> *state) : _state(state)
+        {
+        }
+        Future(Future &&other) noexcept : _state(other._state)
+        {
+            other._state = NULL;
+        }
+        Future &operator=(Future &&other) noexcept
+        {
+            if (this != &other)
+            {
+                if (_state)
+                    _state->release();
+                _state = other._state;
+                other._state = NULL;
+            }
+            return *this;
+        }
+        Future(const Future &) = delete;
+        Future &operator=(const Future &) = delete;
+        ~Future()
+        {
+            if (_state)
+                _state->release();
+        }
+        bool valid() const
+        {
+            return _state != NULL;
+        }
+        bool ready() const
+        {
+            return _state->ready();
+        }
+        void wait() const
+        {
+            _state->wait();
+        }
+        /*
+            只能调用一次,任务抛出的异常在这里重新抛出
+        */
+        R get()
+        {
+            return _state->get();
+        }
+
+    private:
+        FutureState<R> *_state;
+    };
+    /*
+        带结果的任务,未执行就被丢弃时Future得到异常而不是一直等待
+    */
+    template <class R, class F>
+    class Packaged
+    {
+    public:
+        template <class G>
+        Packaged(G &&f, FutureState<R> *state) : _f(std::forward<G>(f)), _state(state)
+        {
+            _state->retain();
+        }
+        Packaged(Packaged &&other) noexcept : _f(std::move(other._f)), _state(other._state)
+        {
+            other._state = NULL;
+        }
+        Packaged(const Packaged &) = delete;
+        ~Packaged()
+        {
+            if (_state)
+            {
+                _state->fail(std::make_exception_ptr(std::runtime_error("thread::ThreadPool: task discarded")));
+                _state->release();
+            }
+        }
+        void operator()()
+        {
+            FutureState<R> *state = _state;
+            _state = NULL;
+            state->run(_f);
+            state->release();
+        }
+
+    private:
+        F _f;
+        FutureState<R> *_state;
+    };
+    /*
+        CPU拓扑,来自/sys/devices/system/node,只包含本进程允许使用的CPU
+        没有NUMA信息时视为一个节点
+    */
+    class Topology
+    {
+    public:
+        static const Topology &get()
+        {
+            static Topology topology;
+            return topology;
+        }
+        const std::vector<int> &cpus() const
+        {
+            return _cpus;
+        }
+        const std::vector<std::vector<int>> &nodes() const
+        {
+            return _nodes;
+        }
+
+    private:
+        Topology()
+        {
+            cpu_set_t allowed;
+            CPU_ZERO(&allowed);
+            if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+            {
+                long n = sysconf(_SC_NPROCESSORS_ONLN);
+                for (long i = 0; i < n && i < CPU_SETSIZE; i++)
+                    CPU_SET(i, &allowed);
+            }
+            for (int i = 0; i < CPU_SETSIZE; i++)
+            {
+                if (CPU_ISSET(i, &allowed))
+                    _cpus.push_back(i);
+            }
+            DIR *dir = opendir("/sys/devices/system/node");
+            if (dir)
+            {
+                std::vector<int> ids;
+                dirent *ent;
+                while ((ent = readdir(dir)) != NULL)
+                {
+                    int id;
+                    if (sscanf(ent->d_name, "node%d", &id) == 1)
+                        ids.push_back(id);
+                }
+                closedir(dir);
+                std::sort(ids.begin(), ids.end());
+                for (size_t i = 0; i < ids.size(); i++)
+                {
+                    std::vector<int> cpus = readCpuList(ids[i], allowed);
+                    if (!cpus.empty())
+                        _nodes.push_back(cpus);
+                }
+            }
+            if (_nodes.empty())
+                _nodes.push_back(_cpus);
+        }
+        /*
+            格式如 0-3,8-11
+        */
+        static std::vector<int> readCpuList(int node, const cpu_set_t &allowed)
+        {
+            std::vector<int> cpus;
+            char path[64];
+            snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+            FILE *fp = fopen(path, "r");
+            if (fp == NULL)
+                return cpus;
+            char buf[1024];
+            if (fgets(buf, sizeof(buf), fp))
+            {
+                char *p = buf;
+                while (*p)
+                {
+                    int first, last, len;
+                    if (sscanf(p, "%d-%d%n", &first, &last, &len) == 2)
+                        p += len;
+                    else if (sscanf(p, "%d%n", &first, &len) == 1)
+                    {
+                        last = first;
+                        p += len;
+                    }
+                    else
+                        break;
+                    for (int i = first; i <= last && i < CPU_SETSIZE; i++)
+                    {
+                        if (CPU_ISSET(i, &allowed))
+                            cpus.push_back(i);
+                    }
+                    if (*p == ',')
+                        p++;
+                }
+            }
+            fclose(fp);
+            return cpus;
+        }
+
+    private:
+        std::vector<int> _cpus;
+        std::vector<std::vector<int>> _nodes;
+    };
+    /*
+        cpus为空不绑核,stackSize为0用默认栈大小,name超过15个字符会被截断
+    */
+    struct ThreadOption
+    {
+        std::vector<int> cpus;
+        size_t stackSize = 0;
+        std::string name;
+    };
+    class Thread
+    {
+    public:
+        using func = std::function<void()>;
+        Thread(func &f) : _func(f), _started(false)
+        {
+        }
+        Thread(func &&f) : _func(f), _started(false)
+        {
+        }
+        Thread(func &&f, const ThreadOption &option) : _func(f), _option(option), _started(false)
+        {
+        }
+        ~Thread()
+        {
+        }
+        bool start()
+        {
+            pthread_attr_t attr;
+            pthread_attr_init(&attr);
+            if (_option.stackSize > 0)
+                pthread_attr_setstacksize(&attr, _option.stackSize);
+            if (!_option.cpus.empty())
+            {
+                cpu_set_t set;
+                CPU_ZERO(&set);
+                for (size_t i = 0; i < _option.cpus.size(); i++)
+                    CPU_SET(_option.cpus[i], &set);
+                pthread_attr_setaffinity_np(&attr, sizeof(set), &set);
+            }
+            _started = pthread_create(&_thread, &attr, run, (void *)this) == 0;
+            pthread_attr_destroy(&attr);
+            return _started;
+        }
+        /*
+            未启动或已join过时直接返回
+        */
+        void join()
+        {
+            if (_started)
+            {
+                pthread_join(_thread, NULL);
+                _started = false;
+            }
+        }
+        bool joinable() const
+        {
+            return _started;
+        }
+        const ThreadOption &option() const
+        {
+            return _option;
+        }
+
+    private:
+        static void *run(void *this_)
+        {
+            Thread *t = (Thread *)this_;
+            if (!t->_option.name.empty())
+                pthread_setname_np(pthread_self(), t->_option.name.substr(0, 15).c_str());
+            t->_func();
+            return NULL;
+        }
+
+    private:
+        pthread_t _thread;
+        func _func;
+        ThreadOption _option;
+        bool _started;
+    };
+    /*
+        SCHEDULE_SHARED: 所有线程共用一个队列
+        SCHEDULE_STEALING: 每个线程有自己的双端队列,线程内提交的任务进自己的队列,
+                           空闲时从共享队列取或者从其他线程窃取
+    */
+    enum schedule_mode
+    {
+        SCHEDULE_SHARED,
+        SCHEDULE_STEALING,
+    };
+    /*
+        PLACE_NONE: 不绑核
+        PLACE_CORE: 每个线程绑定一个CPU,线程数多于CPU时轮流复用
+        PLACE_NODE: 线程轮流分配到各NUMA节点,绑定该节点的所有CPU
+        绑核后工作线程自己分配本地队列,按首次访问策略落在本节点内存上
+    */
+    enum placement
+    {
+        PLACE_NONE,
+        PLACE_CORE,
+        PLACE_NODE,
+    };
+    /*
+        优先级通道,按PoolOption::weights加权轮转:
+        每个线程每轮最多连续从一个通道取weights[lane]个任务,额度用完或通道为空时轮到下一个,
+        所以高优先级任务最多等待其他通道各自额度那么多个任务,低优先级通道在饱和时也保证有自己的份额
+        SCHEDULE_STEALING下只有LANE_NORMAL进入线程自己的队列
+    */
+    enum lane
+    {
+        LANE_HIGH,
+        LANE_NORMAL,
+        LANE_BULK,
+    };
+#define LANES 3
+#define LANEBUCKETS 40 // 等待时间按2的幂分桶(纳秒)
+    struct LaneStats
+    {
+        size_t depth;   // 排队中的任务数(近似值)
+        uint64_t count; // 已取出执行的任务数
+        uint64_t total; // 累计等待时间(纳秒)
+        uint64_t max;   // 最长等待时间(纳秒)
+        uint64_t p50;   // 等待时间分位数所在桶的上界(纳秒)
+        uint64_t p99;
+    };
+    struct PoolOption
+    {
+        schedule_mode mode = SCHEDULE_SHARED;
+        placement place = PLACE_NONE;
+        std::string name = "pool"; // 线程名为name-编号
+        size_t stackSize = 0;
+        /*
+            线程数在[minThreads,maxThreads]之间自动调整,0表示等于构造时的n,两者都为0即固定大小
+            积压任务数达到growDepth,或者按最近吞吐估算的排队时间达到growWait毫秒时增加线程,
+            空闲超过idleTimeout毫秒的线程退出
+        */
+        size_t minThreads = 0;
+        size_t maxThreads = 0;
+        size_t growDepth = 64;
+        long growWait = 5;
+        long idleTimeout = 30000;
+        unsigned weights[LANES] = {8, 4, 1}; // 依次为LANE_HIGH、LANE_NORMAL、LANE_BULK,0按1处理
+    };
+    enum resize_reason
+    {
+        RESIZE_DEPTH, // 积压过多
+        RESIZE_WAIT,  // 排队时间过长
+        RESIZE_IDLE,  // 空闲超时
+    };
+    struct ResizeEvent
+    {
+        int64_t time; // CLOCK_REALTIME毫秒
+        size_t from;
+        size_t to;
+        resize_reason reason;
+    };
+#define POOLTICK 10    // 监控线程采样间隔(毫秒)
+#define HISTORYMAX 256 // 保留的最近调整记录数
+    /*
+        STOP_DRAIN: 不再接受外部提交,执行完队列中(以及执行过程中派生)的任务后退出
+        STOP_CANCEL: 执行完手上的任务就退出,队列中剩余任务被丢弃,对应的Future得到异常
+    */
+    enum stop_mode
+    {
+        STOP_DRAIN,
+        STOP_CANCEL,
+    };
+    class ThreadPool
+    {
+    public:
+        ThreadPool(size_t n, schedule_mode mode = SCHEDULE_SHARED)
+            : _mode(mode), _running(false), _stopping(false), _cancel(false), _alive(0)
+        {
+            PoolOption option;
+            option.mode = mode;
+            init(n, option);
+        }
+        /*
+            n为start时的线程数
+        */
+        ThreadPool(size_t n, const PoolOption &option)
+            : _mode(option.mode), _running(false), _stopping(false), _cancel(false), _alive(0)
+        {
+            init(n, option);
+        }
+        ~ThreadPool()
+        {
+            stop(STOP_CANCEL);
+            for (size_t i = 0; i < _local.size(); i++)
+                delete _local[i].load();
+        }
+        ThreadPool(ThreadPool &) = delete;
+        ThreadPool(ThreadPool &&) = delete;
+        // class data
+        // {
+        //     virtual ~data() = 0;
+        // };
+        // using dataPtr = std::shared_ptr<data>;
+        // using reback = std::function<void()>;
+        using func = Task;
+        /*
+            工作线程提交时队列已满则直接在当前线程执行,避免所有线程都阻塞在提交上
+            stop开始后外部提交返回false,任务不会执行
+            每个通道有自己的队列,BULK满了不会阻塞HIGH的提交
+        */
+        bool push_back(func &&v, lane l = LANE_NORMAL)
+        {
+            if (!accept())
+                return false;
+            if (l != LANE_NORMAL || !pushLocal(v))
+            {
+                Entry entry(std::move(v));
+                if (current().pool != this)
+                    _lanes[l].pushBack(std::move(entry));
+                else if (!_lanes[l].tryPushBack(std::move(entry)))
+                {
+                    entry.task();
+                    return true;
+                }
+            }
+            _idle.notifyOne();
+            return true;
+        }
+        /*
+            post(f, a, b)等价于push_back(std::bind(f, a, b)),
+            闭包不超过TASKINLINE字节时不分配内存
+        */
+        template <class F, class... Args>
+        bool post(F &&f, Args &&...args)
+        {
+            return push_back(func(std::forward<F>(f), std::forward<Args>(args)...));
+        }
+        template <class F, class... Args>
+        bool post_to(lane l, F &&f, Args &&...args)
+        {
+            return push_back(func(std::forward<F>(f), std::forward<Args>(args)...), l);
+        }
+        /*
+            同post,但返回Future,共享状态需要一次分配
+        */
+        template <class F, class... Args>
+        Future<typename std::result_of<typename std::decay<F>::type &(typename std::decay<Args>::type &...)>::type>
+        submit(F &&f, Args &&...args)
+        {
+            return submit_to(LANE_NORMAL, std::forward<F>(f), std::forward<Args>(args)...);
+        }
+        template <class F, class... Args>
+        Future<typename std::result_of<typename std::decay<F>::type &(typename std::decay<Args>::type &...)>::type>
+        submit_to(lane l, F &&f, Args &&...args)
+        {
+            using R = typename std::result_of<typename std::decay<F>::type &(typename std::decay<Args>::type &...)>::type;
+            using bound = Bound<typename std::decay<F>::type, typename std::decay<Args>::type...>;
+            FutureState<R> *state = new FutureState<R>;
+            Future<R> future(state);
+            push_back(func(Packaged<R, bound>(bound(std::forward<F>(f), std::forward<Args>(args)...), state)), l);
+            return future;
+        }
+        /*
+            [begin,end)中每个元素是一个无参可调用对象(按值拷贝),
+            全部任务一次放入队列并只唤醒一次
+        */
+        template <class It>
+        std::vector<Future<typename std::result_of<typename std::decay<decltype(*std::declval<It>())>::type &()>::type>>
+        submit_batch(It begin, It end)
+        {
+            using F = typename std::decay<decltype(*begin)>::type;
+            using R = typename std::result_of<F &()>::type;
+            std::vector<Future<R>> futures;
+            std::vector<func> tasks;
+            for (It it = begin; it != end; ++it)
+            {
+                FutureState<R> *state = new FutureState<R>;
+                futures.push_back(Future<R>(state));
+                tasks.push_back(func(Packaged<R, F>(*it, state)));
+            }
+            pushBatch(tasks);
+            return futures;
+        }
+        /*
+            对[begin,end)的每个i调用f(i),返回时全部完成
+            调用线程也参与执行,所以在工作线程中调用不会死锁
+            grain为每块的大小,0表示自动
+        */
+        template <class F>
+        void parallel_for(size_t begin, size_t end, F f, size_t grain = 0)
+        {
+            if (begin >= end)
+                return;
+            size_t n = end - begin;
+            size_t helpers = size();
+            if (grain == 0)
+                grain = std::max<size_t>(1, n / ((helpers + 1) * 4));
+            std::shared_ptr<ForState> state(new ForState);
+            state->begin = begin;
+            state->end = end;
+            state->grain = grain;
+            state->chunks = (n + grain - 1) / grain;
+            state->body = [&f](size_t i)
+            { f(i); };
+            helpers = std::min(helpers, state->chunks - 1);
+            std::vector<func> tasks;
+            tasks.reserve(helpers);
+            for (size_t i = 0; i < helpers; i++)
+            {
+                tasks.push_back(func([state]()
+                                     { state->work(); }));
+            }
+            pushBatch(tasks);
+            state->work();
+            state->waiter.wait([&]()
+                               { return state->done.load(std::memory_order_acquire) == state->chunks; });
+            if (state->error)
+                std::rethrow_exception(state->error);
+        }
+        schedule_mode mode() const
+        {
+            return _mode;
+        }
+        void start()
+        {
+            if (_running)
+                return;
+            _stopping = false;
+            _cancel = false;
+            _running = true;
+            {
+                Guard guard(_exitMutex);
+                for (size_t i = 0; i < _initial; i++)
+                {
+                    if (_thread[i].start())
+                    {
+                        _slot[i].state = SLOT_RUNNING;
+                        _alive++;
+                    }
+                }
+                _size = _alive;
+            }
+            if (_monitor)
+                _monitor->start();
+        }
+        /*
+            timeout(毫秒)>=0时,DRAIN超时后转为CANCEL,停止耗时不超过timeout加上最长单个任务的时间
+            返回true表示所有已提交的任务都执行了
+            不能在本线程池的工作线程中调用
+        */
+        bool stop(stop_mode mode = STOP_DRAIN, long timeout = -1)
+        {
+            if (!_running)
+                return clear() == 0;
+            int64_t begin = clockMs();
+            {
+                // 先停监控线程,之后不会再有新线程启动
+                Guard guard(_exitMutex);
+                _stopping = true;
+                _monitorCond.signal();
+            }
+            if (_monitor)
+                _monitor->join();
+            if (mode == STOP_CANCEL)
+                _cancel = true;
+            _idle.notifyAll();
+            if (mode == STOP_DRAIN && timeout >= 0)
+            {
+                Guard guard(_exitMutex);
+                while (_alive > 0)
+                {
+                    long left = (long)(timeout - (clockMs() - begin));
+                    if (left <= 0 || (!_exitCond.timedWait(_exitMutex, left) && _alive > 0))
+                    {
+                        _cancel = true;
+                        _idle.notifyAll();
+                        break;
+                    }
+                }
+            }
+            for (size_t i = 0; i < _thread.size(); i++)
+            {
+                _thread[i].join();
+                _slot[i].state = SLOT_FREE;
+            }
+            bool drained = clear() == 0 && !_cancel;
+            _size = _initial;
+            _running = false;
+            return drained;
+        }
+        /*
+            当前的线程数,未启动时为start将要启动的线程数
+        */
+        size_t size() const
+        {
+            return _size.load(std::memory_order_relaxed);
+        }
+        size_t minSize() const
+        {
+            return _min;
+        }
+        size_t maxSize() const
+        {
+            return _max;
+        }
+        /*
+            排队中的任务数(近似值)
+        */
+        size_t pending() const
+        {
+            size_t n = 0;
+            for (size_t l = 0; l < LANES; l++)
+                n += pending((lane)l);
+            return n;
+        }
+        size_t pending(lane l) const
+        {
+            size_t n = _lanes[l].size();
+            for (size_t i = 0; l == LANE_NORMAL && i < _local.size(); i++)
+            {
+                Local *local = _local[i].load(std::memory_order_acquire);
+                if (local)
+                    n += local->deque.size();
+            }
+            return n;
+        }
+        /*
+            通道的排队深度和等待时间(入队到开始执行),汇总各线程的计数
+        */
+        LaneStats stats(lane l) const
+        {
+            LaneStats st = {pending(l), 0, 0, 0, 0, 0};
+            uint64_t hist[LANEBUCKETS] = {0};
+            for (size_t i = 0; i < _slot.size(); i++)
+            {
+                const LaneCounter &c = _slot[i].lanes[l];
+                st.count += c.count.load(std::memory_order_relaxed);
+                st.total += c.total.load(std::memory_order_relaxed);
+                st.max = std::max<uint64_t>(st.max, c.max.load(std::memory_order_relaxed));
+                for (size_t b = 0; b < LANEBUCKETS; b++)
+                    hist[b] += c.hist[b].load(std::memory_order_relaxed);
+            }
+            uint64_t seen = 0;
+            for (size_t b = 0; b < LANEBUCKETS; b++)
+            {
+                seen += hist[b];
+                if (st.p50 == 0 && seen * 2 >= st.count && st.count)
+                    st.p50 = 1ULL << b;
+                if (st.p99 == 0 && seen * 100 >= st.count * 99 && st.count)
+                    st.p99 = 1ULL << b;
+            }
+            return st;
+        }
+        /*
+            最近HISTORYMAX次线程数调整,按时间先后
+        */
+        std::vector<ResizeEvent> history()
+        {
+            Guard guard(_exitMutex);
+            return std::vector<ResizeEvent>(_history.begin(), _history.end());
+        }
+        bool running() const
+        {
+            return _running && !_stopping;
+        }
+
+    private:
+        void init(size_t n, const PoolOption &option)
+        {
+            _option = option;
+            _min = option.minThreads ? option.minThreads : n;
+            _max = std::max(option.maxThreads ? option.maxThreads : n, _min);
+            _min = std::max<size_t>(_min, 1); // 至少留一个线程,否则积压只能等监控线程发现
+            _max = std::max(_max, _min);
+            _initial = std::min(std::max(n, _min), _max);
+            _size = _initial;
+            std::vector<Slot> slots(_max);
+            _slot.swap(slots);
+            const Topology &topology = Topology::get();
+            // 按最大线程数预先建好,编号固定,扩容时启动空闲的槽位
+            for (size_t i = 0; i < _max; ++i)
+            {
+                ThreadOption to;
+                to.name = option.name + "-" + std::to_string(i);
+                to.stackSize = option.stackSize;
+                if (option.place == PLACE_CORE && !topology.cpus().empty())
+                    to.cpus.push_back(topology.cpus()[i % topology.cpus().size()]);
+                else if (option.place == PLACE_NODE)
+                    to.cpus = topology.nodes()[i % topology.nodes().size()];
+                _thread.push_back(Thread(std::bind(ThreadPool::run, this, i), to));
+            }
+            if (_mode == SCHEDULE_STEALING)
+                _local = std::vector<std::atomic<Local *>>(_max);
+            if (_min < _max)
+            {
+                ThreadOption to;
+                to.name = option.name + "-mon";
+                _monitor.reset(new Thread(std::bind(ThreadPool::monitor, this), to));
+            }
+        }
+        /*
+            每个线程的槽位,done只由所属线程写,按缓存行隔开
+        */
+        enum slot_state
+        {
+            SLOT_FREE,    // 未启动
+            SLOT_RUNNING, // 运行中
+            SLOT_EXITED,  // 空闲退出,等待join后复用
+        };
+        struct LaneCounter
+        {
+            std::atomic<uint64_t> count = {0};
+            std::atomic<uint64_t> total = {0};
+            std::atomic<uint64_t> max = {0};
+            std::atomic<uint64_t> hist[LANEBUCKETS] = {};
+        };
+        struct Slot
+        {
+            std::atomic<uint64_t> done = {0}; // 执行完的任务数
+            slot_state state = SLOT_FREE;     // _exitMutex保护
+            LaneCounter lanes[LANES];
+            char pad[CACHELINE];
+        };
+        /*
+            只由所属线程写
+        */
+        static void add(std::atomic<uint64_t> &counter, uint64_t v)
+        {
+            counter.store(counter.load(std::memory_order_relaxed) + v, std::memory_order_relaxed);
+        }
+        void account(size_t index, lane l, int64_t time)
+        {
+            uint64_t wait = (uint64_t)std::max<int64_t>(0, clockNs() - time);
+            LaneCounter &c = _slot[index].lanes[l];
+            add(c.count, 1);
+            add(c.total, wait);
+            if (wait > c.max.load(std::memory_order_relaxed))
+                c.max.store(wait, std::memory_order_relaxed);
+            size_t b = wait ? 64 - __builtin_clzll(wait) : 0;
+            add(c.hist[std::min<size_t>(b, LANEBUCKETS - 1)], 1);
+        }
+        void record(size_t from, size_t to, resize_reason reason)
+        {
+            ResizeEvent event = {clockMs(CLOCK_REALTIME), from, to, reason};
+            _history.push_back(event);
+            if (_history.size() > HISTORYMAX)
+                _history.pop_front();
+        }
+        /*
+            监控线程:每POOLTICK毫秒按积压和吞吐决定是否加一个线程
+            排队时间按 积压数 / 最近吞吐 估算,没有吞吐而有积压时视为无穷大
+        */
+        static void monitor(ThreadPool *this_)
+        {
+            uint64_t last = this_->completed();
+            Guard guard(this_->_exitMutex);
+            while (!this_->_stopping)
+            {
+                this_->_monitorCond.timedWait(this_->_exitMutex, POOLTICK);
+                if (this_->_stopping)
+                    break;
+                uint64_t done = this_->completed();
+                uint64_t delta = done - last;
+                last = done;
+                size_t depth = this_->pending();
+                if (depth == 0 || this_->_alive >= this_->_max)
+                    continue;
+                resize_reason reason;
+                if (depth >= this_->_option.growDepth)
+                    reason = RESIZE_DEPTH;
+                else if (delta == 0 || (int64_t)(depth * POOLTICK / delta) >= this_->_option.growWait)
+                    reason = RESIZE_WAIT;
+                else
+                    continue;
+                this_->grow(reason);
+            }
+        }
+        uint64_t completed() const
+        {
+            uint64_t n = 0;
+            for (size_t i = 0; i < _slot.size(); i++)
+                n += _slot[i].done.load(std::memory_order_relaxed);
+            return n;
+        }
+        /*
+            持有_exitMutex时调用
+        */
+        void grow(resize_reason reason)
+        {
+            for (size_t i = 0; i < _slot.size(); i++)
+            {
+                if (_slot[i].state == SLOT_RUNNING)
+                    continue;
+                _thread[i].join(); // 已退出的线程,立即返回
+                if (!_thread[i].start())
+                    return;
+                _slot[i].state = SLOT_RUNNING;
+                record(_alive, _alive + 1, reason);
+                _alive++;
+                _size = _alive;
+                return;
+            }
+        }
+        /*
+            空闲超时,线程数大于下限时当前线程退出
+        */
+        bool retire(size_t index)
+        {
+            Guard guard(_exitMutex);
+            if (_stopping || _alive <= _min)
+                return false;
+            record(_alive, _alive - 1, RESIZE_IDLE);
+            _alive--;
+            _size = _alive;
+            _slot[index].state = SLOT_EXITED;
+            return true;
+        }
+        /*
+            当前线程所属的线程池及编号
+        */
+        struct Worker
+        {
+            ThreadPool *pool;
+            size_t index;
+            size_t victim;          // 下一次窃取的起点,轮转避免总盯着同一个线程
+            unsigned credit[LANES]; // 本轮各通道剩余额度
+        };
+        static Worker &current()
+        {
+            static thread_local Worker worker = {NULL, 0, 0, {0}};
+            return worker;
+        }
+        /*
+            共享队列中的任务,带入队时间
+        */
+        struct Entry
+        {
+            Entry() : time(0)
+            {
+            }
+            Entry(func &&task) : task(std::move(task)), time(clockNs())
+            {
+            }
+            func task;
+            int64_t time;
+        };
+        /*
+            窃取队列中的节点,由所属线程分配,执行后归还给所属线程,稳定后不再分配
+        */
+        struct Local;
+        struct TaskNode
+        {
+            func task;
+            int64_t time; // 入队时间
+            TaskNode *next;
+            Local *home;
+        };
+        /*
+            每个工作线程的本地数据
+        */
+        struct Local
+        {
+            StealDeque<TaskNode *> deque;
+            TaskNode *free = NULL;                       // 仅所属线程访问
+            std::atomic<TaskNode *> returned = {NULL}; // 其他线程归还的节点
+            ~Local()
+            {
+                TaskNode *node;
+                while (deque.popBottom(node))
+                    delete node;
+                release(free);
+                release(returned.load());
+            }
+            static void release(TaskNode *node)
+            {
+                while (node)
+                {
+                    TaskNode *next = node->next;
+                    delete node;
+                    node = next;
+                }
+            }
+            TaskNode *alloc(func &&v)
+            {
+                if (free == NULL)
+                    free = returned.exchange(NULL, std::memory_order_acquire);
+                TaskNode *node = free;
+                if (node == NULL)
+                {
+                    node = new TaskNode;
+                    node->home = this;
+                }
+                else
+                    free = node->next;
+                node->task = std::move(v);
+                node->time = clockNs();
+                return node;
+            }
+        };
+        Local *local()
+        {
+            return current().pool == this ? _local[current().index].load(std::memory_order_relaxed) : NULL;
+        }
+        void freeNode(TaskNode *node, func &task, int64_t &time)
+        {
+            task = std::move(node->task);
+            time = node->time;
+            Local *home = node->home;
+            if (home == local())
+            {
+                node->next = home->free;
+                home->free = node;
+                return;
+            }
+            TaskNode *head = home->returned.load(std::memory_order_relaxed);
+            do
+            {
+                node->next = head;
+            } while (!home->returned.compare_exchange_weak(head, node, std::memory_order_release, std::memory_order_relaxed));
+        }
+        /*
+            parallel_for的共享状态,线程抢块执行,body只在未完成的块上被调用
+        */
+        struct ForState
+        {
+            size_t begin, end, grain, chunks;
+            std::function<void(size_t)> body;
+            std::atomic<size_t> next = {0};
+            std::atomic<size_t> done = {0};
+            std::atomic<bool> failed = {false};
+            std::exception_ptr error;
+            Waiter waiter;
+            void work()
+            {
+                size_t c;
+                while ((c = next.fetch_add(1, std::memory_order_relaxed)) < chunks)
+                {
+                    if (!failed.load(std::memory_order_relaxed))
+                    {
+                        size_t first = begin + c * grain;
+                        size_t last = std::min(end, first + grain);
+                        try
+                        {
+                            for (size_t i = first; i < last; i++)
+                                body(i);
+                        }
+                        catch (...)
+                        {
+                            if (!failed.exchange(true))
+                                error = std::current_exception();
+                        }
+                    }
+                    if (done.fetch_add(1, std::memory_order_acq_rel) + 1 == chunks)
+                        waiter.notifyAll();
+                }
+            }
+        };
+        /*
+            停止中只接受工作线程派生的任务(DRAIN需要执行完)
+        */
+        bool accept()
+        {
+            if (!_stopping.load(std::memory_order_relaxed))
+                return true;
+            return !_cancel.load(std::memory_order_relaxed) && current().pool == this;
+        }
+        /*
+            丢弃剩余任务,返回丢弃的个数
+        */
+        size_t clear()
+        {
+            size_t n = 0;
+            Entry entry;
+            for (size_t l = 0; l < LANES; l++)
+            {
+                while (_lanes[l].tryPopFront(entry))
+                {
+                    entry.task.reset();
+                    n++;
+                }
+            }
+            TaskNode *node;
+            for (size_t i = 0; i < _local.size(); i++)
+            {
+                Local *l = _local[i].load();
+                while (l && l->deque.popBottom(node))
+                {
+                    node->task.reset();
+                    node->next = l->free;
+                    l->free = node;
+                    n++;
+                }
+            }
+            return n;
+        }
+        /*
+            一次放入多个任务:本地队列或者共享队列的一次批量操作,最后只唤醒一次
+        */
+        void pushBatch(std::vector<func> &tasks)
+        {
+            if (!accept())
+                return;
+            size_t n = tasks.size();
+            size_t i = 0;
+            Local *l = _mode == SCHEDULE_STEALING ? local() : NULL;
+            if (l)
+            {
+                for (; i < n; i++)
+                    l->deque.pushBottom(l->alloc(std::move(tasks[i])));
+            }
+            while (i < n)
+            {
+                size_t k = _lanes[LANE_NORMAL].tryPushBatch(tasks.begin() + i, n - i);
+                i += k;
+                if (k == 0)
+                {
+                    // 队列满
+                    if (current().pool == this)
+                        tasks[i]();
+                    else
+                        _lanes[LANE_NORMAL].pushBack(Entry(std::move(tasks[i])));
+                    i++;
+                }
+            }
+            _idle.notify(n);
+        }
+        bool pushLocal(func &v)
+        {
+            if (_mode != SCHEDULE_STEALING || current().pool != this)
+                return false;
+            Local *l = local();
+            l->deque.pushBottom(l->alloc(std::move(v)));
+            return true;
+        }
+        /*
+            按优先级依次从还有额度的通道取,都取不到时补满额度再不看额度取一次
+        */
+        bool getTask(size_t index, func &task)
+        {
+            unsigned *credit = current().credit;
+            for (int pass = 0; pass < 2; pass++)
+            {
+                for (size_t l = 0; l < LANES; l++)
+                {
+                    if (pass == 0 && credit[l] == 0)
+                        continue;
+                    if (take(index, (lane)l, task))
+                    {
+                        if (credit[l])
+                            credit[l]--;
+                        return true;
+                    }
+                }
+                for (size_t l = 0; l < LANES; l++)
+                    credit[l] = std::max(_option.weights[l], 1u);
+            }
+            return false;
+        }
+        /*
+            LANE_NORMAL在SCHEDULE_STEALING下: 自己的队列 -> 共享队列 -> 从其他线程窃取
+        */
+        bool take(size_t index, lane l, func &task)
+        {
+            Entry entry;
+            if (l != LANE_NORMAL || _mode == SCHEDULE_SHARED)
+            {
+                if (!_lanes[l].tryPopFront(entry))
+                    return false;
+                task = std::move(entry.task);
+                account(index, l, entry.time);
+                return true;
+            }
+            TaskNode *node;
+            int64_t time;
+            if (local()->deque.popBottom(node))
+            {
+                freeNode(node, task, time);
+                account(index, l, time);
+                return true;
+            }
+            if (_lanes[l].tryPopFront(entry))
+            {
+                task = std::move(entry.task);
+                account(index, l, entry.time);
+                return true;
+            }
+            size_t n = _local.size();
+            size_t start = current().victim++;
+            for (size_t i = 0; i < n; i++)
+            {
+                size_t victim = (start + i) % n;
+                Local *v = victim == index ? NULL : _local[victim].load(std::memory_order_acquire);
+                if (v && v->deque.steal(node))
+                {
+                    freeNode(node, task, time);
+                    account(index, l, time);
+                    return true;
+                }
+            }
+            return false;
+        }
+        /*
+            取到任务返回true,该退出时返回false
+        */
+        bool nextTask(size_t index, func &task, bool &retired)
+        {
+            bool got = false;
+            auto pred = [&]()
+            {
+                if (_cancel.load(std::memory_order_relaxed))
+                    return true;
+                got = getTask(index, task);
+                return got || _stopping.load(std::memory_order_relaxed);
+            };
+            if (!_monitor)
+                _idle.wait(pred);
+            else
+            {
+                while (!_idle.waitFor(pred, _option.idleTimeout))
+                {
+                    if (retire(index))
+                    {
+                        retired = true;
+                        return false;
+                    }
+                }
+            }
+            return got && !_cancel.load(std::memory_order_relaxed);
+        }
+        static void run(ThreadPool *this_, size_t index)
+        {
+            current().pool = this_;
+            current().index = index;
+            if (this_->_mode == SCHEDULE_STEALING && this_->_local[index].load() == NULL)
+                this_->_local[index].store(new Local, std::memory_order_release); // 在本线程(本节点)上分配
+            func task;
+            bool retired = false;
+            std::atomic<uint64_t> &done = this_->_slot[index].done;
+            while (this_->nextTask(index, task, retired))
+            {
+                task();
+                task.reset(); // 尽早释放闭包持有的资源
+                done.store(done.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            }
+            task.reset();
+            current().pool = NULL;
+            if (!retired)
+            {
+                Guard guard(this_->_exitMutex);
+                this_->_alive--;
+                this_->_exitCond.signal();
+            }
+        }
+
+    private:
+        schedule_mode _mode;
+        PoolOption _option;
+        size_t _min;
+        size_t _max;
+        size_t _initial;
+        std::atomic<size_t> _size;
+        std::vector<Slot> _slot;
+        std::unique_ptr<Thread> _monitor;
+        Condition _monitorCond;
+        std::deque<ResizeEvent> _history; // _exitMutex保护
+        RingQueue<Entry> _lanes[LANES];
+        std::vector<std::atomic<Local *>> _local;
+        Waiter _idle;
         std::vector<Thread> _thread;
-        bool isStart;
-        size_t endNum;
+        std::atomic<bool> _running;
+        std::atomic<bool> _stopping;
+        std::atomic<bool> _cancel;
+        size_t _alive; // _exitMutex保护
+        Mutex _exitMutex;
+        Condition _exitCond;
     };
 }
\ No newline at end of file
@@ -0,0 +1,518 @@
+#pragma once
+#include "thread.hpp"
+
+namespace thread
+{
+#define WHEELROOT 8   // 第0层 2^8 个槽,每槽一个tick
+#define WHEELBITS 6   // 第1层起每层 2^6 个槽
+#define WHEELLEVELS 5 // 共 8+6*4=32 位,超出的先挂在最高层,降级时再按真实到期时间放置
+    /*
+        槽里的双向循环链表,槽头是哨兵
+    */
+    struct TimerLink
+    {
+        TimerLink *prev;
+        TimerLink *next;
+    };
+    enum timer_state
+    {
+        TIMER_PENDING,
+        TIMER_DONE, // 一次性定时器已派发
+        TIMER_CANCELLED,
+    };
+    class TimerWheel;
+    /*
+        定时器节点,侵入式引用计数:
+        时间轮持有一份直到节点离开时间轮,每个Timer句柄一份,派发出去还没执行的任务各一份
+    */
+    class TimerNode : public TimerLink
+    {
+    public:
+        template <class F>
+        TimerNode(F &&f, uint64_t period, TimerWheel *wheel)
+            : fn(std::forward<F>(f)), refs(2), state(TIMER_PENDING), running(false), linked(false),
+              expire(0), period(period), nextAdd(NULL), nextCancel(NULL), wheel(wheel)
+        {
+        }
+        void retain()
+        {
+            refs.fetch_add(1, std::memory_order_relaxed);
+        }
+        void release()
+        {
+            if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                delete this;
+        }
+        /*
+            派发后已取消的不再执行
+        */
+        void run()
+        {
+            if (state.load(std::memory_order_acquire) != TIMER_CANCELLED)
+                fn();
+            if (period == 0)
+                fn.reset(); // 一次性的尽早释放闭包,句柄可能还会被持有很久
+        }
+
+        Task fn;
+        std::atomic<int> refs;
+        std::atomic<int> state;
+        std::atomic<bool> running; // 周期定时器上一次还没执行完时跳过本次
+        bool linked;               // 以下只由时间轮线程访问
+        uint64_t expire;           // 到期的tick
+        uint64_t period;           // tick,0为一次性
+        TimerNode *nextAdd;        // 待加入栈
+        TimerNode *nextCancel;     // 待取消栈
+        TimerWheel *wheel;
+    };
+    /*
+        schedule_after/schedule_every的返回值,可拷贝,丢弃句柄不会取消定时器
+    */
+    class Timer
+    {
+    public:
+        Timer() : _node(NULL)
+        {
+        }
+        explicit Timer(TimerNode *node) : _node(node)
+        {
+        }
+        Timer(const Timer &other) : _node(other._node)
+        {
+            if (_node)
+                _node->retain();
+        }
+        Timer(Timer &&other) noexcept : _node(other._node)
+        {
+            other._node = NULL;
+        }
+        Timer &operator=(Timer other)
+        {
+            std::swap(_node, other._node);
+            return *this;
+        }
+        ~Timer()
+        {
+            if (_node)
+                _node->release();
+        }
+        /*
+            返回true表示之后不会再触发(已经在执行的那一次不受影响),O(1)
+            一次性定时器已派发或者已取消过时返回false
+            时间轮析构后调用是安全的,返回false
+        */
+        inline bool cancel();
+        bool pending() const
+        {
+            return _node && _node->state.load(std::memory_order_acquire) == TIMER_PENDING;
+        }
+        bool valid() const
+        {
+            return _node != NULL;
+        }
+
+    private:
+        TimerNode *_node;
+    };
+    /*
+        分层时间轮,schedule和cancel都是O(1)且不加锁:
+        其他线程把节点压入无锁栈,由时间轮线程在下一个tick放进槽里,槽只由时间轮线程访问
+        到期的回调派发到ThreadPool执行,pool为NULL时直接在时间轮线程中执行(只适合很短的回调)
+        精度为tick毫秒,回调不会早于到期时间执行
+    */
+    class TimerWheel
+    {
+    public:
+        TimerWheel(ThreadPool *pool = NULL, long tick = 1, const std::string &name = "timer")
+            : _pool(pool), _tick(tick > 0 ? tick : 1), _thread(std::bind(TimerWheel::run, this), option(name)),
+              _running(false), _stopping(false), _adds(NULL), _cancels(NULL), _count(0),
+              _start(clockMs()), _now(0), _linked(0)
+        {
+            for (size_t i = 0; i < (1 << WHEELROOT); i++)
+                _root[i].prev = _root[i].next = &_root[i];
+            for (size_t l = 0; l < WHEELLEVELS - 1; l++)
+            {
+                for (size_t i = 0; i < (1 << WHEELBITS); i++)
+                    _level[l][i].prev = _level[l][i].next = &_level[l][i];
+            }
+        }
+        /*
+            未触发的定时器被丢弃,之后对其句柄cancel返回false
+        */
+        ~TimerWheel()
+        {
+            stop();
+            drain();
+            for (size_t i = 0; i < (1 << WHEELROOT); i++)
+                discard(_root[i]);
+            for (size_t l = 0; l < WHEELLEVELS - 1; l++)
+            {
+                for (size_t i = 0; i < (1 << WHEELBITS); i++)
+                    discard(_level[l][i]);
+            }
+        }
+        TimerWheel(const TimerWheel &) = delete;
+        TimerWheel &operator=(const TimerWheel &) = delete;
+
+        void start()
+        {
+            if (_running)
+                return;
+            _stopping = false;
+            _running = _thread.start();
+        }
+        /*
+            停止期间到期的定时器在下次start后补发
+        */
+        void stop()
+        {
+            if (!_running)
+                return;
+            _stopping = true;
+            _waiter.notifyAll();
+            _thread.join();
+            _running = false;
+        }
+        /*
+            delay毫秒后执行一次f
+        */
+        template <class F>
+        Timer schedule_after(long delay, F &&f)
+        {
+            return add(new TimerNode(std::forward<F>(f), 0, this), delay);
+        }
+        /*
+            每period毫秒执行一次f,第一次在delay毫秒后(默认为period)
+            按固定频率,上一次还没执行完时跳过本次
+        */
+        template <class F>
+        Timer schedule_every(long period, F &&f)
+        {
+            return schedule_every(period, period, std::forward<F>(f));
+        }
+        template <class F>
+        Timer schedule_every(long delay, long period, F &&f)
+        {
+            uint64_t ticks = std::max<uint64_t>(1, (uint64_t)(std::max(period, 1L) + _tick - 1) / _tick);
+            return add(new TimerNode(std::forward<F>(f), ticks, this), delay);
+        }
+        /*
+            等待中的定时器数
+        */
+        size_t size() const
+        {
+            return _count.load(std::memory_order_relaxed);
+        }
+        long tick() const
+        {
+            return _tick;
+        }
+
+    private:
+        friend class Timer;
+        static ThreadOption option(const std::string &name)
+        {
+            ThreadOption option;
+            option.name = name;
+            return option;
+        }
+        /*
+            派发到线程池的任务,未执行就被丢弃时也要释放节点
+        */
+        struct Fire
+        {
+            explicit Fire(TimerNode *node) : node(node)
+            {
+                node->retain();
+            }
+            Fire(Fire &&other) noexcept : node(other.node)
+            {
+                other.node = NULL;
+            }
+            Fire(const Fire &) = delete;
+            ~Fire()
+            {
+                if (node)
+                {
+                    node->running.store(false, std::memory_order_release);
+                    node->release();
+                }
+            }
+            void operator()()
+            {
+                TimerNode *n = node;
+                node = NULL;
+                n->run();
+                n->running.store(false, std::memory_order_release);
+                n->release();
+            }
+            TimerNode *node;
+        };
+        uint64_t ticks(int64_t ms) const
+        {
+            return (uint64_t)((ms + _tick - 1) / _tick);
+        }
+        /*
+            到期时间按调用时的时钟计算,在栈里等待的时间不会推迟触发
+        */
+        Timer add(TimerNode *node, long delay)
+        {
+            node->expire = ticks(clockMs() - _start + std::max(delay, 0L));
+            _count.fetch_add(1, std::memory_order_relaxed);
+            TimerNode *head = _adds.load(std::memory_order_relaxed);
+            do
+            {
+                node->nextAdd = head;
+            } while (!_adds.compare_exchange_weak(head, node, std::memory_order_release, std::memory_order_relaxed));
+            if (head == NULL)
+                _waiter.notifyOne(); // 时间轮为空时线程在睡眠
+            return Timer(node);
+        }
+        /*
+            节点已由Timer::cancel标记为取消
+        */
+        void cancel(TimerNode *node)
+        {
+            _count.fetch_sub(1, std::memory_order_relaxed);
+            TimerNode *head = _cancels.load(std::memory_order_relaxed);
+            do
+            {
+                node->nextCancel = head;
+            } while (!_cancels.compare_exchange_weak(head, node, std::memory_order_release, std::memory_order_relaxed));
+            if (head == NULL)
+                _waiter.notifyOne();
+        }
+        static void run(TimerWheel *this_)
+        {
+            while (!this_->_stopping.load(std::memory_order_relaxed))
+            {
+                this_->advance((uint64_t)(clockMs() - this_->_start) / this_->_tick);
+                if (this_->_linked == 0)
+                {
+                    this_->_waiter.wait([this_]()
+                                        { return this_->_stopping.load(std::memory_order_relaxed) ||
+                                                 this_->_adds.load(std::memory_order_relaxed) != NULL ||
+                                                 this_->_cancels.load(std::memory_order_relaxed) != NULL; });
+                }
+                else
+                {
+                    this_->_waiter.waitFor([this_]()
+                                           { return this_->_stopping.load(std::memory_order_relaxed); },
+                                           this_->_tick);
+                }
+            }
+        }
+        /*
+            先取待取消栈再取待加入栈:取消一定发生在加入之后,
+            所以取到的每个待取消节点都已经在本次或之前加入过时间轮
+        */
+        void drain()
+        {
+            TimerNode *cancels = _cancels.exchange(NULL, std::memory_order_acquire);
+            TimerNode *adds = _adds.exchange(NULL, std::memory_order_acquire);
+            // 栈是后进先出,反转后按提交顺序放入
+            TimerNode *list = NULL;
+            while (adds)
+            {
+                TimerNode *next = adds->nextAdd;
+                adds->nextAdd = list;
+                list = adds;
+                adds = next;
+            }
+            while (list)
+            {
+                TimerNode *next = list->nextAdd;
+                // 已取消的由待取消栈释放
+                if (list->state.load(std::memory_order_acquire) == TIMER_PENDING)
+                    link(list);
+                list = next;
+            }
+            while (cancels)
+            {
+                TimerNode *next = cancels->nextCancel;
+                if (cancels->linked)
+                    unlink(cancels);
+                cancels->release();
+                cancels = next;
+            }
+        }
+        /*
+            执行到target(含)为止的所有tick
+        */
+        void advance(uint64_t target)
+        {
+            drain();
+            while (_now <= target)
+            {
+                if (_linked == 0)
+                {
+                    _now = target + 1;
+                    break;
+                }
+                uint64_t t = _now;
+                size_t index = t & ((1 << WHEELROOT) - 1);
+                if (index == 0)
+                {
+                    // 上层的槽降级到下层
+                    for (size_t l = 0; l < WHEELLEVELS - 1; l++)
+                    {
+                        size_t i = (t >> (WHEELROOT + l * WHEELBITS)) & ((1 << WHEELBITS) - 1);
+                        cascade(_level[l][i]);
+                        if (i != 0)
+                            break;
+                    }
+                }
+                TimerLink list;
+                splice(_root[index], list);
+                _now = t + 1;
+                while (list.next != &list)
+                {
+                    TimerNode *node = static_cast<TimerNode *>(list.next);
+                    remove(node);
+                    expire(node);
+                }
+            }
+        }
+        void expire(TimerNode *node)
+        {
+            if (node->period == 0)
+            {
+                int pending = TIMER_PENDING;
+                if (node->state.compare_exchange_strong(pending, TIMER_DONE, std::memory_order_acq_rel))
+                {
+                    _count.fetch_sub(1, std::memory_order_relaxed);
+                    dispatch(node);
+                    node->release();
+                }
+                return;
+            }
+            if (node->state.load(std::memory_order_acquire) != TIMER_PENDING)
+                return;
+            if (!node->running.exchange(true, std::memory_order_acq_rel))
+                dispatch(node);
+            node->expire += node->period;
+            link(node);
+        }
+        void dispatch(TimerNode *node)
+        {
+            if (_pool)
+                _pool->post(Fire(node)); // 线程池已停止时任务被丢弃
+            else
+            {
+                Fire fire(node);
+                fire();
+            }
+        }
+        /*
+            按距离到期的tick数选择层,到期时间已过的放到下一个要执行的槽
+        */
+        void link(TimerNode *node)
+        {
+            if (node->expire < _now)
+                node->expire = _now;
+            uint64_t delta = node->expire - _now;
+            TimerLink *head;
+            if (delta < (1 << WHEELROOT))
+                head = &_root[node->expire & ((1 << WHEELROOT) - 1)];
+            else
+            {
+                uint64_t expire = node->expire;
+                uint64_t max = (1ULL << (WHEELROOT + (WHEELLEVELS - 1) * WHEELBITS)) - 1;
+                if (delta > max)
+                    expire = _now + max;
+                size_t l = 0;
+                while (l < WHEELLEVELS - 2 && (expire - _now) >= (1ULL << (WHEELROOT + (l + 1) * WHEELBITS)))
+                    l++;
+                head = &_level[l][(expire >> (WHEELROOT + l * WHEELBITS)) & ((1 << WHEELBITS) - 1)];
+            }
+            node->prev = head->prev;
+            node->next = head;
+            head->prev->next = node;
+            head->prev = node;
+            node->linked = true;
+            _linked++;
+        }
+        void unlink(TimerNode *node)
+        {
+            node->prev->next = node->next;
+            node->next->prev = node->prev;
+            node->linked = false;
+            _linked--;
+        }
+        /*
+            从splice出来的临时链表中取下,计数已经在splice时扣除
+        */
+        void remove(TimerNode *node)
+        {
+            node->prev->next = node->next;
+            node->next->prev = node->prev;
+            node->linked = false;
+        }
+        /*
+            把slot整个移到to(空的哨兵)上
+        */
+        void splice(TimerLink &slot, TimerLink &to)
+        {
+            to.prev = to.next = &to;
+            if (slot.next == &slot)
+                return;
+            for (TimerLink *p = slot.next; p != &slot; p = p->next)
+                _linked--;
+            to.next = slot.next;
+            to.prev = slot.prev;
+            to.next->prev = &to;
+            to.prev->next = &to;
+            slot.prev = slot.next = &slot;
+        }
+        void cascade(TimerLink &slot)
+        {
+            TimerLink list;
+            splice(slot, list);
+            while (list.next != &list)
+            {
+                TimerNode *node = static_cast<TimerNode *>(list.next);
+                remove(node);
+                link(node);
+            }
+        }
+        void discard(TimerLink &slot)
+        {
+            TimerLink list;
+            splice(slot, list);
+            while (list.next != &list)
+            {
+                TimerNode *node = static_cast<TimerNode *>(list.next);
+                remove(node);
+                node->state.store(TIMER_CANCELLED, std::memory_order_release);
+                node->release();
+            }
+        }
+
+    private:
+        ThreadPool *_pool;
+        long _tick;
+        Thread _thread;
+        std::atomic<bool> _running;
+        std::atomic<bool> _stopping;
+        std::atomic<TimerNode *> _adds;
+        std::atomic<TimerNode *> _cancels;
+        std::atomic<size_t> _count;
+        Waiter _waiter;
+        int64_t _start;
+        uint64_t _now;  // 下一个要执行的tick,以下只由时间轮线程访问
+        size_t _linked; // 槽中的节点数
+        TimerLink _root[1 << WHEELROOT];
+        TimerLink _level[WHEELLEVELS - 1][1 << WHEELBITS];
+    };
+    /*
+        时间轮析构时把剩余节点都标记为取消,所以只有状态切换成功时才会访问时间轮
+    */
+    inline bool Timer::cancel()
+    {
+        int pending = TIMER_PENDING;
+        if (!_node || !_node->state.compare_exchange_strong(pending, TIMER_CANCELLED, std::memory_order_acq_rel))
+            return false;
+        _node->wheel->cancel(_node);
+        return true;
+    }
+}
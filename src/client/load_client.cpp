@@ -0,0 +1,370 @@
+#include "load_client.hpp"
+#include "protocol.hpp"
+#include "writer.hpp"
+#include "binary.hpp"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+namespace client
+{
+    static const long SETUP_TIMEOUT = 10000; // 毫秒
+    static const long DRAIN_TIMEOUT = 3000;  // 停止发送后等待在途消息的毫秒数
+
+    static uint64_t now()
+    {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    }
+    static const char *modeName(load_mode mode)
+    {
+        switch (mode)
+        {
+        case LOAD_CHAT:
+            return "chat";
+        case LOAD_GROUP:
+            return "group";
+        default:
+            return "echo";
+        }
+    }
+    /*
+     * 文本和二进制共用同一份写法
+     */
+    template <class W>
+    static void writeMessage(W &w, load_mode mode, long long target, uint64_t ts, const std::string &pad)
+    {
+        w.startObject();
+        w.key("type");
+        w.string(modeName(mode));
+        if (mode == LOAD_ECHO)
+        {
+            w.key("ts");
+            w.number((unsigned long long)ts);
+            w.key("pad");
+            w.string(pad);
+            w.endObject();
+            return;
+        }
+        w.key(mode == LOAD_CHAT ? "to" : "room");
+        w.number(target);
+        w.key("msg");
+        w.startObject();
+        w.key("ts");
+        w.number((unsigned long long)ts);
+        w.key("pad");
+        w.string(pad);
+        w.endObject();
+        w.endObject();
+    }
+
+    LoadClient::LoadClient(const LoadOption &option) : _option(option), _epfd(-1), _acks(0), _measureFrom(0), _measureTo(0)
+    {
+        _pad.assign(option.payload, 'x');
+    }
+    LoadClient::~LoadClient()
+    {
+        for (size_t i = 0; i < _conns.size(); i++)
+            close(_conns[i]->fd);
+        if (_epfd >= 0)
+            close(_epfd);
+    }
+    bool LoadClient::run(LoadResult &result)
+    {
+        if (_option.connections == 0 || _option.rate <= 0)
+        {
+            _error = "connections and rate must be positive";
+            return false;
+        }
+        if (!connectAll() || !setup())
+            return false;
+        uint64_t interval = (uint64_t)(1e9 / _option.rate);
+        if (interval == 0)
+            interval = 1;
+        uint64_t start = now();
+        _measureFrom = start + (uint64_t)(_option.warmup * 1e9);
+        _measureTo = _measureFrom + (uint64_t)(_option.duration * 1e9);
+        uint64_t next = start;
+        size_t turn = 0;
+        while (next < _measureTo)
+        {
+            uint64_t t = now();
+            for (; next <= t && next < _measureTo; next += interval)
+            {
+                Conn &c = *_conns[turn++ % _conns.size()];
+                if (next >= _measureFrom)
+                {
+                    result.sent++;
+                    result.expected += receivers(c);
+                }
+                send(c, next);
+            }
+            for (size_t i = 0; i < _dirty.size(); i++)
+                flush(*_dirty[i]);
+            _dirty.clear();
+            t = now();
+            int timeout = next > t ? (int)((next - t) / 1000000) : 0;
+            if (!poll(timeout, &result))
+                return false;
+        }
+        result.elapsed = (now() - _measureFrom) / 1e9;
+        uint64_t deadline = now() + DRAIN_TIMEOUT * 1000000ULL;
+        while (result.received < result.expected && now() < deadline)
+        {
+            if (!poll(10, &result))
+                return false;
+        }
+        return true;
+    }
+    bool LoadClient::connectAll()
+    {
+        addrinfo hints, *addr;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        std::string port = std::to_string(_option.port);
+        int rc = getaddrinfo(_option.host.c_str(), port.c_str(), &hints, &addr);
+        if (rc != 0)
+        {
+            _error = std::string("getaddrinfo: ") + gai_strerror(rc);
+            return false;
+        }
+        _epfd = epoll_create1(EPOLL_CLOEXEC);
+        for (size_t i = 0; i < _option.connections; i++)
+        {
+            int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (fd < 0 || connect(fd, addr->ai_addr, addr->ai_addrlen) < 0)
+            {
+                _error = std::string("connect: ") + strerror(errno);
+                if (fd >= 0)
+                    close(fd);
+                freeaddrinfo(addr);
+                return false;
+            }
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+            std::unique_ptr<Conn> c(new Conn);
+            c->fd = fd;
+            c->user = _option.firstUser + (long long)i;
+            c->room = (long long)(i / _option.roomSize) + 1;
+            epoll_event ev;
+            ev.events = EPOLLIN | EPOLLOUT | EPOLLET;
+            ev.data.ptr = c.get();
+            epoll_ctl(_epfd, EPOLL_CTL_ADD, fd, &ev);
+            _conns.push_back(std::move(c));
+        }
+        freeaddrinfo(addr);
+        return true;
+    }
+    /*
+     * hello、login、join一次发出,等全部ack成功
+     */
+    bool LoadClient::setup()
+    {
+        size_t expect = 0;
+        for (size_t i = 0; i < _conns.size(); i++)
+        {
+            Conn &c = *_conns[i];
+            std::string frame;
+            if (_option.binary)
+            {
+                frame += chat::encodeFrame("{\"type\":\"hello\",\"encoding\":\"binary\"}");
+                expect++;
+            }
+            frame += chat::encodeFrame("{\"type\":\"login\",\"id\":" + std::to_string(c.user) + "}");
+            expect++;
+            if (_option.mode == LOAD_GROUP)
+            {
+                frame += chat::encodeFrame("{\"type\":\"join\",\"room\":" + std::to_string(c.room) + "}");
+                expect++;
+            }
+            c.output.append(frame.data(), frame.size());
+            flush(c);
+        }
+        uint64_t deadline = now() + SETUP_TIMEOUT * 1000000ULL;
+        while (_acks < expect && _error.empty())
+        {
+            if (now() > deadline)
+            {
+                _error = "timed out waiting for login";
+                return false;
+            }
+            if (!poll(10, NULL))
+                return false;
+        }
+        return _error.empty();
+    }
+    size_t LoadClient::receivers(const Conn &c) const
+    {
+        if (_option.mode != LOAD_GROUP)
+            return 1;
+        size_t first = (size_t)(c.room - 1) * _option.roomSize;
+        return std::min(_option.roomSize, _conns.size() - first);
+    }
+    void LoadClient::send(Conn &c, uint64_t ts)
+    {
+        long long target = c.room;
+        if (_option.mode == LOAD_CHAT)
+            target = _option.firstUser + (long long)((c.user - _option.firstUser + 1) % _conns.size());
+        if (c.output.empty())
+            _dirty.push_back(&c);
+        _frame.clear();
+        size_t start = chat::beginFrame(_frame);
+        if (_option.binary)
+        {
+            json::Encoder e(_frame);
+            writeMessage(e, _option.mode, target, ts, _pad);
+        }
+        else
+        {
+            json::Writer w(_frame);
+            writeMessage(w, _option.mode, target, ts, _pad);
+        }
+        chat::endFrame(_frame, start);
+        c.output.append(_frame.data(), _frame.size());
+    }
+    void LoadClient::flush(Conn &c)
+    {
+        while (!c.output.empty())
+        {
+            ssize_t n = c.output.writeFd(c.fd);
+            if (n > 0 || (n < 0 && errno == EINTR))
+                continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                return; // 等EPOLLOUT
+            _error = std::string("write: ") + strerror(errno);
+            return;
+        }
+    }
+    bool LoadClient::poll(int timeoutMs, LoadResult *result)
+    {
+        epoll_event events[256];
+        int n = epoll_wait(_epfd, events, 256, timeoutMs);
+        if (n < 0 && errno != EINTR)
+        {
+            _error = std::string("epoll_wait: ") + strerror(errno);
+            return false;
+        }
+        for (int i = 0; i < n; i++)
+        {
+            Conn &c = *(Conn *)events[i].data.ptr;
+            if (events[i].events & EPOLLOUT)
+                flush(c);
+            if (!(events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)))
+                continue;
+            while (1)
+            {
+                ssize_t r = c.input.readFd(c.fd);
+                if (r > 0 || (r < 0 && errno == EINTR))
+                    continue;
+                if (r == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+                    _error = "server closed connection of user " + std::to_string(c.user);
+                break;
+            }
+            std::string payload;
+            size_t consumed;
+            chat::frame_status st;
+            while ((st = chat::decodeFrame(c.input.data(), c.input.size(), payload, consumed)) == chat::FRAME_OK)
+            {
+                onFrame(payload, result);
+                c.input.consume(consumed);
+            }
+            if (st == chat::FRAME_ERROR)
+                _error = "bad frame from server";
+            c.input.release();
+        }
+        return _error.empty();
+    }
+    void LoadClient::onFrame(const std::string &payload, LoadResult *result)
+    {
+        uint64_t t = now();
+        try
+        {
+            const json::Node &root = chat::payloadEncoding(payload) == chat::ENCODING_BINARY ? _doc.decode(payload) : _doc.parse(payload);
+            const json::Node &type = root["type"];
+            if (type.equals("ack"))
+            {
+                _acks++;
+                if (root["code"].toInt() == 0)
+                    return;
+                if (result == NULL)
+                    _error = "setup rejected: " + payload;
+                else
+                    result->errors++;
+                return;
+            }
+            const json::Node &ts = type.equals("echo") ? root["ts"] : root["msg"]["ts"];
+            if (result == NULL || !ts.isInt())
+                return;
+            uint64_t sent = (uint64_t)ts.toInt();
+            if (sent < _measureFrom || sent >= _measureTo)
+                return;
+            result->received++;
+            result->latency.record(t > sent ? t - sent : 0);
+        }
+        catch (const json::Exception &)
+        {
+            if (result)
+                result->errors++;
+        }
+    }
+    std::string LoadClient::report(const LoadOption &option, const LoadResult &result)
+    {
+        std::string out;
+        json::Writer w(out);
+        w.startObject();
+        w.key("mode");
+        w.string(modeName(option.mode));
+        w.key("encoding");
+        w.string(option.binary ? "binary" : "json");
+        w.key("connections");
+        w.number((unsigned long long)option.connections);
+        w.key("room_size");
+        w.number((unsigned long long)(option.mode == LOAD_GROUP ? option.roomSize : 0));
+        w.key("payload");
+        w.number((unsigned long long)option.payload);
+        w.key("rate");
+        w.number(option.rate);
+        w.key("duration");
+        w.number(result.elapsed);
+        w.key("sent");
+        w.number((unsigned long long)result.sent);
+        w.key("expected");
+        w.number((unsigned long long)result.expected);
+        w.key("received");
+        w.number((unsigned long long)result.received);
+        w.key("errors");
+        w.number((unsigned long long)result.errors);
+        w.key("throughput");
+        w.number(result.elapsed > 0 ? result.received / result.elapsed : 0.0);
+        w.key("latency_us");
+        w.startObject();
+        const Histogram &h = result.latency;
+        const char *names[] = {"p50", "p90", "p99", "p999"};
+        const double points[] = {50, 90, 99, 99.9};
+        w.key("min");
+        w.number(h.min() / 1000.0);
+        w.key("mean");
+        w.number(h.mean() / 1000.0);
+        for (int i = 0; i < 4; i++)
+        {
+            w.key(names[i]);
+            w.number(h.percentile(points[i]) / 1000.0);
+        }
+        w.key("max");
+        w.number(h.max() / 1000.0);
+        w.endObject();
+        w.endObject();
+        return out;
+    }
+}
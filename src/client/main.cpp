@@ -0,0 +1,122 @@
+#include "load_client.hpp"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <getopt.h>
+#include <sys/resource.h>
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -H host        server address (127.0.0.1)\n"
+            "  -p port        server port (8000)\n"
+            "  -c conns       connections opened by this process (100)\n"
+            "  -r rate        messages per second over all connections (1000)\n"
+            "  -d seconds     measured duration (10)\n"
+            "  -w seconds     warmup before measuring (1)\n"
+            "  -m mode        echo | chat | group (echo)\n"
+            "  -g size        connections per room in group mode (10)\n"
+            "  -s bytes       padding per message (64)\n"
+            "  -b             negotiate binary encoding\n"
+            "  -u id          first user id, distinct per concurrent client (1000000)\n"
+            "  -o file        append the JSON result line to file instead of stdout\n",
+            name);
+}
+
+int main(int argc, char *argv[])
+{
+    client::LoadOption option;
+    const char *output = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "H:p:c:r:d:w:m:g:s:bu:o:h")) != -1)
+    {
+        switch (opt)
+        {
+        case 'H':
+            option.host = optarg;
+            break;
+        case 'p':
+            option.port = (uint16_t)atoi(optarg);
+            break;
+        case 'c':
+            option.connections = (size_t)atol(optarg);
+            break;
+        case 'r':
+            option.rate = atof(optarg);
+            break;
+        case 'd':
+            option.duration = atof(optarg);
+            break;
+        case 'w':
+            option.warmup = atof(optarg);
+            break;
+        case 'm':
+            if (strcmp(optarg, "echo") == 0)
+                option.mode = client::LOAD_ECHO;
+            else if (strcmp(optarg, "chat") == 0)
+                option.mode = client::LOAD_CHAT;
+            else if (strcmp(optarg, "group") == 0)
+                option.mode = client::LOAD_GROUP;
+            else
+            {
+                usage(argv[0]);
+                return 2;
+            }
+            break;
+        case 'g':
+            option.roomSize = (size_t)atol(optarg);
+            break;
+        case 's':
+            option.payload = (size_t)atol(optarg);
+            break;
+        case 'b':
+            option.binary = true;
+            break;
+        case 'u':
+            option.firstUser = atoll(optarg);
+            break;
+        case 'o':
+            output = optarg;
+            break;
+        default:
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (option.roomSize == 0)
+        option.roomSize = 1;
+
+    // 一个进程开上万条连接需要放开fd上限
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max)
+    {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    client::LoadResult result;
+    client::LoadClient load(option);
+    if (!load.run(result))
+    {
+        fprintf(stderr, "chat_client: %s\n", load.error().c_str());
+        return 1;
+    }
+    std::string line = client::LoadClient::report(option, result);
+    fprintf(stderr, "sent %llu received %llu/%llu errors %llu, p50 %.1fus p99 %.1fus max %.1fus\n",
+            (unsigned long long)result.sent, (unsigned long long)result.received, (unsigned long long)result.expected,
+            (unsigned long long)result.errors, result.latency.percentile(50) / 1000.0,
+            result.latency.percentile(99) / 1000.0, result.latency.max() / 1000.0);
+    FILE *f = output ? fopen(output, "a") : stdout;
+    if (f == NULL)
+    {
+        perror(output);
+        return 1;
+    }
+    fprintf(f, "%s\n", line.c_str());
+    if (f != stdout)
+        fclose(f);
+    return 0;
+}
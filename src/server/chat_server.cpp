@@ -0,0 +1,239 @@
+#include "chat_server.hpp"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <iterator>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+namespace server
+{
+    ChatServer::ChatServer(uint16_t port, size_t ioThreads, size_t workers, thread::placement place,
+                           const StoreOption &store)
+        : _next(0), _nextId(0), _pool(1, poolOption(place, workers)), _service(store)
+    {
+        _listenfd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (_listenfd < 0)
+        {
+            perror("socket");
+            exit(1);
+        }
+        int on = 1;
+        setsockopt(_listenfd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        addr.sin_port = htons(port);
+        if (bind(_listenfd, (sockaddr *)&addr, sizeof(addr)) < 0 || listen(_listenfd, SOMAXCONN) < 0)
+        {
+            perror("bind/listen");
+            exit(1);
+        }
+        // fd耗尽时用来接受并立即关闭连接,避免边沿触发下listenfd一直就绪
+        _idlefd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+        if (ioThreads == 0)
+            ioThreads = 1;
+        for (size_t i = 0; i < ioThreads; i++)
+            _loops.push_back(std::unique_ptr<IoLoop>(new IoLoop));
+        _threads.reserve(ioThreads);
+        for (size_t i = 0; i < ioThreads; i++)
+        {
+            EventLoop *loop = &_loops[i]->loop;
+            thread::ThreadOption option;
+            option.name = "io-" + std::to_string(i);
+            _threads.push_back(thread::Thread([loop]()
+                                              { loop->loop(); },
+                                              option));
+        }
+    }
+    thread::PoolOption ChatServer::poolOption(thread::placement place, size_t workers)
+    {
+        // 工作线程从1个开始,按积压增长到workers个,空闲后回收
+        thread::PoolOption option;
+        option.place = place;
+        option.name = "worker";
+        option.minThreads = 1;
+        option.maxThreads = workers;
+        return option;
+    }
+    ChatServer::~ChatServer()
+    {
+        close(_listenfd);
+        close(_idlefd);
+    }
+    void ChatServer::start()
+    {
+        _pool.start();
+        for (size_t i = 0; i < _threads.size(); i++)
+            _threads[i].start();
+        _baseLoop.add(_listenfd, EPOLLIN | EPOLLET, this);
+        _baseLoop.loop();
+
+        _baseLoop.remove(_listenfd);
+        for (size_t i = 0; i < _loops.size(); i++)
+            _loops[i]->loop.quit();
+        for (size_t i = 0; i < _threads.size(); i++)
+            _threads[i].join();
+        // 最多等1秒执行完已收到的消息,超时的丢弃
+        _pool.stop(thread::STOP_DRAIN, 1000);
+        for (size_t i = 0; i < _loops.size(); i++)
+            _loops[i]->connections.clear();
+    }
+    void ChatServer::stop()
+    {
+        _baseLoop.quit();
+    }
+    void ChatServer::handleEvent(uint32_t events)
+    {
+        while (1)
+        {
+            int fd = accept4(_listenfd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd >= 0)
+            {
+                newConnection(fd);
+                continue;
+            }
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            if (errno == EMFILE || errno == ENFILE)
+            {
+                close(_idlefd);
+                fd = accept(_listenfd, NULL, NULL);
+                if (fd >= 0)
+                    close(fd);
+                _idlefd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+                continue;
+            }
+            break; // EAGAIN
+        }
+    }
+    void ChatServer::newConnection(int fd)
+    {
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        IoLoop *io = _loops[_next].get();
+        _next = (_next + 1) % _loops.size();
+        Connection::ptr conn(new Connection(&io->loop, fd, _nextId++));
+        std::shared_ptr<Strand> strand = std::make_shared<Strand>();
+        conn->setMessageCallback([this, strand](const Connection::ptr &c, std::vector<std::string> &&frames)
+                                 { onMessage(strand, c, std::move(frames)); });
+        conn->setCloseCallback([this, io, strand](const Connection::ptr &c)
+                               {
+                                   onClose(strand, c);
+                                   io->connections.erase(c->fd());
+                               });
+        io->loop.runInLoop([io, conn]()
+                           {
+                               io->connections[conn->fd()] = conn;
+                               conn->establish();
+                           });
+    }
+    thread::lane ChatServer::laneOf(const Connection::ptr &conn, const std::string &frame)
+    {
+        if (conn->userId() < 0)
+            return thread::LANE_HIGH;
+        return _service.isBulk(frame) ? thread::LANE_BULK : thread::LANE_NORMAL;
+    }
+    void ChatServer::onMessage(const std::shared_ptr<Strand> &strand, const Connection::ptr &conn, std::vector<std::string> &&frames)
+    {
+        // 不在运行时队列是空的,这批的第一帧就是队头
+        thread::lane lane = laneOf(conn, frames.front());
+        {
+            thread::Guard guard(strand->mutex);
+            if (strand->frames.empty())
+                strand->frames.swap(frames);
+            else
+                std::move(frames.begin(), frames.end(), std::back_inserter(strand->frames));
+            if (strand->running)
+                return;
+            strand->running = true;
+            strand->lane = lane;
+        }
+        schedule(strand, conn);
+    }
+    void ChatServer::onClose(const std::shared_ptr<Strand> &strand, const Connection::ptr &conn)
+    {
+        {
+            thread::Guard guard(strand->mutex);
+            strand->closing = true;
+            if (strand->running)
+                return;
+            strand->running = true;
+        }
+        schedule(strand, conn);
+    }
+    /*
+     * 调用前已置running,不持有strand->mutex(队列满时任务可能在当前线程直接执行)
+     * 同一连接同时只有一个任务,通道只决定这条连接接下来排队的优先级,不会打乱顺序:
+     * 还没登录的连接走高优先级通道,登录不会排在大量群发后面;群发走BULK,
+     * 已登录连接的join、leave、私聊不和别人的群发挤同一个队列;关闭也排在同一队列里
+     */
+    void ChatServer::schedule(const std::shared_ptr<Strand> &strand, const Connection::ptr &conn)
+    {
+        std::shared_ptr<Strand> s = strand;
+        Connection::ptr c = conn;
+        if (!_pool.push_back([this, s, c]()
+                             { drain(s, c); },
+                             strand->lane))
+        {
+            thread::Guard guard(strand->mutex);
+            strand->running = false; // 线程池已停止
+        }
+    }
+    /*
+     * 一次最多处理DRAIN_ROUNDS批,还有剩余就重新排队,避免一条连接长期占住工作线程
+     * 遇到该走别的通道的帧,把它和之后的帧放回队头,换通道重新排队
+     */
+    void ChatServer::drain(const std::shared_ptr<Strand> &strand, const Connection::ptr &conn)
+    {
+        const int DRAIN_ROUNDS = 16;
+        for (int round = 0; round < DRAIN_ROUNDS; round++)
+        {
+            std::vector<std::string> batch;
+            bool close = false;
+            {
+                thread::Guard guard(strand->mutex);
+                if (!strand->frames.empty())
+                    batch.swap(strand->frames);
+                else if (strand->closing)
+                    close = true;
+                else
+                {
+                    strand->running = false;
+                    return;
+                }
+            }
+            if (close)
+            {
+                _service.onClose(conn);
+                thread::Guard guard(strand->mutex);
+                strand->closing = false;
+                strand->running = false;
+                return;
+            }
+            for (size_t i = 0; i < batch.size(); i++)
+            {
+                thread::lane lane = laneOf(conn, batch[i]);
+                if (lane != strand->lane)
+                {
+                    {
+                        thread::Guard guard(strand->mutex);
+                        batch.erase(batch.begin(), batch.begin() + i);
+                        std::move(strand->frames.begin(), strand->frames.end(), std::back_inserter(batch));
+                        strand->frames.swap(batch);
+                        strand->lane = lane;
+                    }
+                    schedule(strand, conn);
+                    return;
+                }
+                _service.onMessage(conn, batch[i]);
+            }
+        }
+        schedule(strand, conn);
+    }
+}
@@ -0,0 +1,293 @@
+#include "chat_service.hpp"
+#include "protocol.hpp"
+#include <stdio.h>
+
+namespace server
+{
+    namespace
+    {
+        /*
+         * 每个工作线程一个Binder,arena复用
+         */
+        json::Binder &binder()
+        {
+            static thread_local json::Binder b;
+            return b;
+        }
+        /*
+         * 按负载的编码直接绑定,二进制不转文本;Raw成员保留原编码
+         */
+        template <class T>
+        void bindPayload(const std::string &payload, T &msg)
+        {
+            if (chat::payloadEncoding(payload) == chat::ENCODING_BINARY)
+                binder().bindAllBinary(payload, msg);
+            else
+                binder().bindAll(payload, msg);
+        }
+        /*
+         * 绑定过的消息直接序列化进帧里,帧头先占位
+         */
+        template <class T>
+        std::string frame(const T &msg, int encoding)
+        {
+            std::string out;
+            size_t start = chat::beginFrame(out);
+            if (encoding == chat::ENCODING_BINARY)
+                json::encode(msg, out);
+            else
+                json::format(msg, out);
+            chat::endFrame(out, start);
+            return out;
+        }
+        const uint64_t COMPACT_EVERY = 10000;
+    }
+
+    ChatService::ChatService(const StoreOption &store)
+        : _store(store), _delivered(0)
+    {
+        std::string error;
+        if (!_store.open(error))
+            fprintf(stderr, "offline store disabled: %s\n", error.c_str());
+        _handlers["hello"] = &ChatService::hello;
+        _handlers["login"] = &ChatService::login;
+        _handlers["chat"] = &ChatService::chat;
+        _handlers["join"] = &ChatService::join;
+        _handlers["leave"] = &ChatService::leave;
+        _handlers["group"] = &ChatService::group;
+        _handlers["echo"] = &ChatService::echo;
+    }
+    void ChatService::onMessage(const Connection::ptr &conn, const std::string &payload)
+    {
+        std::string type;
+        try
+        {
+            // type通常是第一个键,取到就停,不扫描正文;二进制和文本一样直接读,不转码
+            json::Field field = {"type"};
+            if (chat::payloadEncoding(payload) == chat::ENCODING_BINARY)
+                binder().pickBinary(payload, &field, 1);
+            else
+                binder().pick(payload, &field, 1);
+            type = field.value.toText();
+            auto it = _handlers.find(type);
+            if (it == _handlers.end())
+            {
+                ack(conn, type, 1, "unknown type");
+                return;
+            }
+            if (type != "hello" && type != "login" && type != "echo" && conn->userId() < 0)
+            {
+                ack(conn, type, 2, "not logged in");
+                return;
+            }
+            (this->*(it->second))(conn, payload);
+        }
+        catch (const json::Exception &e)
+        {
+            ack(conn, type, 3, e.what());
+        }
+    }
+    bool ChatService::isBulk(const std::string &payload)
+    {
+        try
+        {
+            json::Field field = {"type"};
+            if (chat::payloadEncoding(payload) == chat::ENCODING_BINARY)
+                binder().pickBinary(payload, &field, 1);
+            else
+                binder().pick(payload, &field, 1);
+            return field.value.toText() == "group";
+        }
+        catch (const json::Exception &)
+        {
+            return false;
+        }
+    }
+    void ChatService::onClose(const Connection::ptr &conn)
+    {
+        long long user = conn->userId();
+        if (user < 0)
+            return;
+        // 同一用户可能已在新连接上重新登录
+        _users.eraseIf(user, [&conn](const Presence &p)
+                       { return p.conn.lock() == conn; });
+        _rooms.leaveAll(user, conn);
+    }
+    void ChatService::hello(const Connection::ptr &conn, const std::string &payload)
+    {
+        chat::Hello msg;
+        bindPayload(payload, msg);
+        if (msg.encoding == "binary")
+            conn->setEncoding(chat::ENCODING_BINARY);
+        else if (msg.encoding == "json")
+            conn->setEncoding(chat::ENCODING_JSON);
+        else
+        {
+            ack(conn, "hello", 6, "unknown encoding");
+            return;
+        }
+        // 回复已经用新的编码
+        ack(conn, "hello", 0);
+    }
+    void ChatService::login(const Connection::ptr &conn, const std::string &payload)
+    {
+        chat::Login msg;
+        bindPayload(payload, msg);
+        long long user = msg.id;
+        conn->setUserId(user);
+        ack(conn, "login", 0);
+        // 先登记为补发中,这期间发给他的私聊照样进存储,实时推送不会排到更早的离线消息前面
+        if (!_users.set(user, Presence{conn, true}))
+            _rooms.rebind(user, conn); // 重新登录,已加入的房间跟到新连接
+        // 读盘和发送都在锁外;切到在线时存储里没有更新的消息才切,否则再补一轮
+        size_t count = 0;
+        uint64_t last = 0;
+        bool delivering = true;
+        while (delivering)
+        {
+            last = deliverOffline(conn, last, count);
+            bool mine = _users.update(user, [&](Presence &p)
+                                      {
+                                          if (p.conn.lock() != conn)
+                                              delivering = false; // 已在新连接上重新登录
+                                          else if (_store.latest(user) <= last)
+                                              p.delivering = delivering = false; });
+            if (!mine)
+                break; // 连接已断
+        }
+        if (last == 0)
+            return;
+        // 补发的帧写进socket后才算投递;之前连接断了就不ack,下次登录重发
+        conn->whenFlushed([this, user, last, count]()
+                          {
+                              _store.ack(user, last);
+                              uint64_t before = _delivered.fetch_add(count);
+                              if (before / COMPACT_EVERY != (before + count) / COMPACT_EVERY)
+                                  _store.compactLater(); });
+    }
+    void ChatService::chat(const Connection::ptr &conn, const std::string &payload)
+    {
+        chat::Private msg;
+        bindPayload(payload, msg);
+        chat::PrivatePush push = {"chat", conn->userId(), msg.msg};
+        Connection::ptr peer;
+        uint64_t seq = 0;
+        // 对方不在线或还在补发时,在查找的同一把读锁内存进缓冲(存文本,补发时再按对方的编码转换),
+        // 只拷内存不等写盘;login切到在线要拿写锁,存下的消息一定在它补发的范围内
+        auto store = [&]()
+        {
+            if (!_store.isOpen())
+                return;
+            std::string text;
+            json::format(push, text);
+            seq = _store.append(msg.to, text);
+        };
+        _users.visit(msg.to, [&](const Presence &p)
+                     {
+                         if (!p.delivering)
+                             peer = p.conn.lock();
+                         if (!peer)
+                             store(); }, // 补发中,或连接已断还没从表里删掉
+                     store);
+        if (peer)
+        {
+            peer->send(frame(push, peer->encoding()));
+            return;
+        }
+        if (!_store.isOpen())
+        {
+            ack(conn, "chat", 4, "offline");
+            return;
+        }
+        // 放开锁后再等成组落盘,然后回复
+        if (seq == 0 || !_store.commit())
+        {
+            ack(conn, "chat", 7, "store failed");
+            return;
+        }
+        ack(conn, "chat", 0, "stored");
+    }
+    void ChatService::join(const Connection::ptr &conn, const std::string &payload)
+    {
+        chat::Room msg;
+        bindPayload(payload, msg);
+        _rooms.join(msg.room, conn->userId(), conn);
+        ack(conn, "join", 0);
+    }
+    void ChatService::leave(const Connection::ptr &conn, const std::string &payload)
+    {
+        chat::Room msg;
+        bindPayload(payload, msg);
+        _rooms.leave(msg.room, conn->userId());
+        ack(conn, "leave", 0);
+    }
+    void ChatService::group(const Connection::ptr &conn, const std::string &payload)
+    {
+        chat::Group msg;
+        bindPayload(payload, msg);
+        chat::GroupPush push = {"group", msg.room, conn->userId(), msg.msg};
+        // 每种编码只序列化一次,各I/O线程共享同一帧
+        long sent = _rooms.broadcast(msg.room, conn->userId(), [&push](int encoding)
+                                     { return std::make_shared<std::string>(frame(push, encoding)); });
+        if (sent < 0)
+            ack(conn, "group", 5, "not in room");
+    }
+    void ChatService::echo(const Connection::ptr &conn, const std::string &payload)
+    {
+        bool binary = chat::payloadEncoding(payload) == chat::ENCODING_BINARY;
+        // 只校验不建DOM,编码相同时原样发回
+        if (binary == (conn->encoding() == chat::ENCODING_BINARY))
+        {
+            json::Handler check;
+            if (binary)
+                binder().decode(payload, check);
+            else
+                binder().parse(payload, check);
+            conn->send(chat::encodeFrame(payload));
+            return;
+        }
+        std::string out;
+        size_t start = chat::beginFrame(out);
+        if (binary)
+        {
+            json::Writer w(out);
+            json::formatBinary(payload.data(), payload.size(), w);
+        }
+        else
+        {
+            json::Encoder e(out);
+            json::encodeText(payload.data(), payload.size(), e);
+        }
+        chat::endFrame(out, start);
+        conn->send(std::move(out));
+    }
+    void ChatService::ack(const Connection::ptr &conn, const std::string &type, int code, const std::string &what)
+    {
+        chat::Ack msg = {"ack", type, code, what};
+        conn->send(frame(msg, conn->encoding()));
+    }
+    /*
+     * 按序补发序号大于after的离线消息,返回最后一条的序号,没有新消息时返回after
+     */
+    uint64_t ChatService::deliverOffline(const Connection::ptr &conn, uint64_t after, size_t &count)
+    {
+        if (!_store.isOpen())
+            return after;
+        uint64_t last = _store.replay(conn->userId(), [&](const char *data, size_t len)
+                                      {
+                                          std::string out;
+                                          size_t start = chat::beginFrame(out);
+                                          if (conn->encoding() == chat::ENCODING_BINARY)
+                                          {
+                                              json::Encoder e(out);
+                                              json::encodeText(data, len, e);
+                                          }
+                                          else
+                                              out.append(data, len);
+                                          chat::endFrame(out, start);
+                                          conn->send(std::move(out));
+                                          count++; },
+                                      after);
+        return last ? last : after;
+    }
+}
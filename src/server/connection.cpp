@@ -0,0 +1,235 @@
+#include "connection.hpp"
+#include "protocol.hpp"
+#include <stdio.h>
+#include <errno.h>
+#include <unistd.h>
+
+namespace server
+{
+    Connection::Connection(EventLoop *loop, int fd, uint64_t id)
+        : _loop(loop), _fd(fd), _id(id), _userId(-1), _encoding(0), _closed(false), _lost(false), _flushQueued(false)
+    {
+    }
+    Connection::~Connection()
+    {
+        close(_fd);
+    }
+    void Connection::establish()
+    {
+        _loop->add(_fd, EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET, this);
+    }
+    void Connection::send(const std::string &frame)
+    {
+        if (_closed)
+        {
+            _lost = true;
+            return;
+        }
+        if (_loop->isInLoopThread())
+            sendInLoop(frame.data(), frame.size());
+        else
+        {
+            ptr self(shared_from_this());
+            _loop->queueInLoop([self, frame]()
+                               { self->sendInLoop(frame.data(), frame.size()); });
+        }
+    }
+    void Connection::send(std::string &&frame)
+    {
+        if (_closed)
+        {
+            _lost = true;
+            return;
+        }
+        if (_loop->isInLoopThread())
+            sendInLoop(std::move(frame));
+        else
+        {
+            ptr self(shared_from_this());
+            std::shared_ptr<const std::string> data(new std::string(std::move(frame)));
+            _loop->queueInLoop([self, data]()
+                               { self->sendInLoop(data); });
+        }
+    }
+    void Connection::send(const std::shared_ptr<const std::string> &frame)
+    {
+        if (_closed)
+        {
+            _lost = true;
+            return;
+        }
+        if (_loop->isInLoopThread())
+            sendInLoop(frame);
+        else
+        {
+            ptr self(shared_from_this());
+            _loop->queueInLoop([self, frame]()
+                               { self->sendInLoop(frame); });
+        }
+    }
+    void Connection::whenFlushed(const FlushedCallback &cb)
+    {
+        if (_loop->isInLoopThread())
+            whenFlushedInLoop(cb);
+        else
+        {
+            ptr self(shared_from_this());
+            _loop->queueInLoop([self, cb]()
+                               { self->whenFlushedInLoop(cb); });
+        }
+    }
+    void Connection::forceClose()
+    {
+        ptr self(shared_from_this());
+        _loop->runInLoop([self]()
+                         { self->handleClose(); });
+    }
+    void Connection::handleEvent(uint32_t events)
+    {
+        ptr self(shared_from_this()); // 回调中可能移除自身
+        if (events & (EPOLLERR | EPOLLHUP))
+        {
+            handleClose();
+            return;
+        }
+        if (events & EPOLLIN)
+            handleRead();
+        if ((events & EPOLLOUT) && !_closed)
+            handleWrite();
+        if ((events & EPOLLRDHUP) && !_closed)
+            handleClose();
+    }
+    void Connection::flush()
+    {
+        _flushQueued = false;
+        if (!_closed)
+            handleWrite();
+    }
+    void Connection::handleRead()
+    {
+        bool eof = false;
+        // 边沿触发,必须读到EAGAIN
+        while (1)
+        {
+            ssize_t n = _input.readFd(_fd);
+            if (n > 0)
+                continue;
+            if (n == 0)
+                eof = true;
+            else if (errno == EINTR)
+                continue;
+            else if (errno != EAGAIN && errno != EWOULDBLOCK)
+                eof = true;
+            break;
+        }
+        std::vector<std::string> frames;
+        while (1)
+        {
+            std::string payload;
+            size_t consumed = 0;
+            chat::frame_status st = chat::decodeFrame(_input.data(), _input.size(), payload, consumed);
+            if (st == chat::FRAME_PARTIAL)
+                break;
+            if (st == chat::FRAME_ERROR)
+            {
+                eof = true;
+                break;
+            }
+            _input.consume(consumed);
+            frames.push_back(std::move(payload));
+        }
+        _input.release(); // 读空时还回池里
+        if (!frames.empty() && _messageCallback)
+            _messageCallback(shared_from_this(), std::move(frames));
+        if (eof)
+            handleClose();
+    }
+    void Connection::handleWrite()
+    {
+        while (!_output.empty())
+        {
+            ssize_t n = _output.writeFd(_fd);
+            if (n > 0)
+                continue;
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                return; // 等EPOLLOUT
+            handleClose();
+            return;
+        }
+        if (!_flushed.empty())
+        {
+            std::vector<FlushedCallback> done;
+            done.swap(_flushed);
+            for (size_t i = 0; i < done.size(); i++)
+                done[i]();
+        }
+    }
+    void Connection::sendInLoop(const char *data, size_t len)
+    {
+        if (_closed)
+        {
+            _lost = true;
+            return;
+        }
+        _output.append(data, len);
+        scheduleFlush();
+    }
+    void Connection::sendInLoop(std::string &&frame)
+    {
+        if (_closed)
+        {
+            _lost = true;
+            return;
+        }
+        _output.append(std::move(frame));
+        scheduleFlush();
+    }
+    void Connection::sendInLoop(const std::shared_ptr<const std::string> &frame)
+    {
+        if (_closed)
+        {
+            _lost = true;
+            return;
+        }
+        _output.append(frame);
+        scheduleFlush();
+    }
+    void Connection::whenFlushedInLoop(const FlushedCallback &cb)
+    {
+        // 关闭前已经全部写出、之后也没有被丢的帧,照样算写完
+        if (_closed)
+        {
+            if (!_lost)
+                cb();
+            return;
+        }
+        if (_output.empty())
+            cb();
+        else
+            _flushed.push_back(cb);
+    }
+    void Connection::scheduleFlush()
+    {
+        if (_flushQueued)
+            return;
+        _flushQueued = true;
+        _loop->flushLater(shared_from_this());
+    }
+    void Connection::handleClose()
+    {
+        if (_closed.exchange(true))
+            return;
+        _loop->remove(_fd);
+        if (!_output.empty())
+            _lost = true;
+        _output.clear();
+        _flushed.clear();
+        ptr self(shared_from_this());
+        if (_closeCallback)
+            _closeCallback(self);
+        // 延迟到pending阶段析构,避免在handleEvent中delete this
+        _loop->queueInLoop([self]() {});
+    }
+}
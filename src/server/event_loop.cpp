@@ -0,0 +1,144 @@
+#include "event_loop.hpp"
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+namespace server
+{
+    EventLoop::EventLoop() : _quit(false), _looping(false), _tid(0), _events(1024)
+    {
+        _epfd = epoll_create1(EPOLL_CLOEXEC);
+        _wakeupfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (_epfd < 0 || _wakeupfd < 0)
+        {
+            perror("EventLoop");
+            abort();
+        }
+        add(_wakeupfd, EPOLLIN | EPOLLET, NULL);
+    }
+    EventLoop::~EventLoop()
+    {
+        close(_wakeupfd);
+        close(_epfd);
+    }
+    void EventLoop::loop()
+    {
+        _tid = pthread_self();
+        _looping = true;
+        while (!_quit)
+        {
+            int n = epoll_wait(_epfd, _events.data(), (int)_events.size(), -1);
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                perror("epoll_wait");
+                break;
+            }
+            for (int i = 0; i < n; i++)
+            {
+                EventHandler *handler = (EventHandler *)_events[i].data.ptr;
+                if (handler == NULL)
+                    handleWakeup();
+                else
+                    handler->handleEvent(_events[i].events);
+            }
+            if ((size_t)n == _events.size())
+                _events.resize(_events.size() * 2);
+            doPending();
+            doFlush();
+        }
+        doPending();
+        doFlush();
+        _looping = false;
+    }
+    void EventLoop::quit()
+    {
+        _quit = true;
+        wakeup();
+    }
+    bool EventLoop::isInLoopThread() const
+    {
+        return _looping && pthread_equal(_tid, pthread_self());
+    }
+    void EventLoop::runInLoop(func f)
+    {
+        if (isInLoopThread())
+            f();
+        else
+            queueInLoop(std::move(f));
+    }
+    void EventLoop::queueInLoop(func f)
+    {
+        bool empty;
+        {
+            thread::Guard guard(_mutex);
+            empty = _pending.empty();
+            _pending.push_back(std::move(f));
+        }
+        // 队列非空说明已唤醒过,loop会在本轮一起处理
+        if (empty)
+            wakeup();
+    }
+    void EventLoop::flushLater(const std::shared_ptr<EventHandler> &handler)
+    {
+        _flush.push_back(handler);
+    }
+    void EventLoop::add(int fd, uint32_t events, EventHandler *handler)
+    {
+        epoll_event ev;
+        ev.events = events;
+        ev.data.ptr = handler;
+        if (epoll_ctl(_epfd, EPOLL_CTL_ADD, fd, &ev) < 0)
+            perror("epoll_ctl add");
+    }
+    void EventLoop::modify(int fd, uint32_t events, EventHandler *handler)
+    {
+        epoll_event ev;
+        ev.events = events;
+        ev.data.ptr = handler;
+        if (epoll_ctl(_epfd, EPOLL_CTL_MOD, fd, &ev) < 0)
+            perror("epoll_ctl mod");
+    }
+    void EventLoop::remove(int fd)
+    {
+        epoll_ctl(_epfd, EPOLL_CTL_DEL, fd, NULL);
+    }
+    void EventLoop::wakeup()
+    {
+        uint64_t one = 1;
+        ssize_t n = write(_wakeupfd, &one, sizeof(one));
+        (void)n;
+    }
+    void EventLoop::handleWakeup()
+    {
+        uint64_t v;
+        while (read(_wakeupfd, &v, sizeof(v)) > 0)
+        {
+        }
+    }
+    void EventLoop::doPending()
+    {
+        std::vector<func> pending;
+        {
+            thread::Guard guard(_mutex);
+            pending.swap(_pending);
+        }
+        for (size_t i = 0; i < pending.size(); i++)
+            pending[i]();
+    }
+    void EventLoop::doFlush()
+    {
+        // flush中关闭连接等可能再登记,直到清空
+        std::vector<std::shared_ptr<EventHandler>> handlers;
+        while (!_flush.empty())
+        {
+            handlers.swap(_flush);
+            for (size_t i = 0; i < handlers.size(); i++)
+                handlers[i]->flush();
+            handlers.clear();
+        }
+    }
+}
@@ -0,0 +1,50 @@
+#include "chat_server.hpp"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <sys/resource.h>
+
+static server::ChatServer *g_server = NULL;
+
+static void onSignal(int)
+{
+    if (g_server)
+        g_server->stop();
+}
+
+int main(int argc, char *argv[])
+{
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    uint16_t port = argc > 1 ? (uint16_t)atoi(argv[1]) : 8000;
+    size_t ioThreads = argc > 2 ? (size_t)atoi(argv[2]) : (size_t)cpus;
+    size_t workers = argc > 3 ? (size_t)atoi(argv[3]) : (size_t)cpus;
+    // 工作线程绑核策略: none | core | node
+    thread::placement place = thread::PLACE_NONE;
+    if (argc > 4 && strcmp(argv[4], "core") == 0)
+        place = thread::PLACE_CORE;
+    else if (argc > 4 && strcmp(argv[4], "node") == 0)
+        place = thread::PLACE_NODE;
+    // 离线消息目录
+    server::StoreOption store;
+    if (argc > 5)
+        store.dir = argv[5];
+
+    // 1万以上连接需要放开fd上限
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max)
+    {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    server::ChatServer chatServer(port, ioThreads, workers, place, store);
+    g_server = &chatServer;
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+    printf("chat_server listening on %u (io=%zu workers=1..%zu store=%s)\n", port, ioThreads, workers, store.dir.c_str());
+    chatServer.start();
+    g_server = NULL;
+    return 0;
+}
@@ -0,0 +1,680 @@
+#include "offline_store.hpp"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <algorithm>
+
+namespace server
+{
+    namespace
+    {
+        enum record_kind
+        {
+            RECORD_MESSAGE = 1,
+            RECORD_ACK = 2, // seq是已投递的最大序号,没有负载
+        };
+        /*
+         * crc覆盖头中crc之后的部分和负载
+         */
+        struct RecordHeader
+        {
+            uint32_t crc;
+            uint32_t kindSize; // 高8位类型,低24位负载长度
+            int64_t user;
+            uint64_t seq;
+        };
+        const size_t HEADER = sizeof(RecordHeader);
+        const size_t MAX_PAYLOAD = (1 << 24) - 1;
+        const size_t COMPACT_CHUNK = 1 << 20; // 压缩每搬这么多字节放开一次锁
+
+        uint32_t crc32(uint32_t crc, const char *data, size_t len)
+        {
+            static uint32_t table[256];
+            static bool ready = false;
+            if (!ready)
+            {
+                for (uint32_t i = 0; i < 256; i++)
+                {
+                    uint32_t c = i;
+                    for (int k = 0; k < 8; k++)
+                        c = c & 1 ? 0xedb88320 ^ (c >> 1) : c >> 1;
+                    table[i] = c;
+                }
+                ready = true;
+            }
+            crc = ~crc;
+            const unsigned char *p = (const unsigned char *)data;
+            for (size_t i = 0; i < len; i++)
+                crc = table[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+            return ~crc;
+        }
+        /*
+         * 段号和段内偏移合成单调递增的位置
+         */
+        inline uint64_t position(uint32_t segment, uint64_t offset)
+        {
+            return ((uint64_t)segment << 32) | offset;
+        }
+        bool writeAll(int fd, const char *data, size_t len)
+        {
+            while (len > 0)
+            {
+                ssize_t n = ::write(fd, data, len);
+                if (n < 0 && errno == EINTR)
+                    continue;
+                if (n <= 0)
+                    return false;
+                data += n;
+                len -= n;
+            }
+            return true;
+        }
+        std::string failure(const char *what, const std::string &file)
+        {
+            return std::string(what) + " " + file + ": " + strerror(errno);
+        }
+        /*
+         * 新建的段文件要等目录项落盘后才算持久
+         */
+        int openSegment(const std::string &file, const std::string &dir, bool sync, std::string &error)
+        {
+            int fd = ::open(file.c_str(), O_WRONLY | O_APPEND | O_CLOEXEC);
+            if (fd >= 0)
+                return fd;
+            if (errno != ENOENT)
+            {
+                error = failure("open", file);
+                return -1;
+            }
+            fd = ::open(file.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_APPEND | O_CLOEXEC, 0644);
+            if (fd < 0)
+            {
+                error = failure("create", file);
+                return -1;
+            }
+            if (!sync)
+                return fd;
+            int dfd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            if (dfd < 0 || fsync(dfd) < 0)
+            {
+                error = failure("fsync", dir);
+                if (dfd >= 0)
+                    ::close(dfd);
+                ::close(fd);
+                return -1;
+            }
+            ::close(dfd);
+            return fd;
+        }
+        const char *mapFile(const std::string &path, size_t len)
+        {
+            int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0)
+                return NULL;
+            void *p = mmap(NULL, len, PROT_READ, MAP_SHARED, fd, 0);
+            ::close(fd);
+            if (p == MAP_FAILED)
+                return NULL;
+            madvise(p, len, MADV_SEQUENTIAL);
+            return (const char *)p;
+        }
+    }
+
+    OfflineStore::Mapping::~Mapping()
+    {
+        if (data)
+            munmap((void *)data, len);
+    }
+    OfflineStore::OfflineStore(const StoreOption &option)
+        : _option(option), _open(false), _active(0), _activeSize(0), _nextSeq(1), _appendPos(0), _writtenPos(0),
+          _urgent(false), _compactRequested(false), _stop(false), _failed(false), _commits(0)
+    {
+        crc32(0, NULL, 0); // 先建好表,之后多线程只读
+    }
+    OfflineStore::~OfflineStore()
+    {
+        close();
+    }
+    std::string OfflineStore::path(uint32_t segment) const
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "/%08x.log", segment);
+        return _option.dir + name;
+    }
+    bool OfflineStore::open(std::string &error)
+    {
+        if (_open)
+            return true;
+        if (mkdir(_option.dir.c_str(), 0755) < 0 && errno != EEXIST)
+        {
+            error = _option.dir + ": " + strerror(errno);
+            return false;
+        }
+        DIR *dir = opendir(_option.dir.c_str());
+        if (dir == NULL)
+        {
+            error = _option.dir + ": " + strerror(errno);
+            return false;
+        }
+        std::vector<uint32_t> ids;
+        while (dirent *e = readdir(dir))
+        {
+            unsigned id;
+            char tail;
+            if (strlen(e->d_name) == 12 && sscanf(e->d_name, "%8x.lo%c", &id, &tail) == 2 && tail == 'g')
+                ids.push_back(id);
+        }
+        closedir(dir);
+        std::sort(ids.begin(), ids.end());
+        for (size_t i = 0; i < ids.size(); i++)
+        {
+            if (!recover(ids[i], i + 1 == ids.size(), error))
+                return false;
+        }
+        // 同一seq可能因压缩中途退出留下两份,保留新段里的那份
+        for (auto it = _users.begin(); it != _users.end();)
+        {
+            std::vector<Location> &m = it->second.messages;
+            std::stable_sort(m.begin(), m.end(), [](const Location &a, const Location &b)
+                             { return a.seq < b.seq || (a.seq == b.seq && a.segment > b.segment); });
+            std::vector<Location> kept;
+            for (size_t i = 0; i < m.size(); i++)
+            {
+                if (m[i].seq <= it->second.acked || (!kept.empty() && kept.back().seq == m[i].seq))
+                    continue;
+                kept.push_back(m[i]);
+                Segment &s = _segments[m[i].segment];
+                s.live++;
+                s.liveBytes += HEADER + m[i].size;
+            }
+            m.swap(kept);
+            if (m.empty() && it->second.acked == 0)
+                it = _users.erase(it);
+            else
+                ++it;
+        }
+        // 总是从新的一段开始写
+        _active = ids.empty() ? 1 : ids.back() + 1;
+        _activeSize = 0;
+        _segments[_active];
+        _appendPos = _writtenPos = position(_active, 0);
+        _stop = false;
+        _writer.reset(new thread::Thread([this]()
+                                         { run(); }));
+        _writer->start();
+        _compactor.reset(new thread::Thread([this]()
+                                            { runCompact(); }));
+        _compactor->start();
+        _open = true;
+        return true;
+    }
+    /*
+     * 顺序扫描一段;最后一段遇到不完整或校验失败的记录时截断,之前的段跳过剩余部分
+     */
+    bool OfflineStore::recover(uint32_t segment, bool last, std::string &error)
+    {
+        std::string file = path(segment);
+        struct stat st;
+        if (stat(file.c_str(), &st) < 0)
+        {
+            error = file + ": " + strerror(errno);
+            return false;
+        }
+        size_t size = (size_t)st.st_size;
+        Segment &seg = _segments[segment];
+        if (size == 0)
+            return true;
+        Mapping m(mapFile(file, size), size);
+        if (m.data == NULL)
+        {
+            error = file + ": " + strerror(errno);
+            return false;
+        }
+        size_t offset = 0;
+        while (offset + HEADER <= size)
+        {
+            RecordHeader h;
+            memcpy(&h, m.data + offset, HEADER);
+            size_t len = h.kindSize & MAX_PAYLOAD;
+            int kind = (int)(h.kindSize >> 24);
+            if (offset + HEADER + len > size || (kind != RECORD_MESSAGE && kind != RECORD_ACK) ||
+                crc32(0, m.data + offset + 4, HEADER - 4 + len) != h.crc)
+                break;
+            UserState &state = _users[h.user];
+            if (kind == RECORD_MESSAGE)
+            {
+                Location loc = {h.seq, segment, (uint32_t)offset, (uint32_t)len};
+                state.messages.push_back(loc);
+            }
+            else if (h.seq >= state.acked)
+            {
+                state.acked = h.seq;
+                state.ackSegment = segment;
+            }
+            _nextSeq = std::max(_nextSeq, h.seq + 1);
+            offset += HEADER + len;
+        }
+        if (offset < size)
+        {
+            fprintf(stderr, "OfflineStore: %s: dropped %zu bytes of damaged tail\n", file.c_str(), size - offset);
+            if (last && truncate(file.c_str(), offset) < 0)
+            {
+                error = file + ": " + strerror(errno);
+                return false;
+            }
+        }
+        seg.bytes = offset;
+        return true;
+    }
+    void OfflineStore::close()
+    {
+        if (!_open)
+            return;
+        {
+            thread::Guard guard(_mutex);
+            _stop = true;
+            _wake.signal();
+            _compactWake.signal();
+        }
+        // 压缩线程可能在等写盘,先停它
+        _compactor->join();
+        _compactor.reset();
+        _writer->join();
+        _writer.reset();
+        // 内存索引清空,再open时从磁盘重建,不在旧的计数上累加
+        _users.clear();
+        _segments.clear();
+        _buffer.clear();
+        _active = 0;
+        _activeSize = 0;
+        _nextSeq = 1;
+        _appendPos = _writtenPos = 0;
+        _urgent = _compactRequested = _failed = false;
+        _error.clear();
+        _open = false;
+    }
+    /*
+     * 调用时持有_mutex:编码一条记录追加到缓冲,当前段满了先换新段
+     */
+    OfflineStore::Location OfflineStore::write(int kind, long long user, uint64_t seq, const char *data, size_t len)
+    {
+        if (_activeSize > 0 && _activeSize + HEADER + len > _option.segmentSize)
+        {
+            _active++;
+            _activeSize = 0;
+            _segments[_active];
+        }
+        RecordHeader h;
+        h.kindSize = (uint32_t)kind << 24 | (uint32_t)len;
+        h.user = user;
+        h.seq = seq;
+        h.crc = crc32(crc32(0, (const char *)&h + 4, HEADER - 4), data, len);
+        if (_buffer.empty() || _buffer.back().segment != _active)
+            _buffer.push_back(Pending{_active, std::string()});
+        std::string &out = _buffer.back().data;
+        out.append((const char *)&h, HEADER);
+        out.append(data, len);
+        Location loc = {seq, _active, (uint32_t)_activeSize, (uint32_t)len};
+        Segment &s = _segments[_active];
+        s.bytes += HEADER + len;
+        _activeSize += HEADER + len;
+        _appendPos = position(_active, _activeSize);
+        return loc;
+    }
+    uint64_t OfflineStore::append(long long user, const char *data, size_t len, bool durable)
+    {
+        uint64_t seq, pos;
+        {
+            thread::Guard guard(_mutex);
+            if (_failed)
+                return 0;
+            // 截断会存下残缺的消息,直接拒绝;只记原因,不进失败状态
+            if (len > MAX_PAYLOAD)
+            {
+                _error = "payload of " + std::to_string(len) + " bytes exceeds " + std::to_string(MAX_PAYLOAD);
+                return 0;
+            }
+            seq = _nextSeq++;
+            Location loc = write(RECORD_MESSAGE, user, seq, data, len);
+            _users[user].messages.push_back(loc);
+            Segment &s = _segments[loc.segment];
+            s.live++;
+            s.liveBytes += HEADER + len;
+            pos = _appendPos;
+        }
+        if (durable && !waitWritten(pos))
+            return 0;
+        return seq;
+    }
+    /*
+     * 持有_mutex时调用
+     */
+    void OfflineStore::drop(UserState &state, uint64_t upto)
+    {
+        size_t n = 0;
+        while (n < state.messages.size() && state.messages[n].seq <= upto)
+        {
+            const Location &loc = state.messages[n];
+            auto it = _segments.find(loc.segment);
+            if (it != _segments.end())
+            {
+                it->second.live--;
+                it->second.liveBytes -= HEADER + loc.size;
+            }
+            n++;
+        }
+        state.messages.erase(state.messages.begin(), state.messages.begin() + n);
+    }
+    void OfflineStore::ack(long long user, uint64_t upto)
+    {
+        thread::Guard guard(_mutex);
+        auto it = _users.find(user);
+        if (it == _users.end() || upto <= it->second.acked)
+            return;
+        UserState &state = it->second;
+        drop(state, upto);
+        state.acked = upto;
+        state.ackSegment = write(RECORD_ACK, user, upto, NULL, 0).segment;
+    }
+    size_t OfflineStore::pending(long long user)
+    {
+        thread::Guard guard(_mutex);
+        auto it = _users.find(user);
+        return it == _users.end() ? 0 : it->second.messages.size();
+    }
+    uint64_t OfflineStore::latest(long long user)
+    {
+        thread::Guard guard(_mutex);
+        auto it = _users.find(user);
+        return it == _users.end() || it->second.messages.empty() ? 0 : it->second.messages.back().seq;
+    }
+    bool OfflineStore::waitWritten(uint64_t pos)
+    {
+        thread::Guard guard(_mutex);
+        if (_writtenPos >= pos)
+            return true;
+        _urgent = true;
+        _wake.signal();
+        while (_writtenPos < pos && !_stop && !_failed)
+            _written.wait(_mutex);
+        return _writtenPos >= pos;
+    }
+    bool OfflineStore::commit()
+    {
+        uint64_t pos;
+        {
+            thread::Guard guard(_mutex);
+            pos = _appendPos;
+        }
+        return waitWritten(pos);
+    }
+    std::string OfflineStore::lastError()
+    {
+        thread::Guard guard(_mutex);
+        return _error;
+    }
+    /*
+     * 持有_mutex时调用:映射段的[0, need),已有的映射不够长时按当前文件大小重新映射(当前段还在增长)
+     */
+    std::shared_ptr<OfflineStore::Mapping> OfflineStore::map(uint32_t segment, uint64_t need)
+    {
+        Segment &s = _segments[segment];
+        if (s.map && s.map->len >= need)
+            return s.map;
+        std::string file = path(segment);
+        struct stat st;
+        if (stat(file.c_str(), &st) < 0 || (uint64_t)st.st_size < need)
+            return std::shared_ptr<Mapping>();
+        const char *data = mapFile(file, (size_t)st.st_size);
+        if (data == NULL)
+            return std::shared_ptr<Mapping>();
+        s.map = std::make_shared<Mapping>(data, (size_t)st.st_size);
+        return s.map;
+    }
+    uint64_t OfflineStore::replay(long long user, const Visitor &f, uint64_t after)
+    {
+        std::vector<Location> messages;
+        std::vector<std::shared_ptr<Mapping>> maps;
+        while (1)
+        {
+            uint64_t need = 0;
+            {
+                thread::Guard guard(_mutex);
+                auto it = _users.find(user);
+                if (it == _users.end() || it->second.messages.empty())
+                    return 0;
+                const std::vector<Location> &all = it->second.messages;
+                messages.assign(std::upper_bound(all.begin(), all.end(), after, [](uint64_t seq, const Location &loc)
+                                                 { return seq < loc.seq; }),
+                                all.end());
+                if (messages.empty())
+                    return 0;
+                for (size_t i = 0; i < messages.size(); i++)
+                    need = std::max(need, position(messages[i].segment, messages[i].offset + HEADER + messages[i].size));
+                // 在锁内拿到映射,之后压缩删掉段文件也不影响读
+                if (need <= _writtenPos || _stop || _failed)
+                {
+                    maps.resize(messages.size());
+                    for (size_t i = 0; i < messages.size(); i++)
+                    {
+                        const Location &loc = messages[i];
+                        if (i > 0 && loc.segment == messages[i - 1].segment && maps[i - 1] &&
+                            maps[i - 1]->len >= (uint64_t)loc.offset + HEADER + loc.size)
+                            maps[i] = maps[i - 1];
+                        else
+                            maps[i] = map(loc.segment, (uint64_t)loc.offset + HEADER + loc.size);
+                    }
+                    break;
+                }
+            }
+            waitWritten(need);
+        }
+        for (size_t i = 0; i < messages.size(); i++)
+        {
+            if (!maps[i])
+            {
+                fprintf(stderr, "OfflineStore: cannot map %s\n", path(messages[i].segment).c_str());
+                continue;
+            }
+            f(maps[i]->data + messages[i].offset + HEADER, messages[i].size);
+        }
+        return messages.back().seq;
+    }
+    size_t OfflineStore::compact()
+    {
+        std::vector<uint32_t> victims;
+        {
+            thread::Guard guard(_mutex);
+            for (auto it = _segments.begin(); it != _segments.end(); ++it)
+            {
+                Segment &s = it->second;
+                if (it->first != _active && (s.live == 0 || s.liveBytes < _option.compactRatio * s.bytes))
+                    victims.push_back(it->first);
+            }
+        }
+        if (victims.empty())
+            return 0;
+        // 封存段的数据都已写盘才能映射;期间刚封存、还没写完的段映射会失败,这次跳过
+        if (!commit())
+            return 0;
+        // 按用户分批搬,每批最多COMPACT_CHUNK字节,批间放开锁让追加和ack插进来
+        // 之后新出现的用户只会写当前段,不用管
+        std::vector<long long> users;
+        {
+            thread::Guard guard(_mutex);
+            users.reserve(_users.size());
+            for (auto it = _users.begin(); it != _users.end(); ++it)
+                users.push_back(it->first);
+        }
+        size_t next = 0;
+        while (next < users.size())
+        {
+            thread::Guard guard(_mutex);
+            size_t copied = 0;
+            while (next < users.size() && copied < COMPACT_CHUNK)
+            {
+                auto it = _users.find(users[next++]);
+                if (it != _users.end())
+                    copied += move(it->first, it->second, victims);
+            }
+        }
+        // 搬过去的数据先落盘,再删旧段;写盘失败时旧段一个都不能删
+        if (!commit())
+            return 0;
+        thread::Guard guard(_mutex);
+        size_t removed = 0;
+        for (size_t i = 0; i < victims.size(); i++)
+        {
+            Segment &s = _segments[victims[i]];
+            if (s.live != 0)
+                continue; // 映射失败没搬走
+            unlink(path(victims[i]).c_str());
+            _segments.erase(victims[i]);
+            removed++;
+        }
+        return removed;
+    }
+    /*
+     * 持有_mutex时调用:user在victims中存活的消息原样(保留seq)搬到当前段,返回搬运的字节数
+     */
+    size_t OfflineStore::move(long long user, UserState &state, const std::vector<uint32_t> &victims)
+    {
+        size_t copied = 0;
+        for (size_t i = 0; i < state.messages.size(); i++)
+        {
+            Location &loc = state.messages[i];
+            if (!std::binary_search(victims.begin(), victims.end(), loc.segment))
+                continue;
+            std::shared_ptr<Mapping> m = map(loc.segment, (uint64_t)loc.offset + HEADER + loc.size);
+            if (!m)
+                continue;
+            Segment &old = _segments[loc.segment];
+            Location moved = write(RECORD_MESSAGE, user, loc.seq, m->data + loc.offset + HEADER, loc.size);
+            old.live--;
+            old.liveBytes -= HEADER + loc.size;
+            Segment &now = _segments[moved.segment];
+            now.live++;
+            now.liveBytes += HEADER + moved.size;
+            loc = moved;
+            copied += HEADER + loc.size;
+        }
+        // 删除段会丢掉其中的ack记录,还没被更新的ack补写一份
+        if (state.acked > 0 && std::binary_search(victims.begin(), victims.end(), state.ackSegment))
+            state.ackSegment = write(RECORD_ACK, user, state.acked, NULL, 0).segment;
+        return copied;
+    }
+    void OfflineStore::compactLater()
+    {
+        thread::Guard guard(_mutex);
+        _compactRequested = true;
+        _compactWake.signal();
+    }
+    StoreStats OfflineStore::stats()
+    {
+        thread::Guard guard(_mutex);
+        StoreStats st = {_segments.size(), 0, 0, 0, _commits};
+        for (auto it = _segments.begin(); it != _segments.end(); ++it)
+        {
+            st.liveBytes += it->second.liveBytes;
+            st.diskBytes += it->second.bytes;
+            st.messages += it->second.live;
+        }
+        return st;
+    }
+    /*
+     * 写盘线程:有人等待时立即写,否则攒commitInterval毫秒;写完一批只fdatasync一次
+     * 一批中任何一步失败都不推进_writtenPos,此后丢弃缓冲不再写,免得在坏掉的尾部后面继续追加
+     */
+    void OfflineStore::run()
+    {
+        int fd = -1;
+        uint32_t fdSegment = 0;
+        while (1)
+        {
+            std::vector<Pending> batch;
+            uint64_t target;
+            {
+                thread::Guard guard(_mutex);
+                if (!_urgent && !_stop)
+                    _wake.timedWait(_mutex, _option.commitInterval);
+                if (_buffer.empty())
+                {
+                    _urgent = false;
+                    if (_stop)
+                        break;
+                    continue;
+                }
+                batch.swap(_buffer);
+                target = _appendPos;
+                _urgent = false;
+                if (_failed)
+                    continue;
+            }
+            std::string error;
+            for (size_t i = 0; i < batch.size() && error.empty(); i++)
+            {
+                if (fd < 0 || fdSegment != batch[i].segment)
+                {
+                    if (fd >= 0)
+                    {
+                        if (_option.fsync && fdatasync(fd) < 0)
+                            error = failure("fdatasync", path(fdSegment));
+                        ::close(fd);
+                        fd = -1;
+                        if (!error.empty())
+                            break;
+                    }
+                    fdSegment = batch[i].segment;
+                    fd = openSegment(path(fdSegment), _option.dir, _option.fsync, error);
+                    if (fd < 0)
+                        break;
+                }
+                if (!writeAll(fd, batch[i].data.data(), batch[i].data.size()))
+                    error = failure("write", path(fdSegment));
+            }
+            if (error.empty() && fd >= 0 && _option.fsync && fdatasync(fd) < 0)
+                error = failure("fdatasync", path(fdSegment));
+            thread::Guard guard(_mutex);
+            if (error.empty())
+            {
+                _writtenPos = target;
+                _commits++;
+            }
+            else
+            {
+                fprintf(stderr, "OfflineStore: %s\n", error.c_str());
+                _failed = true;
+                _error = error;
+                _buffer.clear();
+            }
+            _written.brosdcast();
+        }
+        if (fd >= 0)
+            ::close(fd);
+        thread::Guard guard(_mutex);
+        _written.brosdcast();
+    }
+    /*
+     * 压缩线程:等compactLater的请求,在这里做compact,不占用调用方的线程
+     */
+    void OfflineStore::runCompact()
+    {
+        while (1)
+        {
+            {
+                thread::Guard guard(_mutex);
+                while (!_compactRequested && !_stop)
+                    _compactWake.wait(_mutex);
+                if (_stop)
+                    break;
+                _compactRequested = false;
+            }
+            compact();
+        }
+    }
+}
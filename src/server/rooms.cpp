@@ -0,0 +1,150 @@
+#include "rooms.hpp"
+
+namespace server
+{
+    void Rooms::join(long long room, long long user, const Connection::ptr &conn)
+    {
+        _rooms.upsert(room, [&](std::shared_ptr<Room> &r)
+                      {
+                          if (!r)
+                              r = std::make_shared<Room>();
+                          thread::WriteGuard guard(r->lock);
+                          r->members[user] = conn; });
+        _joined.upsert(user, [room](std::unordered_set<long long> &rooms)
+                       { rooms.insert(room); });
+    }
+    bool Rooms::leave(long long room, long long user)
+    {
+        if (!remove(room, user, NULL))
+            return false;
+        _joined.update(user, [room](std::unordered_set<long long> &rooms)
+                       { rooms.erase(room); });
+        _joined.eraseIf(user, [](const std::unordered_set<long long> &rooms)
+                        { return rooms.empty(); });
+        return true;
+    }
+    void Rooms::leaveAll(long long user, const Connection::ptr &conn)
+    {
+        std::unordered_set<long long> rooms;
+        if (!_joined.find(user, rooms))
+            return;
+        for (long long room : rooms)
+        {
+            if (remove(room, user, conn.get()))
+                _joined.update(user, [room](std::unordered_set<long long> &rooms)
+                               { rooms.erase(room); });
+        }
+        _joined.eraseIf(user, [](const std::unordered_set<long long> &rooms)
+                        { return rooms.empty(); });
+    }
+    void Rooms::rebind(long long user, const Connection::ptr &conn)
+    {
+        std::unordered_set<long long> rooms;
+        if (!_joined.find(user, rooms))
+            return;
+        for (long long room : rooms)
+        {
+            std::shared_ptr<Room> r;
+            if (!_rooms.find(room, r))
+                continue;
+            thread::WriteGuard guard(r->lock);
+            auto it = r->members.find(user);
+            if (it != r->members.end())
+                it->second = conn;
+        }
+    }
+    bool Rooms::contains(long long room, long long user) const
+    {
+        std::shared_ptr<Room> r;
+        if (!_rooms.find(room, r))
+            return false;
+        thread::ReadGuard guard(r->lock);
+        return r->members.count(user) != 0;
+    }
+    size_t Rooms::members(long long room) const
+    {
+        std::shared_ptr<Room> r;
+        if (!_rooms.find(room, r))
+            return 0;
+        thread::ReadGuard guard(r->lock);
+        return r->members.size();
+    }
+    long Rooms::broadcast(long long room, long long sender, const FrameFactory &frame)
+    {
+        std::shared_ptr<Room> r;
+        if (!_rooms.find(room, r))
+            return -1;
+        std::vector<std::shared_ptr<Batch>> batches;
+        long count = 0;
+        {
+            thread::ReadGuard guard(r->lock);
+            if (r->members.count(sender) == 0)
+                return -1;
+            for (auto it = r->members.begin(); it != r->members.end(); ++it)
+            {
+                Connection::ptr conn = it->second.lock();
+                if (!conn || !conn->connected())
+                    continue;
+                // loop数就是I/O线程数,线性查找即可
+                EventLoop *loop = conn->getLoop();
+                size_t i = 0;
+                while (i < batches.size() && batches[i]->loop != loop)
+                    i++;
+                if (i == batches.size())
+                {
+                    batches.push_back(std::make_shared<Batch>());
+                    batches[i]->loop = loop;
+                }
+                int encoding = conn->encoding() ? 1 : 0;
+                batches[i]->conns[encoding].push_back(std::move(conn));
+                count++;
+            }
+        }
+        // 锁外序列化,每种编码一次,所有loop共享
+        std::shared_ptr<const std::string> frames[2];
+        for (size_t i = 0; i < batches.size(); i++)
+        {
+            for (int e = 0; e < 2; e++)
+            {
+                if (batches[i]->conns[e].empty())
+                    continue;
+                if (!frames[e])
+                    frames[e] = frame(e);
+                batches[i]->frames[e] = frames[e];
+            }
+        }
+        for (size_t i = 0; i < batches.size(); i++)
+        {
+            std::shared_ptr<Batch> batch = batches[i];
+            batch->loop->runInLoop([batch]()
+                                   {
+                                       // 在loop线程里send直接进发送队列,本轮末尾统一writev
+                                       for (int e = 0; e < 2; e++)
+                                           for (size_t j = 0; j < batch->conns[e].size(); j++)
+                                               batch->conns[e][j]->send(batch->frames[e]); });
+        }
+        return count;
+    }
+    /*
+     * conn非空时只删除指向它或已失效的成员;房间空了就删掉房间
+     */
+    bool Rooms::remove(long long room, long long user, const Connection *conn)
+    {
+        bool removed = false;
+        _rooms.eraseIf(room, [&](const std::shared_ptr<Room> &r)
+                       {
+                           thread::WriteGuard guard(r->lock);
+                           auto it = r->members.find(user);
+                           if (it != r->members.end())
+                           {
+                               Connection::ptr member = it->second.lock();
+                               if (conn == NULL || !member || member.get() == conn)
+                               {
+                                   r->members.erase(it);
+                                   removed = true;
+                               }
+                           }
+                           return r->members.empty(); });
+        return removed;
+    }
+}
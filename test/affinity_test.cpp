@@ -0,0 +1,95 @@
+#include "thread.hpp"
+#include <iostream>
+#include <cassert>
+#include <cstring>
+/*
+ * 线程名/栈大小/绑核,以及线程池的PLACE_CORE和PLACE_NODE
+ */
+static std::vector<int> affinity()
+{
+    std::vector<int> cpus;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    pthread_getaffinity_np(pthread_self(), sizeof(set), &set);
+    for (int i = 0; i < CPU_SETSIZE; i++)
+    {
+        if (CPU_ISSET(i, &set))
+            cpus.push_back(i);
+    }
+    return cpus;
+}
+static std::string name()
+{
+    char buf[16];
+    pthread_getname_np(pthread_self(), buf, sizeof(buf));
+    return buf;
+}
+
+int main()
+{
+    const thread::Topology &topology = thread::Topology::get();
+    std::cout << "cpus=" << topology.cpus().size() << " nodes=" << topology.nodes().size() << std::endl;
+    assert(!topology.cpus().empty());
+
+    thread::ThreadOption option;
+    option.name = "a-very-long-thread-name";
+    option.stackSize = 256 * 1024;
+    option.cpus.push_back(topology.cpus().back());
+    std::string seenName;
+    std::vector<int> seenCpus;
+    size_t seenStack = 0;
+    thread::Thread t([&]()
+                     {
+                         seenName = name();
+                         seenCpus = affinity();
+                         pthread_attr_t attr;
+                         pthread_getattr_np(pthread_self(), &attr);
+                         pthread_attr_getstacksize(&attr, &seenStack);
+                         pthread_attr_destroy(&attr); },
+                     option);
+    assert(t.start());
+    t.join();
+    assert(seenName == "a-very-long-thr");
+    assert(seenCpus.size() == 1 && seenCpus[0] == topology.cpus().back());
+    assert(seenStack >= 256 * 1024);
+
+    for (int place = thread::PLACE_CORE; place <= thread::PLACE_NODE; place++)
+    {
+        thread::PoolOption po;
+        po.mode = thread::SCHEDULE_STEALING;
+        po.place = (thread::placement)place;
+        po.name = "w";
+        size_t n = topology.cpus().size() + 1;
+        thread::ThreadPool pool(n, po);
+        pool.start();
+        thread::Mutex mutex;
+        std::vector<std::vector<int>> masks;
+        std::vector<std::string> names;
+        std::vector<thread::Future<void>> futures;
+        for (size_t i = 0; i < n * 4; i++)
+        {
+            futures.push_back(pool.submit([&]()
+                                          {
+                                              thread::Guard guard(mutex);
+                                              masks.push_back(affinity());
+                                              names.push_back(name()); }));
+        }
+        for (size_t i = 0; i < futures.size(); i++)
+            futures[i].get();
+        pool.stop();
+        for (size_t i = 0; i < masks.size(); i++)
+        {
+            assert(names[i].compare(0, 2, "w-") == 0);
+            if (place == thread::PLACE_CORE)
+                assert(masks[i].size() == 1);
+            else
+            {
+                bool found = false;
+                for (size_t j = 0; j < topology.nodes().size(); j++)
+                    found = found || masks[i] == topology.nodes()[j];
+                assert(found);
+            }
+        }
+    }
+    std::cout << "affinity_test OK" << std::endl;
+}
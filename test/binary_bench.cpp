@@ -0,0 +1,131 @@
+#include "json.hpp"
+#include "document.hpp"
+#include "bind.hpp"
+#include "message.hpp"
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <time.h>
+/*
+ * 文本和二进制比较:同一条消息的字节数、解码成DOM和从DOM编码的吞吐
+ * 聊天消息以正文为主;状态同步消息以数字和短键为主(节点之间的流量)
+ * route:服务端转发一条私聊(取type、绑定、序列化推送),二进制直接读和先转文本再读的对比
+ */
+static double now()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+template <class F>
+static double run(size_t size, long long bytes, F f)
+{
+    int n = (int)(bytes / size) + 1;
+    f(); // 预热
+    double begin = now();
+    for (int i = 0; i < n; i++)
+        f();
+    return n / (now() - begin);
+}
+static std::string makeChat(size_t size)
+{
+    std::string text = "hello, how are you doing today? \xe4\xbd\xa0\xe5\xa5\xbd, see you at the usual place around eight.\\n";
+    std::string msg = "{\"type\":\"chat\",\"from\":10001,\"to\":12345,\"ts\":1700000000123,"
+                      "\"tags\":[\"urgent\",\"family\",\"mobile\"],"
+                      "\"meta\":{\"client\":\"ios\",\"version\":\"1.2.3\",\"seq\":42},\"msg\":\"";
+    while (msg.size() + text.size() + 2 <= size)
+        msg += text;
+    msg += "\"}";
+    return msg;
+}
+static std::string makeState(size_t size)
+{
+    std::string msg = "{\"type\":\"state\",\"node\":3,\"ts\":1700000000123,\"users\":[";
+    for (int i = 0; msg.size() + 80 <= size; i++)
+    {
+        char buf[128];
+        snprintf(buf, sizeof(buf), "%s{\"id\":%d,\"room\":%d,\"rtt\":%.3f,\"seq\":%d,\"on\":%s}", i ? "," : "",
+                 100000 + i * 37, i % 50, 12.5 + i * 0.173, i * 1009, i % 3 ? "true" : "false");
+        msg += buf;
+    }
+    msg += "]}";
+    return msg;
+}
+
+int main(int argc, char *argv[])
+{
+    long long bytes = argc > 1 ? atoll(argv[1]) : 100000000;
+    size_t sizes[] = {200, 1024, 8192};
+    const char *kinds[] = {"chat", "state"};
+    json::Document doc;
+    long long sum = 0;
+    printf("%-6s %6s %6s %6s | %10s %10s %6s | %10s %10s %6s\n", "kind", "text", "binary", "ratio", "parse/s",
+           "decode/s", "x", "format/s", "encode/s", "x");
+    for (int k = 0; k < 2; k++)
+    {
+        for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+        {
+            std::string text = k == 0 ? makeChat(sizes[s]) : makeState(sizes[s]);
+            std::string bin;
+            doc.parse(text).encode(bin);
+            double parse = run(text.size(), bytes, [&]()
+                               { sum += doc.parse(text).size(); });
+            double decode = run(text.size(), bytes, [&]()
+                                { sum += doc.decode(bin).size(); });
+            json::Document tree;
+            const json::Node &root = tree.parse(text);
+            std::string out;
+            double format = run(text.size(), bytes, [&]()
+                                { out.clear(); root.format(out); sum += out.size(); });
+            double encode = run(text.size(), bytes, [&]()
+                                { out.clear(); root.encode(out); sum += out.size(); });
+            printf("%-6s %6zu %6zu %5.0f%% | %10.0f %10.0f %5.1fx | %10.0f %10.0f %5.1fx\n", kinds[k], text.size(),
+                   bin.size(), 100.0 * bin.size() / text.size(), parse, decode, decode / parse, format, encode,
+                   encode / format);
+        }
+    }
+    // 私聊转发:text是文本进文本出,binary直接读二进制、Raw原样复制,via text是先转成文本再走文本的路
+    json::Binder binder;
+    printf("\n%-6s %6s | %10s %10s %10s\n", "route", "text", "text/s", "binary/s", "via text/s");
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+        std::string text = makeChat(sizes[s]);
+        std::string bin;
+        doc.parse(text).encode(bin);
+        std::string out;
+        double textRoute = run(text.size(), bytes, [&]()
+                               {
+                                   json::Field field = {"type"};
+                                   binder.pick(text, &field, 1);
+                                   chat::Private msg;
+                                   binder.bindAll(text, msg);
+                                   chat::PrivatePush push = {"chat", 1, msg.msg};
+                                   out.clear();
+                                   json::format(push, out);
+                                   sum += out.size(); });
+        double binRoute = run(text.size(), bytes, [&]()
+                              {
+                                  json::Field field = {"type"};
+                                  binder.pickBinary(bin, &field, 1);
+                                  chat::Private msg;
+                                  binder.bindAllBinary(bin, msg);
+                                  chat::PrivatePush push = {"chat", 1, msg.msg};
+                                  out.clear();
+                                  json::encode(push, out);
+                                  sum += out.size(); });
+        double viaText = run(text.size(), bytes, [&]()
+                             {
+                                 std::string t;
+                                 doc.decode(bin).format(t);
+                                 json::Field field = {"type"};
+                                 binder.pick(t, &field, 1);
+                                 chat::Private msg;
+                                 binder.bindAll(t, msg);
+                                 chat::PrivatePush push = {"chat", 1, msg.msg};
+                                 out.clear();
+                                 json::encode(push, out);
+                                 sum += out.size(); });
+        printf("%-6s %6zu | %10.0f %10.0f %10.0f\n", "chat", text.size(), textRoute, binRoute, viaText);
+    }
+    return sum == 0;
+}
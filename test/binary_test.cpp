@@ -0,0 +1,184 @@
+#include "bind.hpp"
+#include "message.hpp"
+#include <iostream>
+#include <cassert>
+#include <string>
+/*
+ * 二进制编码:和RFC 8949附录A的例子逐字节一致,文本->二进制->文本无损,
+ * 不合法或JSON没有对应的输入抛出异常,绑定和pick直接读二进制
+ */
+static std::string hex(const std::string &s)
+{
+    static const char digits[] = "0123456789abcdef";
+    std::string out;
+    for (size_t i = 0; i < s.size(); i++)
+    {
+        out += digits[(unsigned char)s[i] >> 4];
+        out += digits[(unsigned char)s[i] & 15];
+    }
+    return out;
+}
+static std::string unhex(const std::string &s)
+{
+    std::string out;
+    for (size_t i = 0; i + 1 < s.size(); i += 2)
+        out += (char)std::stoi(s.substr(i, 2), NULL, 16);
+    return out;
+}
+static std::string encodeText(const std::string &text)
+{
+    json::Document doc;
+    std::string out;
+    doc.parse(text).encode(out);
+    return hex(out);
+}
+static std::string roundTrip(const std::string &text)
+{
+    json::Document doc, back;
+    std::string bin;
+    doc.parse(text).encode(bin);
+    return back.decode(bin).formatString();
+}
+static bool fails(const std::string &bin)
+{
+    json::Document doc;
+    try
+    {
+        doc.decode(bin);
+    }
+    catch (const json::Exception &)
+    {
+        return true;
+    }
+    return false;
+}
+
+int main()
+{
+    // RFC 8949附录A
+    assert(encodeText("0") == "00" && encodeText("23") == "17" && encodeText("24") == "1818");
+    assert(encodeText("100") == "1864" && encodeText("1000") == "1903e8" && encodeText("1000000") == "1a000f4240");
+    assert(encodeText("1000000000000") == "1b000000e8d4a51000");
+    assert(encodeText("-1") == "20" && encodeText("-100") == "3863" && encodeText("-1000") == "3903e7");
+    assert(encodeText("1.5") == "fa3fc00000" && encodeText("1.1") == "fb3ff199999999999a");
+    assert(encodeText("false") == "f4" && encodeText("true") == "f5" && encodeText("null") == "f6");
+    assert(encodeText("\"\"") == "60" && encodeText("\"a\"") == "6161" && encodeText("\"\\u00fc\"") == "62c3bc");
+    assert(encodeText("[]") == "80" && encodeText("[1,2,3]") == "83010203" && encodeText("[1,[2,3],[4,5]]") == "8301820203820405");
+    assert(encodeText("{}") == "a0" && encodeText("{\"a\":1,\"b\":[2,3]}") == "a26161016162820203");
+
+    // 文本往返
+    std::string input = "{\"type\":\"chat\",\"to\":42,\"pi\":-3.5,\"tenth\":0.1,\"big\":123456789012345678901,\"ok\":true,"
+                        "\"nil\":null,\"msg\":\"a\\\"b\\n\\u4f60\",\"list\":[1,[],{},-9223372036854775807,4294967296],"
+                        "\"o\":{\"k\":[{\"x\":false}]}}";
+    json::Document doc;
+    assert(roundTrip(input) == doc.parse(input).formatString());
+    std::string bin;
+    doc.parse(input).encode(bin);
+    assert(bin.size() < input.size());
+
+    // 不定长形式、float64、超出long long的整数
+    json::Document back;
+    assert(back.decode(unhex("bf61619f0102ffff")).formatString() == "{\"a\":[1,2]}");
+    assert(back.decode(unhex("fb3ff8000000000000")).toDouble() == 1.5);
+    assert(back.decode(unhex("1bffffffffffffffff")).toDouble() == 18446744073709551615.0);
+    assert(back.decode(unhex("3b7fffffffffffffff")).toInt() == -9223372036854775807LL - 1);
+    // 字符串直接指向输入
+    std::string text = unhex("6568656c6c6f");
+    assert(back.decode(text).data() == text.data() + 1);
+
+    assert(fails("") && fails(unhex("18")) && fails(unhex("6261")) && fails(unhex("4161")) && fails(unhex("c001")));
+    assert(fails(unhex("a10101")) && fails(unhex("9a7fffffff")) && fails(unhex("0000")) && fails(unhex("ff")));
+    assert(fails(unhex("9f01")) && fails(unhex("1c")) && fails(unhex("7f6161ff")) && fails(std::string(1000, '\x81')));
+
+    // value
+    json::json tree("{\"o\":{\"k\":[{\"x\":false}]}}");
+    json::value v = json::value::decode(tree["o"].toBinary());
+    assert(v.formatString() == "{\"k\":[{\"x\":false}]}");
+    json::json j("{\"n\":[1.25,2.5],\"s\":\"\\u4f60\"}");
+    assert(json::value::decode(j["n"].toBinary()).formatString() == "[1.25,2.5]");
+    assert(json::value::decode(j["s"].toBinary()).toText() == "\xe4\xbd\xa0");
+    bool threw = false;
+    try
+    {
+        json::value::decode(unhex("820161"));
+    }
+    catch (const json::Exception &)
+    {
+        threw = true;
+    }
+    assert(threw);
+
+    // Encoder:不带个数时不定长,超过64层也能配对
+    std::string out;
+    json::Encoder e(out);
+    e.startObject();
+    e.key("a");
+    e.startArray(2);
+    e.number(1);
+    e.startArray();
+    for (int i = 0; i < 100; i++)
+        e.startArray();
+    for (int i = 0; i < 100; i++)
+        e.endArray();
+    e.endArray();
+    e.endArray();
+    e.endObject();
+    assert(out.size() == 1 + 2 + 1 + 1 + 1 + 200 + 1 + 1);
+    assert(back.decode(out).formatString() == "{\"a\":[1,[" + std::string(100, '[') + std::string(100, ']') + "]]}");
+
+    // 绑定的结构体,Raw原文转码成二进制
+    chat::GroupPush push = {"group", 7, 345, {"{\"t\":\"hi\",\"n\":[1.5]}", 20}};
+    std::string textOut, binOut;
+    json::format(push, textOut);
+    json::encode(push, binOut);
+    assert(back.decode(binOut).formatString() == textOut);
+    assert(binOut.size() < textOut.size());
+    chat::Ack ack = {"ack", "login", 0, ""};
+    binOut.clear();
+    json::encode(ack, binOut);
+    assert(hex(binOut).substr(0, 2) == "a4");
+
+    // 二进制直接pick和绑定,不经过文本;Raw写进二进制时原样复制,写成文本时转码
+    std::string request;
+    json::Document req;
+    req.parse("{\"type\":\"chat\",\"to\":1234567890123456789,\"msg\":{\"t\":\"hi\",\"n\":[1.5,-2]}}").encode(request);
+    json::Binder binder;
+    json::Field field = {"type"};
+    assert(binder.pickBinary(request, &field, 1) == 1 && field.value.equals("chat") && hex(std::string(field.text, field.size)) == "6463686174");
+    chat::Private priv;
+    binder.bindAllBinary(request, priv);
+    assert(priv.to == 1234567890123456789LL && priv.msg.binary && priv.msg.text > request.data() && priv.msg.text < request.data() + request.size());
+    chat::PrivatePush forward = {"chat", 1, priv.msg};
+    binOut.clear();
+    textOut.clear();
+    json::encode(forward, binOut);
+    json::format(forward, textOut);
+    assert(binOut.find(std::string(priv.msg.text, priv.msg.size)) != std::string::npos);
+    assert(textOut == "{\"type\":\"chat\",\"from\":1,\"msg\":{\"t\":\"hi\",\"n\":[1.5,-2]}}");
+    assert(back.decode(binOut).formatString() == textOut);
+    // 不定长对象、未知键和数组成员
+    binder.bindAllBinary(unhex("bf6474797065646368617462746f0263657874f6636d7367820102ff"), priv);
+    assert(priv.to == 2 && priv.msg.size == 3);
+    bool badBinary = false;
+    try
+    {
+        binder.bindAllBinary(unhex("a162746f6161"), priv); // to是字符串
+    }
+    catch (const json::Exception &)
+    {
+        badBinary = true;
+    }
+    assert(badBinary);
+    badBinary = false;
+    try
+    {
+        binder.bindAllBinary(unhex("a262746f01636d7367"), priv); // msg的值缺失
+    }
+    catch (const json::Exception &)
+    {
+        badBinary = true;
+    }
+    assert(badBinary);
+    std::cout << "binary_test OK" << std::endl;
+    return 0;
+}
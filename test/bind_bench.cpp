@@ -0,0 +1,133 @@
+#include "json.hpp"
+#include "bind.hpp"
+#include "message.hpp"
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <time.h>
+/*
+ * 服务端的消息组合(登录、私聊、群聊、进群各占1/4):
+ * j["key"]读取字段并用value树生成回复,对比结构体绑定解析和序列化
+ */
+static size_t mallocs = 0;
+void *operator new(size_t n)
+{
+    mallocs++;
+    void *p = malloc(n);
+    if (p == NULL)
+        throw std::bad_alloc();
+    return p;
+}
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+static double now()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+template <class F>
+static void run(const char *name, const std::vector<std::string> &mix, int n, F f)
+{
+    size_t bytes = 0;
+    for (size_t i = 0; i < mix.size(); i++)
+        bytes += mix[i].size();
+    for (size_t i = 0; i < mix.size(); i++)
+        f(mix[i]); // 预热
+    size_t m = mallocs;
+    double begin = now();
+    for (int i = 0; i < n; i++)
+        for (size_t k = 0; k < mix.size(); k++)
+            f(mix[k]);
+    double elapsed = now() - begin;
+    double msgs = (double)n * mix.size();
+    printf("%-8s %6.1f allocs/msg %9.0f msgs/s %7.1f MB/s\n", name, (mallocs - m) / msgs, msgs / elapsed,
+           bytes * (double)n / elapsed / 1e6);
+}
+
+int main(int argc, char *argv[])
+{
+    int n = argc > 1 ? atoi(argv[1]) : 100000;
+    std::vector<std::string> mix = {
+        "{\"type\":\"login\",\"id\":10001}",
+        "{\"type\":\"chat\",\"to\":12345,\"msg\":\"hello, how are you doing today? see you at eight\"}",
+        "{\"type\":\"group\",\"room\":7,\"msg\":\"meeting moved to room 3, bring the slides please\"}",
+        "{\"type\":\"join\",\"room\":7}"};
+    long long sum = 0;
+    run("value", mix, n, [&](const std::string &payload)
+        {
+            json::json j(payload);
+            std::string type = j["type"].toText();
+            json::json out;
+            if (type == "login")
+            {
+                sum += j["id"].toInt();
+                out["type"] = "\"ack\"";
+                out["for"] = "\"login\"";
+                out["code"] = 0;
+            }
+            else if (type == "chat")
+            {
+                out["type"] = "\"chat\"";
+                out["from"] = j["to"].toInt();
+                out["msg"] = j["msg"].formatString();
+            }
+            else if (type == "group")
+            {
+                out["type"] = "\"group\"";
+                out["room"] = j["room"].toInt();
+                out["from"] = 10001;
+                out["msg"] = j["msg"].formatString();
+            }
+            else
+            {
+                sum += j["room"].toInt();
+                out["type"] = "\"ack\"";
+                out["for"] = "\"join\"";
+                out["code"] = 0;
+            }
+            sum += out.formatString().size(); });
+
+    json::Binder binder;
+    std::string out;
+    run("bind", mix, n, [&](const std::string &payload)
+        {
+            json::Field type = {"type"};
+            binder.pick(payload, &type, 1);
+            out.clear();
+            if (type.value.equals("login"))
+            {
+                chat::Login msg;
+                binder.bindAll(payload, msg);
+                sum += msg.id;
+                chat::Ack ack = {"ack", "login", 0, ""};
+                json::format(ack, out);
+            }
+            else if (type.value.equals("chat"))
+            {
+                chat::Private msg;
+                binder.bindAll(payload, msg);
+                chat::PrivatePush push = {"chat", msg.to, msg.msg};
+                json::format(push, out);
+            }
+            else if (type.value.equals("group"))
+            {
+                chat::Group msg;
+                binder.bindAll(payload, msg);
+                chat::GroupPush push = {"group", msg.room, 10001, msg.msg};
+                json::format(push, out);
+            }
+            else
+            {
+                chat::Room msg;
+                binder.bindAll(payload, msg);
+                sum += msg.room;
+                chat::Ack ack = {"ack", "join", 0, ""};
+                json::format(ack, out);
+            }
+            sum += out.size(); });
+    return sum == 0;
+}
@@ -0,0 +1,93 @@
+#include "bind.hpp"
+#include "message.hpp"
+#include <iostream>
+#include <cassert>
+/*
+ * 结构体绑定:嵌套、数组、转义、未知键、Raw原样转发、关键字成员、缺少成员和类型错误
+ */
+namespace demo
+{
+    struct Point
+    {
+        int x;
+        int y;
+    };
+    JSON_BIND(Point, x, y)
+    struct Shape
+    {
+        std::string name;
+        double scale;
+        bool visible;
+        std::vector<Point> points;
+        std::vector<std::string> tags;
+        Point origin;
+        long long id;
+    };
+    JSON_BIND(Shape, name, scale, visible, points, tags, origin, id)
+}
+static bool fails(const std::string &s)
+{
+    json::Binder binder;
+    chat::Private m;
+    try
+    {
+        binder.bindAll(s, m);
+    }
+    catch (const json::Exception &)
+    {
+        return true;
+    }
+    return false;
+}
+
+int main()
+{
+    json::Binder binder;
+    demo::Shape shape = demo::Shape();
+    std::string input = "{\"name\":\"tri\\\"angle\\u4f60\",\"unknown\":{\"deep\":[1,{\"x\":2}]},\"scale\":1.5,\"visible\":true,"
+                        "\"points\":[{\"x\":1,\"y\":2},{\"y\":4,\"x\":3}],\"tags\":[\"a\",\"b\"],\"origin\":{\"x\":-1},\"id\":9007199254740993}";
+    uint64_t mask = binder.bind(input, shape);
+    assert(mask == 0x7F);
+    assert(shape.name == "tri\"angle\xe4\xbd\xa0" && shape.scale == 1.5 && shape.visible);
+    assert(shape.points.size() == 2 && shape.points[1].x == 3 && shape.points[1].y == 4);
+    assert(shape.tags.size() == 2 && shape.tags[1] == "b");
+    assert(shape.origin.x == -1 && shape.origin.y == 0 && shape.id == 9007199254740993LL);
+    // 19位的int64 ID不经过double
+    demo::Shape big = demo::Shape();
+    assert(binder.bind("{\"id\":1234567890123456789}", big) == 0x40 && big.id == 1234567890123456789LL);
+
+    // 序列化后再绑定得到同样的值
+    std::string out;
+    json::format(shape, out);
+    assert(out == "{\"name\":\"tri\\\"angle\xe4\xbd\xa0\",\"scale\":1.5,\"visible\":true,\"points\":[{\"x\":1,\"y\":2},{\"x\":3,\"y\":4}],"
+                  "\"tags\":[\"a\",\"b\"],\"origin\":{\"x\":-1,\"y\":0},\"id\":9007199254740993}");
+    demo::Shape again = demo::Shape();
+    assert(binder.bind(out, again) == 0x7F && again.points[0].y == 2 && again.name == shape.name);
+
+    // 缺少的成员保持原值,位图里没有
+    demo::Point p = {5, 6};
+    assert(binder.bind("{\"y\":1}", p) == 2 && p.x == 5 && p.y == 1);
+
+    // 协议消息:type作为未知键跳过,msg原文转发
+    std::string chatMsg = "{\"type\":\"chat\",\"to\":42,\"msg\":{\"text\":\"hi\\n\",\"at\":[1,2]}}";
+    chat::Private m;
+    binder.bindAll(chatMsg, m);
+    assert(m.to == 42 && std::string(m.msg.text, m.msg.size) == "{\"text\":\"hi\\n\",\"at\":[1,2]}");
+    chat::PrivatePush push = {"chat", 7, m.msg};
+    out.clear();
+    json::format(push, out);
+    assert(out == "{\"type\":\"chat\",\"from\":7,\"msg\":{\"text\":\"hi\\n\",\"at\":[1,2]}}");
+    chat::Ack ack = {"ack", "login", 0, ""};
+    out.clear();
+    json::format(ack, out);
+    assert(out == "{\"type\":\"ack\",\"for\":\"login\",\"code\":0,\"msg\":\"\"}");
+
+    assert(fails("{\"to\":1}"));               // 缺少msg
+    assert(fails("{\"to\":\"x\",\"msg\":1}"));  // 类型不对
+    assert(fails("{\"to\":1,\"msg\":[1,}"));    // 跳过的值也检查结构
+    assert(fails("{\"to\":1,\"msg\":1} x"));    // 多余的输入
+    assert(fails("[1]"));
+    assert(!fails(" { \"msg\" : null , \"to\" : 1 } "));
+    std::cout << "bind_test OK" << std::endl;
+    return 0;
+}
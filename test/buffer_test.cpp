@@ -0,0 +1,100 @@
+#include "buffer.hpp"
+#include "protocol.hpp"
+#include <iostream>
+#include <cassert>
+#include <string>
+#include <fcntl.h>
+#include <sys/socket.h>
+/*
+ * 收发缓冲:多帧一次writev写出,写不完的部分按顺序续写,
+ * 接收缓冲放得下大帧,读空后块回到池里
+ */
+static std::string drain(int fd)
+{
+    std::string out;
+    char buf[65536];
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) > 0)
+        out.append(buf, n);
+    return out;
+}
+
+int main()
+{
+    int fds[2];
+    assert(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    fcntl(fds[1], F_SETFL, O_NONBLOCK);
+
+    // 小帧拷进块里首尾相接,共享帧和大帧只记引用
+    server::OutputBuffer out;
+    std::string expect;
+    for (int i = 0; i < 200; i++)
+    {
+        std::string frame = chat::encodeFrame("{\"n\":" + std::to_string(i) + "}");
+        expect += frame;
+        out.append(frame.data(), frame.size());
+    }
+    assert(out.segments() == 1);
+    std::shared_ptr<const std::string> shared = std::make_shared<std::string>(chat::encodeFrame(std::string(100, 's')));
+    out.append(shared);
+    out.append(std::string(server::COPY_MAX, 'b'));
+    expect += *shared + std::string(server::COPY_MAX, 'b');
+    assert(out.segments() == 3 && out.size() == expect.size());
+    ssize_t n = out.writeFd(fds[0]);
+    assert(n == (ssize_t)expect.size() && out.empty());
+    assert(drain(fds[1]) == expect);
+
+    // 写到EAGAIN,读走后从断点续写
+    expect.clear();
+    std::string big(server::CHUNK_SIZE * 3 + 7, 'x');
+    for (int i = 0; i < 64; i++)
+    {
+        big[0] = (char)('a' + i % 26);
+        expect += big;
+        out.append(big.data(), big.size());
+        out.append(shared);
+        expect += *shared;
+    }
+    std::string got;
+    while (!out.empty())
+    {
+        n = out.writeFd(fds[0]);
+        assert(n > 0 || errno == EAGAIN);
+        got += drain(fds[1]);
+    }
+    got += drain(fds[1]);
+    assert(got == expect);
+    size_t idle = server::ChunkPool::idle();
+    assert(idle > 0 && shared.use_count() == 1);
+
+    // 接收缓冲
+    server::InputBuffer in;
+    std::string payload(100000, 'p');
+    std::string frames = chat::encodeFrame("{}") + chat::encodeFrame(payload);
+    assert(write(fds[1], frames.data(), frames.size()) == (ssize_t)frames.size());
+    while (in.readFd(fds[0]) > 0)
+    {
+    }
+    assert(in.size() == frames.size() && in.capacity() >= frames.size());
+    std::string p;
+    size_t consumed;
+    assert(chat::decodeFrame(in.data(), in.size(), p, consumed) == chat::FRAME_OK && p == "{}");
+    in.consume(consumed);
+    assert(chat::decodeFrame(in.data(), in.size(), p, consumed) == chat::FRAME_OK && p == payload);
+    in.consume(consumed);
+    in.release();
+    assert(in.size() == 0 && in.capacity() == 0);
+    // 平时只用池中的一个块
+    assert(write(fds[1], "abc", 3) == 3);
+    idle = server::ChunkPool::idle();
+    in.readFd(fds[0]);
+    assert(in.capacity() == server::CHUNK_SIZE && server::ChunkPool::idle() == idle - 1);
+    in.consume(3);
+    in.release();
+    assert(server::ChunkPool::idle() == idle);
+    close(fds[0]);
+    close(fds[1]);
+    std::cout << "buffer_test OK" << std::endl;
+    return 0;
+}
@@ -0,0 +1,106 @@
+#include "document.hpp"
+#include <iostream>
+#include <cassert>
+#include <climits>
+#include <cstdlib>
+#include <new>
+/*
+ * arena DOM:类型、转义、字符串视图、错误处理,以及稳定后解析不申请内存
+ */
+static size_t mallocs = 0;
+void *operator new(size_t n)
+{
+    mallocs++;
+    void *p = malloc(n);
+    if (p == NULL)
+        throw std::bad_alloc();
+    return p;
+}
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+static bool fails(const std::string &s)
+{
+    json::Document doc;
+    try
+    {
+        doc.parse(s);
+    }
+    catch (const json::Exception &)
+    {
+        return true;
+    }
+    return false;
+}
+
+int main()
+{
+    json::Document doc;
+    std::string input = "{\"type\":\"chat\",\"to\":42,\"neg\":-7,\"pi\":3.25,\"big\":12345678901234567890,\"ok\":true,\"no\":false,\"nil\":null,"
+                        "\"msg\":\"a\\\"b\\\\c\\n\\u4f60\\ud83d\\ude00\",\"list\":[1,\"two\",[3],{\"four\":4}],\"empty\":{},\"none\":[],\"to\":43}";
+    const json::Node &root = doc.parse(input);
+    assert(root.isObject() && root.size() == 13);
+    assert(root["type"].equals("chat") && root["type"].toText() == "chat");
+    assert(root["type"].data() >= input.data() && root["type"].data() < input.data() + input.size()); // 没有转义,指向输入
+    assert(root["to"].toInt() == 43);                                                                // 重复的键取最后一个
+    assert(root["neg"].toInt() == -7 && root["neg"].isInt());
+    assert(root["pi"].toDouble() == 3.25 && !root["pi"].isInt());
+    assert(root["big"].toDouble() > 1.2e19);
+    // 19位但能放进long long的整数不经过double
+    json::Document edgeDoc;
+    const json::Node &edge = edgeDoc.parse("[1234567890123456789,9223372036854775807,-9223372036854775808,9223372036854775808]");
+    assert(edge[0].isInt() && edge[0].toInt() == 1234567890123456789LL);
+    assert(edge[1].toInt() == LLONG_MAX && edge[2].isInt() && edge[2].toInt() == LLONG_MIN);
+    assert(!edge[3].isInt() && edge[3].toDouble() > 9.2e18);
+    assert(root["ok"].toBool() && !root["no"].toBool() && root["nil"].isNull());
+    assert(root["msg"].toText() == "a\"b\\c\n\xe4\xbd\xa0\xf0\x9f\x98\x80");
+    assert(root["list"].size() == 4 && root["list"][1].toText() == "two" && root["list"][2][0].toInt() == 3);
+    assert(root["list"][3]["four"].toInt() == 4);
+    assert(root["empty"].isObject() && root["empty"].size() == 0 && root["none"].isArray() && root["none"].size() == 0);
+    assert(root["missing"].isNull() && root.find("missing") == NULL);
+    bool threw = false;
+    try
+    {
+        root["type"].toInt();
+    }
+    catch (const json::Exception &)
+    {
+        threw = true;
+    }
+    assert(threw);
+
+    // 输出再解析得到同样的结构
+    std::string out = root.formatString();
+    json::Document again;
+    const json::Node &r2 = again.parse(out);
+    assert(r2.formatString() == out);
+    assert(r2["msg"].toText() == root["msg"].toText() && r2["pi"].toDouble() == 3.25);
+
+    // copy之后不再依赖输入
+    {
+        std::string tmp = "[\"view\"]";
+        json::Document copied;
+        copied.parse(tmp, true);
+        tmp.assign(tmp.size(), 'x');
+        assert(copied.root()[0].toText() == "view");
+    }
+
+    assert(doc.parse(" 12 ").toInt() == 12);
+    assert(doc.parse("\"s\"").toText() == "s");
+    assert(fails("") && fails("{") && fails("{\"a\"}") && fails("{\"a\":1,}") && fails("[1 2]") && fails("01") &&
+           fails("1.") && fails("-") && fails("\"abc") && fails("\"\\x\"") && fails("\"\\ud800\"") && fails("tru") &&
+           fails("{} x") && fails("\"a\nb\"") && fails(std::string(1000, '[')));
+
+    // 稳定后不申请内存
+    std::string msg = "{\"type\":\"chat\",\"to\":12345,\"msg\":\"hello \\u4f60\\u597d\",\"tags\":[\"a\",\"b\"],\"meta\":{\"client\":\"ios\"}}";
+    for (int i = 0; i < 10; i++)
+        doc.parse(msg);
+    size_t before = mallocs;
+    for (int i = 0; i < 1000; i++)
+        doc.parse(msg);
+    assert(mallocs == before);
+    assert(doc.arena().blocks() == 1);
+    std::cout << "document_test OK" << std::endl;
+}
@@ -0,0 +1,96 @@
+#include "json.hpp"
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <new>
+#include <thread>
+#include <vector>
+#include <time.h>
+/*
+ * 一条群消息发给N个接收者,模拟EventLoop跨线程投递:每个接收者一个闭包进队列,
+ * I/O线程执行时把帧追加到各自的输出缓冲
+ * copy:闭包里带一份帧的拷贝;shared:闭包里只有snapshot序列化结果的引用计数
+ */
+static size_t mallocs = 0;
+void *operator new(size_t n)
+{
+    __atomic_fetch_add(&mallocs, 1, __ATOMIC_RELAXED);
+    void *p = malloc(n);
+    if (p == NULL)
+        throw std::bad_alloc();
+    return p;
+}
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+static double now()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+/*
+ * threads个I/O线程各自执行自己那份队列
+ */
+template <class F>
+static void run(const char *name, size_t recipients, int threads, int rounds, F post)
+{
+    std::vector<std::vector<std::function<void()>>> queues(threads);
+    std::vector<std::string> outputs(recipients);
+    for (int t = 0; t < threads; t++)
+        queues[t].reserve(recipients / threads + 1);
+    size_t m = mallocs;
+    double begin = now();
+    for (int r = 0; r < rounds; r++)
+    {
+        for (size_t i = 0; i < recipients; i++)
+            queues[i % threads].push_back(post(outputs[i]));
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; t++)
+            workers.emplace_back([&queues, t]()
+                                 {
+                                     for (size_t k = 0; k < queues[t].size(); k++)
+                                         queues[t][k]();
+                                     queues[t].clear(); });
+        for (int t = 0; t < threads; t++)
+            workers[t].join();
+        for (size_t i = 0; i < recipients; i++)
+            outputs[i].clear();
+    }
+    double elapsed = now() - begin;
+    printf("%-7s %6zu recipients %2d threads %8.1f allocs/msg %9.0f deliveries/s\n", name, recipients, threads,
+           (double)(mallocs - m) / rounds, recipients * (double)rounds / elapsed);
+}
+
+int main(int argc, char *argv[])
+{
+    int rounds = argc > 1 ? atoi(argv[1]) : 200;
+    json::json j;
+    j["type"] = "\"group\"";
+    j["room"] = 7;
+    j["from"] = 10001;
+    std::string body(1000, 'x');
+    j["msg"] = "\"" + body + "\"";
+    json::snapshot snap = j.freeze();
+    size_t sizes[] = {100, 1000, 10000};
+    for (size_t s = 0; s < 3; s++)
+    {
+        for (int threads = 1; threads <= 4; threads *= 4)
+        {
+            run("copy", sizes[s], threads, rounds, [&](std::string &out)
+                {
+                    std::string frame = snap.text();
+                    return std::function<void()>([&out, frame]()
+                                                 { out.append(frame); }); });
+            run("shared", sizes[s], threads, rounds, [&](std::string &out)
+                {
+                    std::shared_ptr<const std::string> frame = snap.shared();
+                    return std::function<void()>([&out, frame]()
+                                                 { out.append(*frame); }); });
+        }
+    }
+    return 0;
+}
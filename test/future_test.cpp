@@ -0,0 +1,102 @@
+#include "thread.hpp"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cassert>
+/*
+ * submit/submit_batch/parallel_for的正确性
+ */
+static int square(int x)
+{
+    return x * x;
+}
+
+static void test(thread::schedule_mode mode)
+{
+    thread::ThreadPool pool(3, mode);
+    pool.start();
+
+    thread::Future<int> f = pool.submit(square, 7);
+    assert(f.get() == 49);
+    thread::Future<std::string> s = pool.submit([](const std::string &a)
+                                                { return a + "!"; },
+                                                std::string("hello"));
+    assert(s.get() == "hello!");
+    thread::Future<void> v = pool.submit([]() {});
+    v.get();
+    thread::Future<int> e = pool.submit([]() -> int
+                                        { throw std::runtime_error("boom"); });
+    bool thrown = false;
+    try
+    {
+        e.get();
+    }
+    catch (const std::runtime_error &err)
+    {
+        thrown = std::string(err.what()) == "boom";
+    }
+    assert(thrown);
+
+    // 批量:给500个成员序列化
+    std::vector<std::function<std::string()>> jobs;
+    for (int i = 0; i < 500; i++)
+        jobs.push_back([i]()
+                       { return "{\"to\":" + std::to_string(i) + "}"; });
+    auto results = pool.submit_batch(jobs.begin(), jobs.end());
+    assert(results.size() == 500);
+    for (int i = 0; i < 500; i++)
+        assert(results[i].get() == "{\"to\":" + std::to_string(i) + "}");
+
+    std::vector<std::atomic<int>> hits(100000);
+    pool.parallel_for(0, hits.size(), [&](size_t i)
+                      { hits[i]++; });
+    for (size_t i = 0; i < hits.size(); i++)
+        assert(hits[i] == 1);
+
+    // 在工作线程里嵌套parallel_for
+    std::atomic<long long> sum(0);
+    pool.submit([&]()
+                { pool.parallel_for(0, 1000, [&](size_t i)
+                                    { sum += i; }); })
+        .get();
+    assert(sum == 999 * 1000 / 2);
+
+    thrown = false;
+    try
+    {
+        pool.parallel_for(0, 1000, [](size_t i)
+                          {
+                              if (i == 500)
+                                  throw std::logic_error("chunk"); });
+    }
+    catch (const std::logic_error &)
+    {
+        thrown = true;
+    }
+    assert(thrown);
+    pool.stop();
+}
+
+int main()
+{
+    test(thread::SCHEDULE_SHARED);
+    test(thread::SCHEDULE_STEALING);
+
+    // 未执行就被丢弃的任务
+    thread::Future<int> lost;
+    {
+        thread::ThreadPool pool(1);
+        lost = pool.submit(square, 3);
+    }
+    bool thrown = false;
+    try
+    {
+        lost.get();
+    }
+    catch (const std::runtime_error &)
+    {
+        thrown = true;
+    }
+    assert(thrown);
+    std::cout << "future_test OK" << std::endl;
+}
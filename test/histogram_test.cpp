@@ -0,0 +1,43 @@
+#include "histogram.hpp"
+#include <iostream>
+#include <cassert>
+#include <cmath>
+/*
+ * HDR直方图:各量级的百分位数相对误差在千分之一以内,合并等于一起记录
+ */
+static bool near(uint64_t got, uint64_t want)
+{
+    return std::fabs((double)got - (double)want) <= want / 1000.0 + 1;
+}
+
+int main()
+{
+    client::Histogram h;
+    for (uint64_t v = 1; v <= 1000000; v++)
+        h.record(v);
+    assert(h.count() == 1000000 && h.min() == 1 && h.max() == 1000000);
+    assert(near(h.percentile(50), 500000) && near(h.percentile(99), 990000) && near(h.percentile(99.9), 999000));
+    assert(h.percentile(100) == 1000000 && std::fabs(h.mean() - 500000.5) < 1e-6);
+
+    // 小值精确
+    client::Histogram small;
+    for (uint64_t v = 0; v < 2048; v++)
+        small.record(v);
+    assert(small.percentile(50) == 1023 && small.min() == 0);
+
+    // 大值和上限
+    client::Histogram big(1000000000);
+    big.record(123456789);
+    big.record(5000000000ULL);
+    assert(near(big.percentile(50), 123456789) && big.max() == 1000000000);
+
+    client::Histogram a, b;
+    for (uint64_t v = 0; v < 1000; v++)
+        (v % 2 ? a : b).record(v * 997);
+    a.merge(b);
+    assert(a.count() == 1000 && a.max() == 999 * 997 && near(a.percentile(50), 499 * 997));
+    a.reset();
+    assert(a.count() == 0 && a.percentile(99) == 0);
+    std::cout << "histogram_test OK" << std::endl;
+    return 0;
+}
@@ -0,0 +1,163 @@
+#include "json.hpp"
+#include "document.hpp"
+#include "simd.hpp"
+#include "writer.hpp"
+#include "stream.hpp"
+#include "sax.hpp"
+#include "view.hpp"
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <time.h>
+/*
+ * 200B/1KB/8KB的聊天消息:value树与arena DOM的每条消息分配次数和解析吞吐,
+ * 每种解析器分别用标量、SSE2、AVX2扫描各跑一遍;
+ * 增量解析按1448字节(一个TCP段)和64字节切块喂入;
+ * 路由:整棵DOM取type/to/msg、SAX只取这几个字段、结构索引上按需取;
+ * 再比较用value树(按文本赋值/typed setter)和用Writer序列化同样一条回复
+ */
+static size_t mallocs = 0;
+void *operator new(size_t n)
+{
+    mallocs++;
+    void *p = malloc(n);
+    if (p == NULL)
+        throw std::bad_alloc();
+    return p;
+}
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+static double now()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+static const char *levelName(json::simd_level level)
+{
+    static const char *names[] = {"scalar", "sse2", "avx2"};
+    return names[level];
+}
+template <class F>
+static void run(const char *name, const std::string &msg, long long bytes, F f)
+{
+    int n = (int)(bytes / msg.size()) + 1;
+    f(); // 预热
+    size_t m = mallocs;
+    double begin = now();
+    for (int i = 0; i < n; i++)
+        f();
+    double elapsed = now() - begin;
+    printf("%-8s %-6s %6.1f allocs/msg %9.0f msgs/s %6.3f GB/s\n", name, levelName(json::simdLevel()),
+           (double)(mallocs - m) / n, n / elapsed, msg.size() * (double)n / elapsed / 1e9);
+}
+/*
+ * 固定的头部字段加上填充到size字节的msg正文,正文是UTF-8文本,每句末尾一个\n转义
+ */
+static std::string makeMessage(size_t size)
+{
+    std::string text = "hello, how are you doing today? \xe4\xbd\xa0\xe5\xa5\xbd, see you at the usual place around eight.\\n";
+    std::string msg = "{\"type\":\"chat\",\"from\":10001,\"to\":12345,\"ts\":1700000000123,"
+                      "\"tags\":[\"urgent\",\"family\",\"mobile\"],"
+                      "\"meta\":{\"client\":\"ios\",\"version\":\"1.2.3\",\"seq\":42},\"msg\":\"";
+    while (msg.size() + text.size() + 2 <= size)
+        msg += text;
+    msg += "\"}";
+    return msg;
+}
+
+int main(int argc, char *argv[])
+{
+    long long bytes = argc > 1 ? atoll(argv[1]) : 100000000; // 每组解析的总字节数
+    size_t sizes[] = {200, 1024, 8192};
+    json::simd_level best = json::simdLevel();
+    long long sum = 0;
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+        std::string msg = makeMessage(sizes[s]);
+        printf("message %zu bytes\n", msg.size());
+        json::Document doc;
+        for (int level = json::SIMD_SCALAR; level <= best; level++)
+        {
+            json::setSimdLevel((json::simd_level)level);
+            run("value", msg, bytes / 4, [&]()
+                {
+                    json::json j(msg);
+                    sum += j["to"].toInt(); });
+            run("document", msg, bytes, [&]()
+                {
+                    const json::Node &root = doc.parse(msg);
+                    sum += root["to"].toInt(); });
+        }
+        json::setSimdLevel(best);
+
+        // 服务端转发一条私聊需要的:type、to、正文原文
+        run("route", msg, bytes, [&]()
+            {
+                const json::Node &root = doc.parse(msg);
+                sum += root["type"].size() + root["to"].toInt() + root["msg"].formatString().size(); });
+        json::Reader reader;
+        run("pick", msg, bytes, [&]()
+            {
+                json::Field type = {"type"};
+                reader.pick(msg, &type, 1);
+                json::Field fields[] = {{"to"}, {"msg"}};
+                reader.pick(msg, fields, 2);
+                sum += type.value.size() + fields[0].value.toInt() + fields[1].size; });
+        json::Tape tape;
+        run("view", msg, bytes, [&]()
+            {
+                json::view root = tape.parse(msg);
+                sum += root["type"].text().size() + root["to"].toInt() + root["msg"].raw().size(); });
+
+        json::StreamParser stream;
+        size_t chunks[] = {1448, 64};
+        for (size_t c = 0; c < 2; c++)
+        {
+            printf("stream in %zu byte chunks\n", chunks[c]);
+            run("stream", msg, bytes, [&]()
+                {
+                    for (size_t i = 0; i < msg.size(); i += chunks[c])
+                        stream.feed(msg.data() + i, std::min(chunks[c], msg.size() - i), [&](const json::Node &root)
+                                    { sum += root["to"].toInt(); }); });
+        }
+        const json::Node &root = doc.parse(msg);
+        std::string text = root["msg"].toText();
+        run("tree", msg, bytes / 4, [&]()
+            {
+                json::json out;
+                out["type"] = "\"group\"";
+                out["room"] = 7;
+                out["from"] = 10001;
+                out["msg"] = root["msg"].formatString();
+                sum += out.formatString().size(); });
+        run("setters", msg, bytes / 4, [&]()
+            {
+                json::json out;
+                out["type"].set_string("group");
+                out["room"].set_int(7);
+                out["from"].set_int(10001);
+                out["msg"].set_string(text);
+                sum += out.formatString().size(); });
+        std::string buf;
+        run("writer", msg, bytes, [&]()
+            {
+                buf.clear();
+                json::Writer w(buf);
+                w.startObject();
+                w.key("type");
+                w.string("group");
+                w.key("room");
+                w.number(7);
+                w.key("from");
+                w.number(10001);
+                w.key("msg");
+                w.string(text);
+                w.endObject();
+                sum += buf.size(); });
+    }
+    return sum == 0;
+}
@@ -0,0 +1,91 @@
+#include "thread.hpp"
+#include <iostream>
+#include <cassert>
+#include <cstdio>
+#include <unistd.h>
+/*
+ * BULK通道饱和时HIGH通道的等待时间,以及各通道的计数和防饿死
+ */
+static void spin(long us)
+{
+    int64_t end = thread::clockNs() + us * 1000;
+    while (thread::clockNs() < end)
+    {
+    }
+}
+
+static void check(thread::schedule_mode mode)
+{
+    thread::PoolOption option;
+    option.mode = mode;
+    thread::ThreadPool pool(2, option);
+    pool.start();
+
+    // BULK塞满(不超过队列容量,否则提交会阻塞):每个任务200us,共约0.4秒的积压
+    const int BULK = 2000;
+    std::atomic<int> bulk(0);
+    for (int i = 0; i < BULK; i++)
+    {
+        pool.post_to(thread::LANE_BULK, [&]()
+                     { spin(200); bulk++; });
+    }
+    thread::LaneStats st = pool.stats(thread::LANE_BULK);
+    assert(st.depth > 0);
+
+    // 积压期间每毫秒提交一个HIGH任务
+    std::vector<thread::Future<int64_t>> highs;
+    for (int i = 0; i < 100; i++)
+    {
+        int64_t submitted = thread::clockNs();
+        highs.push_back(pool.submit_to(thread::LANE_HIGH, [submitted]()
+                                       { return thread::clockNs() - submitted; }));
+        usleep(1000);
+    }
+    std::vector<int64_t> latency;
+    for (size_t i = 0; i < highs.size(); i++)
+        latency.push_back(highs[i].get());
+    std::sort(latency.begin(), latency.end());
+    int64_t p99 = latency[latency.size() * 99 / 100];
+    // 即使BULK还有积压,HIGH只需要等当前任务和BULK的一次额度
+    assert(bulk < BULK);
+    printf("%s: high p99 %.3f ms with %d bulk tasks still queued\n",
+           mode == thread::SCHEDULE_SHARED ? "shared" : "stealing", p99 / 1e6, BULK - bulk.load());
+    assert(p99 < 20 * 1000 * 1000);
+
+    thread::LaneStats high = pool.stats(thread::LANE_HIGH);
+    assert(high.count == 100 && high.depth == 0);
+    assert(high.max >= high.p50 / 2 && high.p99 >= high.p50);
+
+    // HIGH也饱和时BULK仍然按权重前进
+    int before = bulk;
+    std::atomic<bool> flood(true);
+    std::atomic<int> flooded(0);
+    thread::Thread producer([&]()
+                            {
+                                while (flood)
+                                {
+                                    if (pool.pending(thread::LANE_HIGH) < 1000)
+                                        pool.post_to(thread::LANE_HIGH, [&]()
+                                                     { spin(50); flooded++; });
+                                    else
+                                        usleep(100);
+                                } });
+    producer.start();
+    usleep(200000);
+    flood = false;
+    producer.join();
+    assert(flooded > 0 && bulk > before);
+
+    assert(pool.stop());
+    st = pool.stats(thread::LANE_BULK);
+    assert(st.count == (uint64_t)BULK && st.depth == 0 && bulk == BULK);
+    assert(st.total > 0 && st.max >= st.p50 / 2);
+    assert(pool.stats(thread::LANE_NORMAL).count == 0);
+}
+
+int main()
+{
+    check(thread::SCHEDULE_SHARED);
+    check(thread::SCHEDULE_STEALING);
+    std::cout << "lane_test OK" << std::endl;
+}
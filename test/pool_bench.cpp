@@ -0,0 +1,60 @@
+#include "thread.hpp"
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+/*
+ * 同一负载下对比SCHEDULE_SHARED和SCHEDULE_STEALING
+ * 负载: 外部突发提交一批任务,每个任务在线程内再派生若干子任务
+ * 用法: pool_bench [线程数] [突发任务数] [每个任务派生的子任务数]
+ */
+static const size_t MAXTHREAD = 256;
+static std::atomic<size_t> perThread[MAXTHREAD];
+static std::atomic<size_t> slotNum(0);
+static std::atomic<size_t> done(0);
+
+static void work()
+{
+    static thread_local size_t slot = slotNum++ % MAXTHREAD;
+    volatile size_t x = 0;
+    for (int i = 0; i < 200; i++)
+        x += i;
+    perThread[slot].fetch_add(1, std::memory_order_relaxed);
+    done.fetch_add(1, std::memory_order_relaxed);
+}
+
+static void bench(thread::schedule_mode mode, size_t threads, size_t burst, size_t fanout)
+{
+    for (size_t i = 0; i < MAXTHREAD; i++)
+        perThread[i] = 0;
+    slotNum = 0;
+    done = 0;
+    thread::ThreadPool pool(threads, mode);
+    pool.start();
+    size_t total = burst * (fanout + 1);
+    auto begin = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < burst; i++)
+    {
+        pool.push_back([&pool, fanout]()
+                       {
+                           for (size_t j = 0; j < fanout; j++)
+                               pool.push_back(work);
+                           work(); });
+    }
+    while (done < total)
+        usleep(100);
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    pool.stop();
+    std::cout << (mode == thread::SCHEDULE_SHARED ? "shared:   " : "stealing: ") << (size_t)(total / sec) << " tasks/s, per thread:";
+    for (size_t i = 0; i < slotNum && i < MAXTHREAD; i++)
+        std::cout << " " << perThread[i];
+    std::cout << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t threads = argc > 1 ? atoi(argv[1]) : 4;
+    size_t burst = argc > 2 ? atoi(argv[2]) : 1000;
+    size_t fanout = argc > 3 ? atoi(argv[3]) : 100;
+    bench(thread::SCHEDULE_SHARED, threads, burst, fanout);
+    bench(thread::SCHEDULE_STEALING, threads, burst, fanout);
+}
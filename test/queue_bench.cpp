@@ -0,0 +1,62 @@
+#include "thread.hpp"
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+/*
+ * BlackQueue与RingQueue的任务吞吐对比
+ * 用法: queue_bench [生产者数] [消费者数] [每个生产者的任务数]
+ */
+static std::atomic<size_t> done(0);
+
+template <class Queue>
+double bench(size_t producers, size_t consumers, size_t n)
+{
+    using func = std::function<void()>;
+    Queue queue(DEFAULTMAX);
+    std::vector<thread::Thread> threads;
+    threads.reserve(producers + consumers);
+    done = 0;
+    for (size_t i = 0; i < consumers; i++)
+    {
+        threads.push_back(thread::Thread([&queue]()
+                                         {
+                                             while (1)
+                                             {
+                                                 func f = queue.popFront();
+                                                 if (!f)
+                                                     break;
+                                                 f();
+                                             } }));
+    }
+    for (size_t i = 0; i < producers; i++)
+    {
+        threads.push_back(thread::Thread([&queue, n]()
+                                         {
+                                             for (size_t j = 0; j < n; j++)
+                                                 queue.pushBack([]()
+                                                                { done.fetch_add(1, std::memory_order_relaxed); }); }));
+    }
+    auto begin = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < threads.size(); i++)
+        threads[i].start();
+    for (size_t i = consumers; i < threads.size(); i++)
+        threads[i].join();
+    for (size_t i = 0; i < consumers; i++)
+        queue.pushBack(func());
+    for (size_t i = 0; i < consumers; i++)
+        threads[i].join();
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    if (done != producers * n)
+        std::cout << "lost tasks: " << done << "/" << producers * n << std::endl;
+    return producers * n / sec;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t producers = argc > 1 ? atoi(argv[1]) : 4;
+    size_t consumers = argc > 2 ? atoi(argv[2]) : 4;
+    size_t n = argc > 3 ? atoi(argv[3]) : 1000000;
+    std::cout << "producers=" << producers << " consumers=" << consumers << " tasks=" << producers * n << std::endl;
+    std::cout << "BlackQueue: " << (size_t)bench<thread::BlackQueue<std::function<void()>>>(producers, consumers, n) << " tasks/s" << std::endl;
+    std::cout << "RingQueue:  " << (size_t)bench<thread::RingQueue<std::function<void()>>>(producers, consumers, n) << " tasks/s" << std::endl;
+}
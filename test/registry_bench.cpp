@@ -0,0 +1,125 @@
+#include "sharded_map.hpp"
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+/*
+ * 在线用户表:一把Mutex、一把读写锁、分片读写锁三种实现的查找吞吐
+ * 查找和服务端一样取出weak_ptr再lock;可以混入一定比例的登录(覆盖写)
+ * 用法: registry_bench [用户数] [线程数] [每线程操作数] [写入千分比]
+ */
+using Session = std::weak_ptr<int>;
+
+struct MutexRegistry
+{
+    const char *name = "mutex";
+    thread::Mutex mutex;
+    std::unordered_map<long long, Session> map;
+    bool find(long long user)
+    {
+        thread::Guard guard(mutex);
+        auto it = map.find(user);
+        return it != map.end() && !it->second.expired();
+    }
+    void set(long long user, const Session &s)
+    {
+        thread::Guard guard(mutex);
+        map[user] = s;
+    }
+};
+struct RWLockRegistry
+{
+    const char *name = "rwlock";
+    thread::RWLock lock;
+    std::unordered_map<long long, Session> map;
+    bool find(long long user)
+    {
+        thread::ReadGuard guard(lock);
+        auto it = map.find(user);
+        return it != map.end() && !it->second.expired();
+    }
+    void set(long long user, const Session &s)
+    {
+        thread::WriteGuard guard(lock);
+        map[user] = s;
+    }
+};
+struct ShardedRegistry
+{
+    const char *name = "sharded";
+    thread::ShardedMap<long long, Session> map;
+    bool find(long long user)
+    {
+        bool online = false;
+        map.visit(user, [&online](const Session &s)
+                  { online = !s.expired(); });
+        return online;
+    }
+    void set(long long user, const Session &s)
+    {
+        map.set(user, s);
+    }
+};
+
+template <class Registry>
+static void bench(size_t users, size_t threads, size_t ops, unsigned writes)
+{
+    Registry registry;
+    std::vector<std::shared_ptr<int>> conns(1024);
+    for (size_t i = 0; i < conns.size(); i++)
+        conns[i] = std::make_shared<int>((int)i);
+    // 按打乱的顺序登录,节点地址和ID无关
+    std::vector<long long> order(users);
+    for (size_t u = 0; u < users; u++)
+        order[u] = (long long)u;
+    uint64_t seed = 88172645463325252ULL;
+    for (size_t u = users; u > 1; u--)
+    {
+        seed ^= seed << 13, seed ^= seed >> 7, seed ^= seed << 17;
+        std::swap(order[u - 1], order[seed % u]);
+    }
+    for (size_t u = 0; u < users; u++)
+        registry.set(order[u], conns[u % conns.size()]);
+    std::atomic<size_t> hits(0);
+    std::vector<thread::Thread> workers;
+    workers.reserve(threads);
+    for (size_t t = 0; t < threads; t++)
+    {
+        workers.push_back(thread::Thread([&, t]()
+                                         {
+                                             uint64_t x = 0x9E3779B97F4A7C15ULL * (t + 1);
+                                             size_t found = 0;
+                                             for (size_t i = 0; i < ops; i++)
+                                             {
+                                                 x ^= x << 13, x ^= x >> 7, x ^= x << 17;
+                                                 long long user = (long long)(x % users);
+                                                 if ((x >> 40) % 1000 < writes)
+                                                     registry.set(user, conns[x % conns.size()]);
+                                                 else
+                                                     found += registry.find(user);
+                                             }
+                                             hits += found; }));
+    }
+    int64_t begin = thread::clockNs();
+    for (size_t i = 0; i < workers.size(); i++)
+        workers[i].start();
+    for (size_t i = 0; i < workers.size(); i++)
+        workers[i].join();
+    double sec = (thread::clockNs() - begin) / 1e9;
+    printf("%-8s %12.0f ops/s  hits %zu\n", registry.name, threads * ops / sec, hits.load());
+}
+
+int main(int argc, char *argv[])
+{
+    size_t users = argc > 1 ? atol(argv[1]) : 1000000;
+    size_t threads = argc > 2 ? atol(argv[2]) : 32;
+    size_t ops = argc > 3 ? atol(argv[3]) : 1000000;
+    unsigned writes = argc > 4 ? atoi(argv[4]) : 0;
+    printf("users=%zu threads=%zu ops/thread=%zu writes=%u/1000 cpus=%ld\n", users, threads, ops, writes, sysconf(_SC_NPROCESSORS_ONLN));
+    bench<MutexRegistry>(users, threads, ops, writes);
+    bench<RWLockRegistry>(users, threads, ops, writes);
+    bench<ShardedRegistry>(users, threads, ops, writes);
+    return 0;
+}
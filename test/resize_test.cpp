@@ -0,0 +1,93 @@
+#include "thread.hpp"
+#include <iostream>
+#include <cassert>
+#include <unistd.h>
+/*
+ * 线程数随积压增长,空闲后回收到下限
+ */
+static size_t count(const std::vector<thread::ResizeEvent> &history, thread::resize_reason reason)
+{
+    size_t n = 0;
+    for (size_t i = 0; i < history.size(); i++)
+        n += history[i].reason == reason;
+    return n;
+}
+
+static void adaptive(thread::schedule_mode mode)
+{
+    thread::PoolOption option;
+    option.mode = mode;
+    option.minThreads = 1;
+    option.maxThreads = 4;
+    option.growDepth = 8;
+    option.idleTimeout = 100;
+    thread::ThreadPool pool(1, option);
+    assert(pool.size() == 1 && pool.minSize() == 1 && pool.maxSize() == 4);
+    pool.start();
+
+    // 积压:每个任务2ms,一个线程跑不完
+    std::vector<thread::Future<void>> futures;
+    for (int i = 0; i < 200; i++)
+        futures.push_back(pool.submit([]()
+                                      { usleep(2000); }));
+    size_t peak = 0;
+    for (size_t i = 0; i < futures.size(); i++)
+    {
+        futures[i].get();
+        peak = std::max(peak, pool.size());
+    }
+    assert(peak == 4);
+    std::vector<thread::ResizeEvent> history = pool.history();
+    assert(count(history, thread::RESIZE_DEPTH) + count(history, thread::RESIZE_WAIT) == 3);
+
+    // 空闲后回收
+    for (int i = 0; i < 100 && pool.size() > 1; i++)
+        usleep(10000);
+    assert(pool.size() == 1);
+    history = pool.history();
+    assert(count(history, thread::RESIZE_IDLE) == 3);
+    for (size_t i = 0; i < history.size(); i++)
+    {
+        assert(history[i].from >= 1 && history[i].from <= 4);
+        assert(history[i].to >= 1 && history[i].to <= 4);
+        assert(i == 0 || history[i].time >= history[i - 1].time);
+    }
+
+    // 回收的槽位可再次扩容
+    futures.clear();
+    for (int i = 0; i < 200; i++)
+        futures.push_back(pool.submit([]()
+                                      { usleep(2000); }));
+    for (size_t i = 0; i < futures.size(); i++)
+        futures[i].get();
+    assert(count(pool.history(), thread::RESIZE_DEPTH) + count(pool.history(), thread::RESIZE_WAIT) >= 4);
+    assert(pool.stop());
+    assert(pool.size() == 1);
+
+    // 重启后从初始大小开始
+    pool.start();
+    assert(pool.size() == 1);
+    assert(pool.submit([]()
+                       { return 7; })
+               .get() == 7);
+    assert(pool.stop());
+}
+
+static void fixed()
+{
+    thread::ThreadPool pool(3);
+    assert(pool.minSize() == 3 && pool.maxSize() == 3);
+    pool.start();
+    for (int i = 0; i < 1000; i++)
+        pool.post([]() {});
+    assert(pool.stop());
+    assert(pool.size() == 3 && pool.history().empty());
+}
+
+int main()
+{
+    adaptive(thread::SCHEDULE_SHARED);
+    adaptive(thread::SCHEDULE_STEALING);
+    fixed();
+    std::cout << "resize_test OK" << std::endl;
+}
@@ -0,0 +1,112 @@
+#include "rooms.hpp"
+#include "message.hpp"
+#include "protocol.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <fcntl.h>
+#include <sys/resource.h>
+/*
+ * 一个房间广播给全部成员,从发出到每个loop都执行完投递并writev结束的耗时
+ * per-recipient:每个接收者一个跨线程任务(原来的做法);batched:Rooms::broadcast,每个loop一个任务
+ * 连接的fd是/dev/null,只测服务端自己的开销
+ * 用法: room_bench [成员数] [I/O线程数] [次数]
+ */
+static std::atomic<size_t> done(0);
+
+static void waitLoops(std::vector<std::unique_ptr<server::EventLoop>> &loops)
+{
+    // 标记任务在投递之后执行,再排一次保证本轮末尾的flush也已完成
+    done = 0;
+    for (size_t i = 0; i < loops.size(); i++)
+    {
+        server::EventLoop *loop = loops[i].get();
+        loop->queueInLoop([loop]()
+                          { loop->queueInLoop([]()
+                                              { done++; }); });
+    }
+    while (done < loops.size())
+        sched_yield(); // 单核机器上不能空转占住CPU
+}
+static void report(const char *name, std::vector<double> &ms)
+{
+    std::sort(ms.begin(), ms.end());
+    printf("%-14s p50 %7.3f ms  p99 %7.3f ms  max %7.3f ms\n", name, ms[ms.size() / 2], ms[ms.size() * 99 / 100], ms.back());
+}
+
+int main(int argc, char *argv[])
+{
+    size_t members = argc > 1 ? atol(argv[1]) : 10000;
+    size_t ioThreads = argc > 2 ? atol(argv[2]) : 4;
+    size_t rounds = argc > 3 ? atol(argv[3]) : 200;
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max)
+    {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+    std::vector<std::unique_ptr<server::EventLoop>> loops;
+    std::vector<thread::Thread> threads;
+    threads.reserve(ioThreads);
+    for (size_t i = 0; i < ioThreads; i++)
+    {
+        loops.push_back(std::unique_ptr<server::EventLoop>(new server::EventLoop));
+        server::EventLoop *loop = loops.back().get();
+        threads.push_back(thread::Thread([loop]()
+                                         { loop->loop(); }));
+        threads.back().start();
+    }
+    server::Rooms rooms;
+    std::vector<server::Connection::ptr> conns;
+    for (size_t i = 0; i < members; i++)
+    {
+        int fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            perror("open");
+            return 1;
+        }
+        conns.push_back(std::make_shared<server::Connection>(loops[i % ioThreads].get(), fd, i));
+        conns.back()->setUserId((long long)i);
+        rooms.join(1, (long long)i, conns.back());
+    }
+    printf("members=%zu io=%zu rounds=%zu cpus=%ld\n", members, ioThreads, rounds, sysconf(_SC_NPROCESSORS_ONLN));
+    chat::GroupPush push = {"group", 1, 0, {"{\"t\":\"hello everyone\"}", 22}};
+    auto frame = [&push](int encoding)
+    {
+        std::string out;
+        size_t start = chat::beginFrame(out);
+        json::format(push, out);
+        chat::endFrame(out, start);
+        return std::make_shared<std::string>(std::move(out));
+    };
+
+    std::vector<double> perRecipient, batched;
+    for (size_t r = 0; r < rounds; r++)
+    {
+        int64_t begin = thread::clockNs();
+        std::shared_ptr<const std::string> out = frame(0);
+        for (size_t i = 0; i < conns.size(); i++)
+            conns[i]->send(out);
+        waitLoops(loops);
+        perRecipient.push_back((thread::clockNs() - begin) / 1e6);
+
+        begin = thread::clockNs();
+        long n = rooms.broadcast(1, 0, frame);
+        waitLoops(loops);
+        batched.push_back((thread::clockNs() - begin) / 1e6);
+        if (n != (long)members)
+        {
+            printf("delivered %ld/%zu\n", n, members);
+            return 1;
+        }
+    }
+    report("per-recipient", perRecipient);
+    report("batched", batched);
+
+    for (size_t i = 0; i < loops.size(); i++)
+        loops[i]->quit();
+    for (size_t i = 0; i < threads.size(); i++)
+        threads[i].join();
+    return 0;
+}
@@ -0,0 +1,146 @@
+#include "sax.hpp"
+#include <iostream>
+#include <cassert>
+#include <string>
+/*
+ * SAX:事件序列重建出与Document相同的JSON,回调返回false时提前停止;
+ * pick:只取需要的字段,容器只给原文,找齐后不再检查后面的输入
+ */
+struct Rebuild : json::Handler
+{
+    std::string out;
+    json::Writer w;
+    int events;
+    int limit;
+    Rebuild(int stop = -1) : w(out), events(0), limit(stop)
+    {
+    }
+    bool next()
+    {
+        return ++events != limit;
+    }
+    bool startObject()
+    {
+        w.startObject();
+        return next();
+    }
+    bool endObject(size_t)
+    {
+        w.endObject();
+        return next();
+    }
+    bool startArray()
+    {
+        w.startArray();
+        return next();
+    }
+    bool endArray(size_t)
+    {
+        w.endArray();
+        return next();
+    }
+    bool key(const char *s, size_t len)
+    {
+        w.key(s, len);
+        return next();
+    }
+    bool string(const char *s, size_t len)
+    {
+        w.string(s, len);
+        return next();
+    }
+    bool integer(long long int v)
+    {
+        w.number(v);
+        return next();
+    }
+    bool real(double v)
+    {
+        w.number(v);
+        return next();
+    }
+    bool boolean(bool v)
+    {
+        w.boolean(v);
+        return next();
+    }
+    bool null()
+    {
+        w.null();
+        return next();
+    }
+};
+static bool fails(const std::string &s)
+{
+    json::Reader reader;
+    json::Handler handler;
+    try
+    {
+        reader.parse(s, handler);
+    }
+    catch (const json::Exception &)
+    {
+        return true;
+    }
+    return false;
+}
+
+int main()
+{
+    std::string input = "{\"type\":\"chat\",\"to\":42,\"pi\":-3.5,\"big\":123456789012345678901,\"ok\":true,\"nil\":null,"
+                        "\"msg\":\"a\\\"b\\n\\u4f60\",\"list\":[1,[],{}],\"o\":{\"k\":[{\"x\":false}]}}";
+    json::Reader reader;
+    json::Document doc;
+    Rebuild all;
+    assert(reader.parse(input, all));
+    assert(all.out == doc.parse(input).formatString());
+
+    Rebuild some(3); // startObject,key,string之后停止
+    assert(!reader.parse(input, some));
+    assert(some.out == "{\"type\":\"chat\"");
+
+    json::Handler check;
+    assert(reader.parse("  [1, {\"a\": \"b\"}] ", check));
+    assert(fails("") && fails("{") && fails("[1,]") && fails("{\"a\" 1}") && fails("\"\\x\"") && fails("01") &&
+           fails("[1] 2") && fails("\"a\nb\"") && fails(std::string(1000, '[')));
+
+    // pick:标量解码,字符串按需反转义,容器给原文
+    json::Field fields[] = {{"msg"}, {"to"}, {"list"}, {"missing"}};
+    assert(reader.pick(input, fields, 4) == 3);
+    assert(fields[0].found && fields[0].value.toText() == "a\"b\n\xe4\xbd\xa0");
+    assert(std::string(fields[0].text, fields[0].size) == "\"a\\\"b\\n\\u4f60\"");
+    assert(fields[1].value.toInt() == 42 && std::string(fields[1].text, fields[1].size) == "42");
+    assert(fields[2].value.isNull() && std::string(fields[2].text, fields[2].size) == "[1,[],{}]");
+    assert(!fields[3].found && fields[3].text == NULL);
+
+    // 找齐即停,后面的错误不会被发现
+    json::Field type = {"type"};
+    assert(reader.pick("{\"type\":\"chat\", \"x\": ]]]", &type, 1) == 1 && type.value.equals("chat"));
+    // 重复的键取第一个
+    json::Field dup = {"a"};
+    assert(reader.pick("{\"a\":1,\"a\":2}", &dup, 1) == 1 && dup.value.toInt() == 1);
+    // 跳过的值仍然检查结构
+    bool threw = false;
+    try
+    {
+        reader.pick("{\"body\":{\"k\" 1},\"type\":\"x\"}", &type, 1);
+    }
+    catch (const json::Exception &)
+    {
+        threw = true;
+    }
+    assert(threw);
+    threw = false;
+    try
+    {
+        reader.pick("[\"type\"]", &type, 1);
+    }
+    catch (const json::Exception &)
+    {
+        threw = true;
+    }
+    assert(threw);
+    assert(reader.pick("{}", &type, 1) == 0 && !type.found);
+    std::cout << "sax_test OK" << std::endl;
+    return 0;
+}
@@ -0,0 +1,67 @@
+#include "sharded_map.hpp"
+#include <iostream>
+#include <cassert>
+#include <string>
+#include <vector>
+/*
+ * 分片哈希表:单线程语义,以及多线程并发增删查后计数一致
+ */
+int main()
+{
+    thread::ShardedMap<long long, std::string> map(5);
+    assert(map.shards() == 8);
+    assert(map.set(1, "a") && !map.set(1, "b") && !map.insert(1, "c") && map.insert(2, "d"));
+    std::string v;
+    assert(map.find(1, v) && v == "b" && !map.find(3, v) && map.contains(2) && map.size() == 2);
+    assert(map.update(2, [](std::string &s)
+                      { s += "!"; }) &&
+           map.find(2, v) && v == "d!");
+    size_t len = 0;
+    assert(map.visit(2, [&len](const std::string &s)
+                     { len = s.size(); }) &&
+           len == 2);
+    assert(!map.eraseIf(1, [](const std::string &s)
+                        { return s == "x"; }));
+    assert(map.eraseIf(1, [](const std::string &s)
+                       { return s == "b"; }) &&
+           !map.contains(1));
+    assert(map.erase(2) && !map.erase(2) && map.size() == 0);
+
+    // 连续ID均匀分片
+    thread::ShardedMap<long long, int> ids(64);
+    for (long long i = 0; i < 64000; i++)
+        ids.set(i, (int)i);
+    size_t count = 0;
+    long long sum = 0;
+    ids.forEach([&](long long k, int v)
+                { count++, sum += v - k; });
+    assert(count == 64000 && sum == 0);
+
+    // 每个线程只增删自己的键,同时读所有键
+    thread::ShardedMap<long long, long long> shared;
+    const int threads = 8, keys = 20000;
+    std::vector<thread::Thread> workers;
+    workers.reserve(threads); // 启动后不能再搬动
+    for (int t = 0; t < threads; t++)
+    {
+        workers.push_back(thread::Thread([&shared, t]()
+                                         {
+                                             long long out;
+                                             for (int round = 0; round < 3; round++)
+                                             {
+                                                 for (long long k = t; k < keys; k += threads)
+                                                     shared.set(k, k * 2);
+                                                 for (long long k = 0; k < keys; k++)
+                                                     if (shared.find(k, out))
+                                                         assert(out == k * 2);
+                                                 for (long long k = t; k < keys; k += threads * 2)
+                                                     shared.erase(k);
+                                             } }));
+        workers.back().start();
+    }
+    for (size_t i = 0; i < workers.size(); i++)
+        workers[i].join();
+    assert(shared.size() == keys / 2);
+    std::cout << "sharded_map_test OK" << std::endl;
+    return 0;
+}
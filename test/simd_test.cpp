@@ -0,0 +1,86 @@
+#include "simd.hpp"
+#include "document.hpp"
+#include <iostream>
+#include <cassert>
+#include <cstdlib>
+#include <vector>
+/*
+ * 各级扫描实现与标量版本逐位置对比,包括块边界和缓冲区末尾;再用每个级别解析同一批消息
+ */
+static void checkKernels(const std::vector<char> &buf)
+{
+    const char *begin = buf.data();
+    const char *end = begin + buf.size();
+    for (int level = json::SIMD_SCALAR; level <= json::simd::detect(); level++)
+    {
+        json::simd::Kernel k = json::simd::select((json::simd_level)level);
+        assert(k.level == level);
+        for (const char *p = begin; p <= end; p++)
+        {
+            assert(k.scan(p, end) == json::simd::scanScalar(p, end));
+            assert(k.space(p, end) == json::simd::spaceScalar(p, end));
+        }
+    }
+}
+
+int main()
+{
+    srand(1);
+    std::vector<char> buf;
+    for (int round = 0; round < 200; round++)
+    {
+        // 命中字节稀疏地出现在不同偏移,长度覆盖16/32字节块的各种余数
+        buf.resize(rand() % 100);
+        for (size_t i = 0; i < buf.size(); i++)
+        {
+            int r = rand() % 64;
+            if (r == 0)
+                buf[i] = '"';
+            else if (r == 1)
+                buf[i] = '\\';
+            else if (r == 2)
+                buf[i] = (char)(rand() % 0x20);
+            else if (r < 40)
+                buf[i] = " \t\n\r"[rand() % 4];
+            else
+                buf[i] = (char)(0x20 + rand() % 0xE0);
+        }
+        checkKernels(buf);
+    }
+    // 高位字节(UTF-8)不能被当成控制字符
+    buf.assign(64, (char)0xE4);
+    assert(json::simd::select(json::simd::detect()).scan(buf.data(), buf.data() + buf.size()) == buf.data() + buf.size());
+
+    std::string text;
+    for (int i = 0; i < 50; i++)
+        text += "abcdefghij\\n\\u4f60";
+    std::string input = "{ \"type\" :\n\t\t\"chat\",          \"msg\":\"" + text + "\", \"plain\":\"" + std::string(100, 'x') + "\"}";
+    std::string expect;
+    for (int level = json::SIMD_SCALAR; level <= json::simd::detect(); level++)
+    {
+        json::setSimdLevel((json::simd_level)level);
+        json::Document doc;
+        const json::Node &root = doc.parse(input);
+        assert(root["plain"].size() == 100);
+        std::string msg = root["msg"].toText();
+        assert(msg.size() == 50 * 14);
+        if (expect.empty())
+            expect = msg;
+        assert(msg == expect);
+        json::json old(input);
+        assert(old["msg"].toText() == expect);
+        assert(old["type"].toText() == "chat");
+        bool thrown = false;
+        try
+        {
+            doc.parse("{\"msg\":\"" + std::string(40, 'x') + "\x01\"}");
+        }
+        catch (const json::Exception &)
+        {
+            thrown = true;
+        }
+        assert(thrown);
+    }
+    std::cout << "simd_test ok, best " << json::simd::detect() << std::endl;
+    return 0;
+}
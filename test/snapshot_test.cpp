@@ -0,0 +1,72 @@
+#include "json.hpp"
+#include <iostream>
+#include <cassert>
+#include <string>
+#include <thread>
+#include <vector>
+#include <type_traits>
+/*
+ * snapshot:和原值互不影响,只读访问不插入键也拿不到可修改的value,拷贝只增加引用计数,多线程同时读
+ */
+int main()
+{
+    json::json j("{\"type\":\"group\",\"room\":7,\"list\":[1,2,3],\"o\":{\"k\":\"v\"}}");
+    json::snapshot snap = j.freeze();
+    std::string text = snap.text();
+    assert(text.size() == j.formatString().size()); // unordered_map的顺序可能不同
+    j["room"] = 8;
+    j["o"]["k"] = "\"changed\"";
+    j["new"] = 1;
+    assert(snap.text() == text && snap["room"].toInt() == 7 && snap["o"]["k"].toText() == "v");
+
+    // 只读访问
+    json::snapshot::node root = snap.root();
+    assert(root["missing"].getType() == json::VALUE_NULL && !root.contains("missing") && root.contains("room"));
+    assert(root["room"]["deeper"].getType() == json::VALUE_NULL && root["list"][5].getType() == json::VALUE_NULL);
+    assert(root["list"][2].toInt() == 3 && root["list"].size() == 3 && root.size() == 4);
+    assert(snap.text() == text);
+
+    // 拿不到可修改的value,clone出来的是独立的深拷贝
+    static_assert(!std::is_convertible<json::snapshot::node, json::value>::value, "node must stay read-only");
+    static_assert(!std::is_convertible<json::snapshot::node, const json::value &>::value, "node must stay read-only");
+    json::value own = snap["o"].clone();
+    own["x"] = 5;
+    own["k"] = "\"mine\"";
+    assert(snap["o"]["k"].toText() == "v" && !snap["o"].contains("x") && snap["o"].size() == 1 && snap.text() == text);
+
+    // 拷贝和shared()共用引用计数
+    {
+        json::snapshot copy = snap;
+        std::shared_ptr<const std::string> frame = snap.shared();
+        assert(snap.useCount() == 3 && frame.get() == &snap.text());
+    }
+    assert(snap.useCount() == 1);
+    std::shared_ptr<const std::string> frame = json::snapshot(root).shared();
+    assert(frame->size() == text.size()); // snapshot析构后序列化结果仍然有效
+
+    json::value v;
+    v["a"] = 1;
+    json::value deep = v.clone();
+    v["a"] = 2;
+    assert(deep["a"].toInt() == 1);
+    assert(json::snapshot().text() == "null");
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; t++)
+    {
+        threads.emplace_back([snap, &text]()
+                             {
+                                 for (int i = 0; i < 10000; i++)
+                                 {
+                                     json::snapshot local = snap;
+                                     assert(local.text() == text && local["list"][1].toInt() == 2);
+                                     std::shared_ptr<const std::string> f = local.shared();
+                                     assert(f->size() == text.size());
+                                 } });
+    }
+    for (size_t t = 0; t < threads.size(); t++)
+        threads[t].join();
+    assert(snap.useCount() == 1);
+    std::cout << "snapshot_test OK" << std::endl;
+    return 0;
+}
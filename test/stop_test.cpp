@@ -0,0 +1,81 @@
+#include "thread.hpp"
+#include <iostream>
+#include <cassert>
+#include <chrono>
+/*
+ * ThreadPool停止: DRAIN执行完全部任务, CANCEL丢弃剩余任务, 超时有界, 可重复start/stop
+ */
+static long long elapsed(std::chrono::steady_clock::time_point begin)
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin).count();
+}
+
+static void test(thread::schedule_mode mode)
+{
+    std::atomic<int> done(0);
+    thread::ThreadPool pool(4, mode);
+
+    // DRAIN: 包括任务中派生的任务
+    pool.start();
+    for (int i = 0; i < 1000; i++)
+    {
+        pool.post([&pool, &done]()
+                  {
+                      done++;
+                      pool.post([&done]()
+                                { done++; }); });
+    }
+    assert(pool.stop(thread::STOP_DRAIN));
+    assert(done == 2000);
+    assert(!pool.post([]() {}));
+
+    // 重新启动, CANCEL丢弃排队的任务
+    pool.start();
+    done = 0;
+    std::vector<thread::Future<void>> futures;
+    for (int i = 0; i < 100; i++)
+    {
+        futures.push_back(pool.submit([&done]()
+                                      {
+                                          usleep(2000);
+                                          done++; }));
+    }
+    auto begin = std::chrono::steady_clock::now();
+    assert(!pool.stop(thread::STOP_CANCEL));
+    assert(elapsed(begin) < 100);
+    int failed = 0;
+    for (size_t i = 0; i < futures.size(); i++)
+    {
+        try
+        {
+            futures[i].get();
+        }
+        catch (const std::runtime_error &)
+        {
+            failed++;
+        }
+    }
+    assert(failed + done == 100 && failed > 0);
+
+    // DRAIN超时后转为CANCEL
+    pool.start();
+    for (int i = 0; i < 1000; i++)
+        pool.post([]()
+                  { usleep(1000); });
+    begin = std::chrono::steady_clock::now();
+    assert(!pool.stop(thread::STOP_DRAIN, 50));
+    assert(elapsed(begin) < 50 + 100);
+
+    // 空闲的线程池停止要快
+    pool.start();
+    begin = std::chrono::steady_clock::now();
+    assert(pool.stop());
+    assert(elapsed(begin) < 50);
+}
+
+int main()
+{
+    test(thread::SCHEDULE_SHARED);
+    test(thread::SCHEDULE_STEALING);
+    std::cout << "stop_test OK" << std::endl;
+}
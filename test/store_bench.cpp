@@ -0,0 +1,100 @@
+#include "offline_store.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <chrono>
+/*
+ * 离线存储吞吐:
+ * async:追加不等待,最后commit一次;durable:每条都等落盘,多线程共享成组的fdatasync
+ * replay:重启后逐用户mmap读出全部消息;compact:ack一半用户后压缩
+ * 用法: store_bench [目录] [消息数] [负载字节] [durable线程数]
+ */
+static double seconds(std::chrono::steady_clock::time_point from)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - from).count();
+}
+
+int main(int argc, char *argv[])
+{
+    std::string dir = argc > 1 ? argv[1] : "/tmp/store_bench";
+    size_t count = argc > 2 ? atol(argv[2]) : 1000000;
+    size_t payload = argc > 3 ? atol(argv[3]) : 128;
+    size_t threads = argc > 4 ? atol(argv[4]) : 8;
+    const long long users = 1000;
+    std::string data(payload, 'x');
+    std::string error;
+    system(("rm -rf " + dir).c_str());
+
+    server::StoreOption option;
+    option.dir = dir;
+    {
+        server::OfflineStore store(option);
+        if (!store.open(error))
+        {
+            fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < count; i++)
+            store.append((long long)(i % users), data);
+        store.commit();
+        double t = seconds(start);
+        server::StoreStats st = store.stats();
+        printf("async    %8.0f msg/s %7.1f MB/s  commits %llu\n", count / t, st.diskBytes / t / 1e6,
+               (unsigned long long)st.commits);
+
+        // 每条都等落盘,同时等待的线程共用一次fdatasync
+        size_t durable = std::max((size_t)1, count / 100);
+        uint64_t commits = st.commits;
+        std::vector<thread::Thread> workers;
+        workers.reserve(threads);
+        start = std::chrono::steady_clock::now();
+        for (size_t t = 0; t < threads; t++)
+        {
+            workers.push_back(thread::Thread([&store, &data, durable, threads, t]()
+                                             {
+                                                 for (size_t i = t; i < durable; i += threads)
+                                                     store.append((long long)(i % users), data, true); }));
+            workers.back().start();
+        }
+        for (size_t t = 0; t < threads; t++)
+            workers[t].join();
+        t = seconds(start);
+        commits = store.stats().commits - commits;
+        printf("durable  %8.0f msg/s  %zu threads  %.1f appends/commit\n", durable / t, threads,
+               commits ? (double)durable / commits : 0.0);
+    }
+    {
+        // 重启:扫描重建索引,再按用户顺序读出
+        auto start = std::chrono::steady_clock::now();
+        server::OfflineStore store(option);
+        if (!store.open(error))
+        {
+            fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+        double recover = seconds(start);
+        server::StoreStats st = store.stats();
+        start = std::chrono::steady_clock::now();
+        size_t messages = 0, bytes = 0;
+        for (long long u = 0; u < users; u++)
+        {
+            uint64_t last = store.replay(u, [&](const char *, size_t len)
+                                         { messages++, bytes += len; });
+            if (u % 2 == 0)
+                store.ack(u, last);
+        }
+        double t = seconds(start);
+        printf("recover  %8.3f s  %zu segments %.1f MB\n", recover, st.segments, st.diskBytes / 1e6);
+        printf("replay   %8.0f msg/s %7.1f MB/s\n", messages / t, bytes / t / 1e6);
+
+        start = std::chrono::steady_clock::now();
+        size_t removed = store.compact();
+        t = seconds(start);
+        st = store.stats();
+        printf("compact  %8.3f s  removed %zu segments, %zu left %.1f MB\n", t, removed, st.segments, st.diskBytes / 1e6);
+    }
+    system(("rm -rf " + dir).c_str());
+    return 0;
+}
@@ -0,0 +1,155 @@
+#include "offline_store.hpp"
+#include <iostream>
+#include <cassert>
+#include <string>
+#include <vector>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+/*
+ * 离线存储:按序补发、ack、重启恢复、截断损坏的尾部、压缩删段
+ */
+static std::vector<std::string> replay(server::OfflineStore &store, long long user, uint64_t *last = NULL)
+{
+    std::vector<std::string> out;
+    uint64_t seq = store.replay(user, [&out](const char *data, size_t len)
+                                { out.push_back(std::string(data, len)); });
+    if (last)
+        *last = seq;
+    return out;
+}
+static server::StoreOption option(const std::string &dir)
+{
+    server::StoreOption o;
+    o.dir = dir;
+    o.segmentSize = 4096;
+    o.fsync = false;
+    return o;
+}
+
+int main()
+{
+    char tmpl[] = "/tmp/store_test.XXXXXX";
+    std::string dir = mkdtemp(tmpl);
+    std::string error;
+    {
+        server::OfflineStore store(option(dir));
+        assert(store.open(error));
+        assert(replay(store, 1).empty());
+        for (int i = 0; i < 100; i++)
+        {
+            store.append(1, "a" + std::to_string(i));
+            store.append(2, "b" + std::to_string(i), i % 10 == 0);
+        }
+        uint64_t last;
+        std::vector<std::string> got = replay(store, 1, &last);
+        assert(got.size() == 100 && got[0] == "a0" && got[99] == "a99" && last > 0);
+        assert(store.stats().segments > 1);
+        store.ack(1, last);
+        assert(store.pending(1) == 0 && replay(store, 1).empty() && store.pending(2) == 100);
+        store.append(1, "later");
+        got = replay(store, 1);
+        assert(got.size() == 1 && got[0] == "later");
+    }
+    // 重启后只剩没ack的消息
+    {
+        server::OfflineStore store(option(dir));
+        assert(store.open(error));
+        std::vector<std::string> got = replay(store, 1);
+        assert(got.size() == 1 && got[0] == "later");
+        got = replay(store, 2);
+        assert(got.size() == 100 && got[50] == "b50");
+        // 序号接着重启前的继续
+        uint64_t a = store.append(3, "x");
+        assert(a > 201 && store.append(2, "y") == a + 1);
+    }
+    // 最后一段写了半条记录
+    std::string last;
+    for (int id = 1; id < 1000; id++)
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "/%08x.log", id);
+        struct stat st;
+        if (stat((dir + name).c_str(), &st) == 0)
+            last = dir + name;
+    }
+    struct stat st;
+    assert(stat(last.c_str(), &st) == 0);
+    off_t size = st.st_size;
+    int fd = open(last.c_str(), O_WRONLY | O_APPEND);
+    assert(fd >= 0 && write(fd, "garbage-tail", 12) == 12);
+    close(fd);
+    {
+        server::OfflineStore store(option(dir));
+        assert(store.open(error));
+        assert(replay(store, 2).size() == 101 && replay(store, 3).size() == 1);
+        assert(stat(last.c_str(), &st) == 0 && st.st_size == size);
+        store.append(3, "z");
+    }
+    // 投递完后压缩删掉封存段,重启后ack状态依然有效
+    {
+        server::OfflineStore store(option(dir));
+        assert(store.open(error));
+        assert(replay(store, 3).size() == 2);
+        size_t before = store.stats().segments;
+        uint64_t seq;
+        replay(store, 2, &seq);
+        store.ack(2, seq);
+        replay(store, 1, &seq);
+        store.ack(1, seq);
+        // 用户3还剩2条,压缩后搬到当前段
+        size_t removed = store.compact();
+        server::StoreStats st = store.stats();
+        assert(removed > 0 && st.segments < before && st.messages == 2);
+        std::vector<std::string> got = replay(store, 3);
+        assert(got.size() == 2 && got[0] == "x" && got[1] == "z");
+    }
+    {
+        server::OfflineStore store(option(dir));
+        assert(store.open(error));
+        assert(replay(store, 1).empty() && replay(store, 2).empty());
+        uint64_t seq;
+        std::vector<std::string> got = replay(store, 3, &seq);
+        assert(got.size() == 2 && got[0] == "x" && got[1] == "z");
+        // 只补发after之后的
+        got.clear();
+        store.replay(3, [&got](const char *data, size_t len)
+                     { got.push_back(std::string(data, len)); }, seq - 1);
+        assert(got.size() == 1 && got[0] == "z");
+        // 压缩线程处理中也能正常关闭
+        store.compactLater();
+        // 关闭后重新open,计数从磁盘重建,不叠加
+        server::StoreStats st = store.stats();
+        store.close();
+        assert(store.open(error));
+        server::StoreStats again = store.stats();
+        assert(again.messages == st.messages && again.liveBytes == st.liveBytes && replay(store, 3).size() == 2);
+    }
+    // 超长的负载整条拒绝,不截断存半条
+    {
+        server::OfflineStore store(option(dir));
+        assert(store.open(error));
+        size_t before = store.pending(4);
+        std::string huge((1 << 24), 'x');
+        assert(store.append(4, huge, true) == 0 && !store.lastError().empty());
+        assert(store.pending(4) == before && store.append(4, std::string("ok"), true) > 0);
+    }
+    system(("rm -rf " + dir).c_str());
+    // 目录被删,换新段时建不了文件:进入失败状态,写进缓冲的消息不算落盘
+    {
+        char broken[] = "/tmp/store_test.XXXXXX";
+        server::StoreOption o = option(mkdtemp(broken));
+        server::OfflineStore store(o);
+        assert(store.open(error));
+        assert(store.append(1, std::string("kept"), true) > 0 && store.lastError().empty());
+        system(("rm -rf " + o.dir).c_str());
+        std::string big(3000, 'x');
+        assert(store.append(1, big) > 0);
+        assert(store.append(1, big, true) == 0);
+        assert(!store.commit() && !store.lastError().empty());
+        assert(store.append(1, "after") == 0 && store.compact() == 0);
+    }
+    std::cout << "store_test ok" << std::endl;
+    return 0;
+}
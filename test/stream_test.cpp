@@ -0,0 +1,107 @@
+#include "stream.hpp"
+#include <iostream>
+#include <cassert>
+#include <cstdlib>
+#include <vector>
+/*
+ * 增量解析:同一段输入在每个位置切开、逐字节喂入,结果都与整段的Document一致;
+ * 错误的位置是流中的偏移
+ */
+static std::vector<std::string> parseChunks(json::StreamParser &parser, const std::string &input, const std::vector<size_t> &cuts)
+{
+    std::vector<std::string> out;
+    auto collect = [&](const json::Node &v)
+    { out.push_back(v.formatString()); };
+    size_t begin = 0;
+    for (size_t i = 0; i <= cuts.size(); i++)
+    {
+        size_t end = i < cuts.size() ? cuts[i] : input.size();
+        parser.feed(input.data() + begin, end - begin, collect);
+        begin = end;
+    }
+    parser.finish(collect);
+    return out;
+}
+static bool fails(const std::string &input, size_t &offset)
+{
+    json::StreamParser parser;
+    try
+    {
+        for (size_t i = 0; i < input.size(); i++)
+            parser.feed(input.data() + i, 1, [](const json::Node &) {});
+        parser.finish([](const json::Node &) {});
+    }
+    catch (const json::Exception &e)
+    {
+        std::string what = e.what();
+        offset = atoi(what.c_str() + what.find("location ") + 9);
+        return true;
+    }
+    return false;
+}
+
+int main()
+{
+    std::vector<std::string> values = {
+        "{\"type\":\"chat\",\"to\":42,\"msg\":\"hi \\\"you\\\" \\u4f60\\ud83d\\ude00\\\\\",\"tags\":[\"a\",\"b\"],\"o\":{},\"l\":[]}",
+        "[1,-2.5,1e3,true,false,null,[[]],{\"k\":{\"k\":[{}]}}]",
+        "\"top\"",
+        "12345",
+        "{}",
+        "-0.25",
+        "null"};
+    std::string input;
+    std::vector<std::string> expect;
+    json::Document doc;
+    for (size_t i = 0; i < values.size(); i++)
+    {
+        input += values[i];
+        input += i % 2 ? "\n" : " \t ";
+        expect.push_back(doc.parse(values[i]).formatString());
+    }
+    input.resize(input.size() - 1); // 最后的null后面没有分隔符,靠finish结束
+
+    json::StreamParser parser;
+    assert(parseChunks(parser, input, {}) == expect);
+    assert(parser.idle());
+    for (size_t cut = 0; cut <= input.size(); cut++)
+    {
+        parser.reset();
+        assert(parseChunks(parser, input, {cut}) == expect);
+    }
+    std::vector<size_t> bytes;
+    for (size_t i = 1; i < input.size(); i++)
+        bytes.push_back(i);
+    parser.reset();
+    assert(parseChunks(parser, input, bytes) == expect);
+    assert(parser.offset() == input.size());
+
+    // 完成的值立刻回调,不等后续输入
+    parser.reset();
+    size_t n = parser.feed(std::string("{\"a\":1}{\"b\""), [](const json::Node &v)
+                           { assert(v["a"].toInt() == 1); });
+    assert(n == 1 && !parser.idle() && parser.depth() == 1);
+
+    size_t offset = 0;
+    assert(fails("{\"a\" 1}", offset) && offset == 5);
+    assert(fails("[1,]", offset) && offset == 3);
+    assert(fails("{\"a\":1,}", offset) && offset == 7);
+    assert(fails("[1 2]", offset) && offset == 3);
+    assert(fails("{\"a\":tru}", offset));
+    assert(fails("\"abc\x01\"", offset) && offset == 4);
+    assert(fails("{\"a\":[1,2]", offset) && offset == 10);
+    assert(fails("\"\\x\"", offset));
+    assert(fails("]", offset) && offset == 0);
+    assert(fails(std::string(JSONDEPTH + 1, '['), offset) && offset == JSONDEPTH);
+    assert(!fails(std::string(100, '[') + std::string(100, ']'), offset));
+
+    // offset跨多次feed累计
+    std::string line = expect[0] + "\n";
+    parser.reset();
+    size_t count = 0;
+    for (int i = 0; i < 100; i++)
+        count += parser.feed(line, [](const json::Node &) {});
+    assert(count == 100 && parser.offset() == line.size() * 100);
+    std::cout << "stream_test OK" << std::endl;
+    return 0;
+}
@@ -0,0 +1,109 @@
+#include "thread.hpp"
+#include <iostream>
+#include <cstdlib>
+#include <string>
+#include <set>
+/*
+ * 统计post/push_back提交任务期间的内存分配次数,典型的消息处理闭包应当为0
+ * submit带Future,每次固定分配一个共享状态
+ */
+static std::atomic<size_t> mallocs(0);
+
+void *operator new(size_t n)
+{
+    mallocs.fetch_add(1, std::memory_order_relaxed);
+    void *p = malloc(n ? n : 1);
+    if (p == NULL)
+        throw std::bad_alloc();
+    return p;
+}
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+
+struct Session
+{
+    long long user;
+    std::string name;
+};
+static std::atomic<size_t> done(0);
+
+static void handle(const std::shared_ptr<Session> &session, long long to, int type)
+{
+    if (session->user + to + type >= 0)
+        done.fetch_add(1, std::memory_order_relaxed);
+}
+
+static bool run(thread::schedule_mode mode, const char *name)
+{
+    const size_t N = 100000;
+    thread::ThreadPool pool(2, mode);
+    pool.start();
+    std::shared_ptr<Session> session(new Session{1, "user"});
+    long long to = 2;
+    // 预热: 每个工作线程都要做过一次派生,节点缓存是按线程的
+    thread::Mutex mutex;
+    std::set<pthread_t> warmed;
+    for (int round = 0; round < 100 && warmed.size() < 2; round++)
+    {
+        done = 0;
+        for (int j = 0; j < 8; j++)
+        {
+            pool.post([&pool, &mutex, &warmed, session, to]()
+                      {
+                          for (int i = 0; i < 1000; i++)
+                              pool.post(handle, session, to, i);
+                          handle(session, to, 0);
+                          thread::Guard guard(mutex);
+                          warmed.insert(pthread_self()); });
+        }
+        while (done < 8 * 1001)
+            usleep(100);
+    }
+
+    done = 0;
+    size_t before = mallocs;
+    for (size_t i = 0; i < N / 2; i++)
+    {
+        // 闭包: 指针 + shared_ptr + 整数
+        Session *raw = session.get();
+        pool.push_back([raw, session, to]()
+                       { handle(session, to + raw->user, 1); });
+        pool.post(handle, session, to, 2);
+    }
+    size_t external = mallocs - before;
+    while (done < N)
+        usleep(100);
+    before = mallocs;
+    pool.post([&pool, session, to]()
+              {
+                  for (int i = 0; i < 1000; i++)
+                      pool.post(handle, session, to, i);
+                  handle(session, to, 0); });
+    while (done < N + 1001)
+        usleep(100);
+    size_t internal = mallocs - before;
+    before = mallocs;
+    for (int i = 0; i < 1000; i++)
+        pool.submit(handle, session, to, 3).get();
+    size_t future = mallocs - before;
+    pool.stop();
+    bool ok = external == 0 && internal == 0 && future == 1000;
+    std::cout << name << ": " << external << " mallocs for " << N << " external posts, "
+              << internal << " mallocs for 1000 posts from a worker, "
+              << future << " mallocs for 1000 submits " << (ok ? "OK" : "FAILED") << std::endl;
+    return ok;
+}
+
+int main()
+{
+    std::cout << "sizeof(thread::Task)=" << sizeof(thread::Task) << std::endl;
+    bool ok = run(thread::SCHEDULE_SHARED, "shared");
+    ok = run(thread::SCHEDULE_STEALING, "stealing") && ok;
+    return ok ? 0 : 1;
+}
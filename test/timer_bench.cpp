@@ -0,0 +1,141 @@
+#include "timer.hpp"
+#include <iostream>
+#include <random>
+#include <cstdio>
+#include <sys/resource.h>
+#include <unistd.h>
+/*
+ * 100万个等待中的定时器:schedule/cancel吞吐、tick开销、触发延迟
+ * 对照组为互斥锁保护的最小堆
+ */
+static double now()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+static double cpu()
+{
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+struct HeapEntry
+{
+    int64_t expire;
+    thread::Task fn;
+    bool operator<(const HeapEntry &other) const
+    {
+        return expire > other.expire;
+    }
+};
+
+int main(int argc, char *argv[])
+{
+    const size_t N = argc > 1 ? (size_t)atol(argv[1]) : 1000000;
+    const int THREADS = 4;
+    std::vector<std::vector<long>> delays(THREADS);
+    std::mt19937 rng(1);
+    for (int t = 0; t < THREADS; t++)
+    {
+        for (size_t i = 0; i < N / THREADS; i++)
+            delays[t].push_back(10000 + rng() % 50000); // 10s~60s,覆盖第1、2层
+    }
+
+    thread::ThreadPool pool(2);
+    pool.start();
+    thread::TimerWheel wheel(&pool, 1);
+    wheel.start();
+    std::vector<std::vector<thread::Timer>> timers(THREADS);
+
+    // schedule
+    double begin = now();
+    {
+        std::vector<thread::Thread> threads;
+        for (int t = 0; t < THREADS; t++)
+        {
+            threads.push_back(thread::Thread([&, t]()
+                                             {
+                                                 timers[t].reserve(delays[t].size());
+                                                 for (size_t i = 0; i < delays[t].size(); i++)
+                                                     timers[t].push_back(wheel.schedule_after(delays[t][i], []() {})); }));
+        }
+        for (size_t t = 0; t < threads.size(); t++)
+            threads[t].start();
+        for (size_t t = 0; t < threads.size(); t++)
+            threads[t].join();
+    }
+    double elapsed = now() - begin;
+    printf("wheel schedule %zu timers, %d threads: %.0f ns/op\n", wheel.size(), THREADS, elapsed * 1e9 / N);
+
+    // 100万个等待中时每个tick的开销
+    usleep(100000);
+    double c0 = cpu(), w0 = now();
+    usleep(1000000);
+    printf("wheel idle with %zu pending: %.2f%% cpu\n", wheel.size(), (cpu() - c0) / (now() - w0) * 100);
+
+    // cancel一半
+    begin = now();
+    {
+        std::vector<thread::Thread> threads;
+        for (int t = 0; t < THREADS; t++)
+        {
+            threads.push_back(thread::Thread([&, t]()
+                                             {
+                                                 for (size_t i = 0; i < timers[t].size(); i += 2)
+                                                     timers[t][i].cancel(); }));
+        }
+        for (size_t t = 0; t < threads.size(); t++)
+            threads[t].start();
+        for (size_t t = 0; t < threads.size(); t++)
+            threads[t].join();
+    }
+    elapsed = now() - begin;
+    printf("wheel cancel %zu timers: %.0f ns/op, %zu left\n", N / 2, elapsed * 1e9 / (N / 2), wheel.size());
+
+    // 触发延迟
+    const int FIRE = 10000;
+    std::vector<double> lateness(FIRE);
+    std::atomic<int> fired(0);
+    for (int i = 0; i < FIRE; i++)
+    {
+        long delay = 50 + i % 200;
+        double due = now() + delay / 1e3;
+        wheel.schedule_after(delay, [&, i, due]()
+                             { lateness[i] = now() - due; fired++; });
+    }
+    while (fired < FIRE)
+        usleep(1000);
+    std::sort(lateness.begin(), lateness.end());
+    printf("wheel lateness: p50 %.2f ms, p99 %.2f ms, max %.2f ms\n",
+           lateness[FIRE / 2] * 1e3, lateness[FIRE * 99 / 100] * 1e3, lateness[FIRE - 1] * 1e3);
+    timers.clear();
+    wheel.stop();
+    pool.stop();
+
+    // 对照:互斥锁 + 最小堆
+    thread::Mutex mutex;
+    std::priority_queue<HeapEntry> heap;
+    begin = now();
+    {
+        std::vector<thread::Thread> threads;
+        for (int t = 0; t < THREADS; t++)
+        {
+            threads.push_back(thread::Thread([&, t]()
+                                             {
+                                                 for (size_t i = 0; i < delays[t].size(); i++)
+                                                 {
+                                                     HeapEntry entry = {thread::clockMs() + delays[t][i], thread::Task([]() {})};
+                                                     thread::Guard guard(mutex);
+                                                     heap.push(std::move(entry));
+                                                 } }));
+        }
+        for (size_t t = 0; t < threads.size(); t++)
+            threads[t].start();
+        for (size_t t = 0; t < threads.size(); t++)
+            threads[t].join();
+    }
+    elapsed = now() - begin;
+    printf("heap  schedule %zu timers, %d threads: %.0f ns/op\n", heap.size(), THREADS, elapsed * 1e9 / N);
+}
@@ -0,0 +1,93 @@
+#include "timer.hpp"
+#include <iostream>
+#include <cassert>
+#include <unistd.h>
+/*
+ * 一次性/周期定时器、取消、跨层降级、停止重启
+ */
+static void check(thread::ThreadPool *pool)
+{
+    thread::TimerWheel wheel(pool, 1);
+    wheel.start();
+
+    // 一次性:不会早于到期时间,只执行一次
+    std::atomic<int> once(0);
+    std::atomic<int64_t> at(0);
+    int64_t begin = thread::clockMs();
+    thread::Timer t1 = wheel.schedule_after(20, [&]()
+                                            { at = thread::clockMs(); once++; });
+    assert(t1.pending() && wheel.size() == 1);
+    while (once == 0)
+        usleep(1000);
+    usleep(20000);
+    assert(once == 1 && at - begin >= 20);
+    assert(!t1.pending() && !t1.cancel() && wheel.size() == 0);
+
+    // 到期前取消
+    std::atomic<int> cancelled(0);
+    thread::Timer t2 = wheel.schedule_after(30, [&]()
+                                            { cancelled++; });
+    assert(t2.cancel());
+    assert(!t2.cancel());
+    usleep(60000);
+    assert(cancelled == 0 && wheel.size() == 0);
+
+    // 周期
+    std::atomic<int> ticks(0);
+    thread::Timer t3 = wheel.schedule_every(5, [&]()
+                                            { ticks++; });
+    usleep(100000);
+    assert(t3.cancel());
+    int seen = ticks;
+    assert(seen >= 5 && seen <= 21);
+    usleep(30000);
+    assert(ticks <= seen + 1); // 取消时可能有一次正在执行
+
+    // 超过第0层(256个tick)的定时器经过降级后触发
+    std::atomic<int> far(0);
+    begin = thread::clockMs();
+    wheel.schedule_after(600, [&]()
+                         { at = thread::clockMs(); far++; });
+    while (far == 0)
+        usleep(5000);
+    assert(at - begin >= 600 && at - begin < 800);
+
+    // 大量定时器同时到期,丢弃句柄不影响触发
+    std::atomic<int> many(0);
+    for (int i = 0; i < 10000; i++)
+        wheel.schedule_after(i % 50, [&]()
+                             { many++; });
+    while (many < 10000)
+        usleep(1000);
+
+    // 停止期间到期的在重启后补发
+    std::atomic<int> late(0);
+    wheel.stop();
+    wheel.schedule_after(10, [&]()
+                         { late++; });
+    usleep(30000);
+    assert(late == 0);
+    wheel.start();
+    while (late == 0)
+        usleep(1000);
+
+    // 析构丢弃未触发的,之后cancel返回false
+    thread::Timer orphan;
+    {
+        thread::TimerWheel w(pool, 1);
+        w.start();
+        orphan = w.schedule_after(100000, []() {});
+        assert(orphan.pending());
+    }
+    assert(!orphan.pending() && !orphan.cancel());
+}
+
+int main()
+{
+    check(NULL);
+    thread::ThreadPool pool(2);
+    pool.start();
+    check(&pool);
+    pool.stop();
+    std::cout << "timer_test OK" << std::endl;
+}
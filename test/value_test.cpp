@@ -0,0 +1,86 @@
+#include "json.hpp"
+#include <iostream>
+#include <cassert>
+#include <string>
+/*
+ * typed setter:字符串原样保存不经过解析器,set_raw_json才解析,
+ * emplace_back/emplace直接建节点,移走后原值是null
+ */
+static bool throws(void (*f)())
+{
+    try
+    {
+        f();
+    }
+    catch (const json::Exception &)
+    {
+        return true;
+    }
+    return false;
+}
+
+int main()
+{
+    json::json j;
+    // 像JSON的文本也只是字符串
+    j["msg"].set_string("[\"not\",\"parsed\"");
+    j["quote"].set_string(std::string("say \"hi\"\n"));
+    j["num"].set_string("123");
+    assert(j["msg"].getType() == json::VALUE_STRING && j["msg"].toText() == "[\"not\",\"parsed\"");
+    assert(j["quote"].formatString() == "\"say \\\"hi\\\"\\n\"");
+    assert(j["num"].getType() == json::VALUE_STRING && j["num"].toText() == "123");
+    json::json back(j.formatString());
+    assert(back["msg"].toText() == "[\"not\",\"parsed\"" && back["quote"].toText() == "say \"hi\"\n");
+
+    j["i"].set_int(-42);
+    j["d"].set_double(0.5);
+    j["b"].set_bool(true);
+    j["n"].set_null();
+    assert(j["i"].toInt() == -42 && j["d"].toDouble() == 0.5 && j["b"].formatString() == "true");
+    assert(j["n"].getType() == json::VALUE_NULL);
+
+    // 明确解析
+    j["raw"].set_raw_json("{\"k\":[1,2]}");
+    assert(j["raw"]["k"][1].toInt() == 2);
+    assert(throws([]()
+                  { json::value v;
+                    v.set_raw_json("[1,"); }));
+    assert(throws([]()
+                  { json::value v;
+                    v = "not json"; }));
+    // 旧接口不变
+    j["old"] = "[\"11\",\"22\"]";
+    assert(j["old"][1].toText() == "22");
+    j["old"].push("\"33\"");
+    assert(j["old"].size() == 3);
+
+    // emplace_back:返回新元素,不是数组时先变成空数组
+    json::value list;
+    list.emplace_back().set_string("a");
+    list.emplace_back().set_int(2);
+    json::value obj;
+    obj.emplace("k", json::value()).set_bool(false);
+    list.emplace_back(std::move(obj));
+    assert(obj.getType() == json::VALUE_NULL);
+    assert(list.size() == 3 && list[2]["k"].formatString() == "false");
+    assert(list.formatString() == "[\"a\",2,{\"k\":false}]");
+    list.set_array();
+    assert(list.size() == 0 && list.formatString() == "[]");
+
+    // 移动和赋值
+    json::value a;
+    a["x"].set_int(1);
+    json::value b(std::move(a));
+    assert(a.getType() == json::VALUE_NULL && b["x"].toInt() == 1);
+    a = b;
+    assert(a["x"].toInt() == 1);
+    json::value c;
+    c = std::move(b);
+    assert(b.getType() == json::VALUE_NULL && c["x"].toInt() == 1);
+
+    // 对象成员替换
+    c.emplace("x", json::value()).set_string("y");
+    assert(c.size() == 1 && c["x"].toText() == "y");
+    std::cout << "value_test OK" << std::endl;
+    return 0;
+}
@@ -0,0 +1,81 @@
+#include "view.hpp"
+#include <iostream>
+#include <cassert>
+#include <string>
+/*
+ * 结构索引:语法错误在parse时发现,值在访问时解码,
+ * 没有转义的字符串和原文都指向输入
+ */
+static bool fails(const std::string &s)
+{
+    json::Tape tape;
+    try
+    {
+        tape.parse(s);
+    }
+    catch (const json::Exception &)
+    {
+        return true;
+    }
+    return false;
+}
+
+int main()
+{
+    std::string input = "{\"type\":\"chat\", \"to\":42,\"pi\":-3.5e0,\"big\":123456789012345678901,\"ok\":true,\"nil\":null,"
+                        "\"msg\":\"a\\\"b\\n\\u4f60\",\"list\":[1, [],{}],\"o\":{\"k\":[{\"x\":false}]},\"to\":43,\"w\\u0069de\":1}";
+    json::Tape tape;
+    json::view root = tape.parse(input);
+    assert(root.isObject() && root.size() == 11);
+    assert(root["type"].text() == "chat" && root["type"].text().data() == input.data() + 9);
+    assert(root["to"].toInt() == 43 && root["to"].isInt()); // 重复的键取最后一个
+    assert(root["pi"].toDouble() == -3.5 && !root["pi"].isInt());
+    assert(root["big"].toDouble() == 123456789012345678901.0);
+    assert(root["ok"].toBool() && root["nil"].isNull() && root["nil"].exists());
+    assert(root["msg"].toText() == "a\"b\n\xe4\xbd\xa0" && root["msg"].raw() == "\"a\\\"b\\n\\u4f60\"");
+    assert(root["wide"].toInt() == 1); // 键有转义
+    assert(root["list"].raw() == "[1, [],{}]" && root["list"].size() == 3);
+    assert(root["list"][0].toInt() == 1 && root["list"][1].isArray() && root["list"][2].isObject() && !root["list"][3].exists());
+    assert(root["o"]["k"][0]["x"].isBool() && !root["o"]["k"][0]["x"].toBool());
+    assert(!root["missing"].exists() && !root["missing"]["deeper"].exists() && root["missing"].isNull());
+    assert(root.formatString() == input);
+
+    int items = 0;
+    root["list"].items([&](const json::view &v)
+                       { items++; });
+    assert(items == 3);
+    std::string keys;
+    root["o"].members([&](json::StringView key, const json::view &v)
+                      { keys += key.str() + "=" + v.raw().str(); });
+    assert(keys == "k=[{\"x\":false}]");
+
+    // 原文直接写进回复
+    std::string out;
+    json::Writer w(out);
+    w.startObject();
+    w.key("msg");
+    root["msg"].write(w);
+    w.endObject();
+    assert(out == "{\"msg\":\"a\\\"b\\n\\u4f60\"}");
+
+    bool threw = false;
+    try
+    {
+        root["type"].toInt();
+    }
+    catch (const json::Exception &)
+    {
+        threw = true;
+    }
+    assert(threw);
+
+    // 标量顶层、复用
+    assert(tape.parse(" \"x\" ").text() == "x" && tape.size() == 1);
+    assert(tape.parse("[1,2,3]")[2].toInt() == 3 && tape.size() == 4);
+
+    assert(fails("") && fails("{") && fails("[1,]") && fails("{\"a\" 1}") && fails("\"\\x\"") && fails("01") &&
+           fails("[1] 2") && fails("\"a\nb\"") && fails(std::string(1000, '[')) && fails("1.") && fails("-") &&
+           fails("1e") && fails("\"\\ud800\"") && fails("\"\\u12\"") && fails("tru") && fails("{1:2}"));
+    std::cout << "view_test OK" << std::endl;
+    return 0;
+}
@@ -0,0 +1,103 @@
+#include "document.hpp"
+#include "writer.hpp"
+#include "protocol.hpp"
+#include <iostream>
+#include <cassert>
+#include <cstdlib>
+#include <climits>
+#include <cfloat>
+/*
+ * 流式序列化:逗号、转义、整数边界、浮点最短往返、写进帧缓冲区
+ */
+static std::string number(double v)
+{
+    std::string s;
+    json::formatDouble(v, s);
+    return s;
+}
+
+int main()
+{
+    std::string out = "prefix";
+    json::Writer w(out);
+    w.startObject();
+    w.key("a");
+    w.number(1);
+    w.key("b");
+    w.startArray();
+    w.startArray();
+    w.endArray();
+    w.number(-2LL);
+    w.string("x\"y\\z\n\x01");
+    w.startObject();
+    w.endObject();
+    w.null();
+    w.boolean(true);
+    w.endArray();
+    w.key("c");
+    w.raw("{\"k\":[1,2]}");
+    w.endObject();
+    assert(out == "prefix{\"a\":1,\"b\":[[],-2,\"x\\\"y\\\\z\\n\\u0001\",{},null,true],\"c\":{\"k\":[1,2]}}");
+    assert(w.size() == out.size() - 6);
+
+    std::string s;
+    json::formatInt(LLONG_MIN, s);
+    s += ' ';
+    json::formatInt(LLONG_MAX, s);
+    s += ' ';
+    json::formatUint(ULLONG_MAX, s);
+    s += ' ';
+    json::formatInt(0, s);
+    s += ' ';
+    json::formatInt(-9, s);
+    s += ' ';
+    json::formatInt(10, s);
+    assert(s == "-9223372036854775808 9223372036854775807 18446744073709551615 0 -9 10");
+    for (int i = -100000; i <= 100000; i += 7)
+    {
+        s.clear();
+        json::formatInt(i, s);
+        assert(s == std::to_string(i));
+    }
+
+    assert(number(3.14) == "3.14");
+    assert(number(0.1) == "0.1");
+    assert(number(1e21) == "1e+21");
+    assert(number(-0.5) == "-0.5");
+    assert(number(2.0) == "2.0");
+    assert(number(1.0 / 3) == "0.3333333333333333");
+    assert(number(0.0 / 0.0) == "null");
+    srand(1);
+    for (int i = 0; i < 100000; i++)
+    {
+        double v = (double)rand() / rand() * (rand() % 2 ? 1e-5 : 1e7);
+        std::string t = number(v);
+        assert(strtod(t.c_str(), NULL) == v);
+    }
+    s = number(DBL_MAX);
+    assert(strtod(s.c_str(), NULL) == DBL_MAX);
+
+    // Document重新序列化后再解析,结果相同
+    std::string input = "{\"type\":\"chat\",\"n\":[1,-2,3.5,1e300,true,null],\"s\":\"\\u4f60\\t\\\"\",\"o\":{}}";
+    json::Document doc;
+    std::string again = doc.parse(input).formatString();
+    assert(again == "{\"type\":\"chat\",\"n\":[1,-2,3.5,1e+300,true,null],\"s\":\"\xe4\xbd\xa0\\t\\\"\",\"o\":{}}");
+    json::Document doc2;
+    assert(doc2.parse(again).formatString() == again);
+
+    // 负载直接写在帧里
+    std::string frame = "old";
+    size_t start = chat::beginFrame(frame);
+    doc.root().format(frame);
+    chat::endFrame(frame, start);
+    std::string payload;
+    size_t consumed = 0;
+    assert(chat::decodeFrame(frame.data() + 3, frame.size() - 3, payload, consumed) == chat::FRAME_OK);
+    assert(payload == again && consumed == frame.size() - 3);
+
+    json::json j("{\"a\":[1,2],\"b\":\"q\\\"\"}");
+    std::string f = j.formatString();
+    assert(f == "{\"a\":[1,2],\"b\":\"q\\\"\"}" || f == "{\"b\":\"q\\\"\",\"a\":[1,2]}");
+    std::cout << "writer_test OK" << std::endl;
+    return 0;
+}